@@ -22,14 +22,14 @@ void move_mem_to_register(CodegenOperand op, int target_reg, CodegenFunctionBody
             .type=CodegenInstructionType_LOD,
             .value.mem={
                 .address=op,
-                .reg=1,
-                .offset=1,
+                .reg={CodegenOperandType_REGISTER, .value.num=target_reg},
+                .offset.data=op.value.identifier,
             }
         };
         vecptr_push(instructions, lod);
         return;
     }
-    
+
     CodegenOperand base_ptr = {
         .type = CodegenOperandType_REGISTER,
         .value = {
@@ -136,6 +136,7 @@ CodegenFunctionDefinition fixup_function(struct FuncAndOffset function) {
     CodegenFunctionBody new_body = {NULL, 0, 0};
     new_function.body = new_body;
     new_function.global = function.function.global;
+    new_function.param_count = function.function.param_count;
 
     CodegenInstruction allocate_stack = {
         .type = CodegenInstructionType_ALLOCATE_STACK,
@@ -183,7 +184,24 @@ void reg_to_mem(int reg, int offset, CodegenFunctionBody* body) {
     vecptr_push(body, str);
 }
 
-void move_to_mem(CodegenOperand op, int offset, CodegenFunctionBody* body) {
+void reg_to_operand(int reg, CodegenOperand dst, CodegenFunctionBody* body) {
+    if (dst.type == CodegenOperandType_DATA) {
+        CodegenInstruction str = {
+            .type=CodegenInstructionType_STR,
+            .value.mem={
+                .address=dst,
+                .reg={CodegenOperandType_REGISTER, .value.num=reg},
+                .offset.data=dst.value.identifier,
+            }
+        };
+        vecptr_push(body, str);
+        return;
+    }
+
+    reg_to_mem(reg, dst.value.num, body);
+}
+
+void move_to_mem(CodegenOperand op, CodegenOperand dst, CodegenFunctionBody* body) {
     if (is_imm(op.type)) {
         CodegenInstruction ldi = {
             .type = CodegenInstructionType_LDI,
@@ -202,33 +220,12 @@ void move_to_mem(CodegenOperand op, int offset, CodegenFunctionBody* body) {
 
         vecptr_push(body, ldi);
 
-        CodegenInstruction str = {
-            .type = CodegenInstructionType_STR,
-            .value = {
-                .mem = {
-                    .address = {
-                        .type = CodegenOperandType_REGISTER,
-                        .value = {
-                            .num = 15,
-                        },
-                    },
-                    .offset.num = offset,
-                    .reg = {
-                        .type = CodegenOperandType_REGISTER,
-                        .value = {
-                            .num = 10,
-                        },
-                    },
-                }
-            }
-        };
-
-        vecptr_push(body, str);
+        reg_to_operand(10, dst, body);
     } else if (is_reg(op.type)) {
-        reg_to_mem(op.value.num, offset, body);
+        reg_to_operand(op.value.num, dst, body);
     } else if (is_stack(op.type)) {
         move_mem_to_register(op, 10, body);
-        reg_to_mem(10, offset, body);
+        reg_to_operand(10, dst, body);
     }
 }
 
@@ -250,8 +247,9 @@ void handle_mov_like(CodegenInstruction instruction, CodegenFunctionBody* body)
                     vecptr_push(body, mov);
                     break;
                 }
-                case CodegenOperandType_STACK: {
-                    reg_to_mem(instruction.value.two_op.source.value.num, instruction.value.two_op.destination.value.num, body);
+                case CodegenOperandType_STACK:
+                case CodegenOperandType_DATA: {
+                    reg_to_operand(instruction.value.two_op.source.value.num, instruction.value.two_op.destination, body);
                     break;
                 }
 
@@ -261,14 +259,16 @@ void handle_mov_like(CodegenInstruction instruction, CodegenFunctionBody* body)
             }
             break;
         }
-        case CodegenOperandType_STACK: {
+        case CodegenOperandType_STACK:
+        case CodegenOperandType_DATA: {
             switch (instruction.value.two_op.destination.type) {
                 case CodegenOperandType_REGISTER: {
                     move_to_reg(instruction.value.two_op.source, instruction.value.two_op.destination.value.num, body);
                     break;
                 }
                 case CodegenOperandType_STACK:
-                    move_to_mem(instruction.value.two_op.source, instruction.value.two_op.destination.value.num, body);
+                case CodegenOperandType_DATA:
+                    move_to_mem(instruction.value.two_op.source, instruction.value.two_op.destination, body);
                     break;
                 default:
                     fprintf(stderr, "Unexpected operand type\n");
@@ -283,15 +283,12 @@ void handle_mov_like(CodegenInstruction instruction, CodegenFunctionBody* body)
                     move_to_reg(instruction.value.two_op.source, instruction.value.two_op.destination.value.num, body);
                     break;
                 }
-                case CodegenOperandType_STACK: {
-                    move_to_mem(instruction.value.two_op.source, instruction.value.two_op.destination.value.num, body);
-                    break;
-                }
+                case CodegenOperandType_STACK:
                 case CodegenOperandType_DATA: {
-                    vecptr_push(body, instruction);
+                    move_to_mem(instruction.value.two_op.source, instruction.value.two_op.destination, body);
                     break;
                 }
-                
+
                 default:
                     fprintf(stderr, "Unexpected operand type\n");
                     exit(1);
@@ -330,8 +327,8 @@ void fixup_instruction(CodegenInstruction instruction, CodegenFunctionBody* body
             handle_mov_like(instruction, body);
             break;
         case CodegenInstructionType_UNARY: {
-            int src_reg = instruction.value.two_op.source.value.num;
-            int dst_reg = instruction.value.two_op.destination.value.num;
+            int src_reg = instruction.value.unary.src.value.num;
+            int dst_reg = instruction.value.unary.dst.value.num;
 
             if (!is_reg(instruction.value.unary.src.type)) {
                 src_reg = 10;
@@ -366,7 +363,7 @@ void fixup_instruction(CodegenInstruction instruction, CodegenFunctionBody* body
             vecptr_push(body, unary);
 
             if (!is_reg(instruction.value.unary.dst.type)) {
-                reg_to_mem(11, instruction.value.unary.dst.value.num, body);
+                reg_to_operand(11, instruction.value.unary.dst, body);
             }
 
             break;
@@ -413,7 +410,8 @@ void fixup_instruction(CodegenInstruction instruction, CodegenFunctionBody* body
             if (!is_reg(instruction.value.binary.dst.type)) {
                 switch (instruction.value.binary.dst.type) {
                     case CodegenOperandType_STACK:
-                        reg_to_mem(12, instruction.value.binary.dst.value.num, body);
+                    case CodegenOperandType_DATA:
+                        reg_to_operand(12, instruction.value.binary.dst, body);
                         break;
                     default:
                         fprintf(stderr, "Unexpected operand type\n");
@@ -450,6 +448,15 @@ void fixup_instruction(CodegenInstruction instruction, CodegenFunctionBody* body
             vecptr_push(body, cmp);
             break;
         }
+        case CodegenInstructionType_JUMP_TABLE: {
+            // r11 since the emitter's expansion reads the index before it writes r11
+            instruction.value.jump_table.index = (CodegenOperand){
+                .type = CodegenOperandType_REGISTER,
+                .value.num = move_to_reg_if_not(instruction.value.jump_table.index, 11, body),
+            };
+            vecptr_push(body, instruction);
+            break;
+        }
         case CodegenInstructionType_PUSH:
         case CodegenInstructionType_CALL:
         case CodegenInstructionType_RET:
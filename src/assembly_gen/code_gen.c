@@ -2,9 +2,10 @@
 #include <stdio.h>
 
 #include "code_gen.h"
+#include "instruction_selection.h"
 #include "../easy_stuff.h"
 
-CodegenProgram codegen_generate_program(IRProgram program) {
+CodegenProgram codegen_generate_program(IRProgram program, TCSymbols* symbols) {
     CodegenProgram codegen_program = {NULL, 0, 0};
 
     for (int i = 0; i < program.length; i++) {
@@ -12,7 +13,7 @@ CodegenProgram codegen_generate_program(IRProgram program) {
 
         switch (program.data[i].ty) {
             case IRTFunction: {
-                CodegenFunctionDefinition function = codegen_generate_function(program.data[i].val.function);
+                CodegenFunctionDefinition function = codegen_generate_function(program.data[i].val.function, symbols);
                 tl = (CodegenTopLevel){
                     .ty=CGTFunction,
                     .val.function=function
@@ -43,11 +44,12 @@ CodegenStatic codegen_generate_static(IRStaticVariable var) {
     };
 }
 
-CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition function) {
+CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition function, TCSymbols* symbols) {
     CodegenFunctionDefinition codegen_function = {NULL};
 
     codegen_function.identifier = function.identifier;
     codegen_function.global = function.global;
+    codegen_function.param_count = function.params.length;
     codegen_function.body = (CodegenFunctionBody) { NULL, 0, 0 };
 
     // move params to vars
@@ -83,7 +85,7 @@ CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition functio
                     .source = {
                         .type = CodegenOperandType_STACK,
                         .value = {
-                            .num = (stack_a-6)*2
+                            .num = (stack_a-4)*2 // past the saved fp and the return address
                         }
                     },
                     .destination = {
@@ -98,10 +100,11 @@ CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition functio
         vec_push(codegen_function.body, mov);
     }
 
-    // loop over the instructionss
-    for (int i = 0; i < function.body.length; i++) {
-        codegen_generate_instruction(function.body.data[i], &codegen_function.body);
-    }
+    IRVarInfos vars = ir_collect_var_info(&function, symbols);
+
+    isel_function(&function, &vars, &codegen_function.body);
+
+    ir_var_infos_free(&vars);
 
     return codegen_function;
 }
@@ -117,163 +120,87 @@ CodegenUnaryOp codegen_convert_op(IRUnaryOp op) {
     }
 }
 
-void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody* instructions) {
-    switch (instruction.type) {
-        case IRInstructionType_Return: {
-            CodegenInstruction mov_instruction = {
-                .type = CodegenInstructionType_MOV,
-                .value = {
-                    .two_op = {
-                        .source = codegen_convert_val(instruction.value.val, instructions),
-                        .destination = {CodegenOperandType_REGISTER, .value.num = 2},
-                    },
-                },
-            };
-
-            vecptr_push(instructions, mov_instruction);
-
-            CodegenInstruction ret_instruction = {
-                .type = CodegenInstructionType_RET,
-            };
-
-            vecptr_push(instructions, ret_instruction);
+CodegenCondCode codegen_invert_cond(CodegenCondCode cond) {
+    switch (cond) {
+        case CodegenCondCode_EQ:
+            return CodegenCondCode_NE;
+        case CodegenCondCode_NE:
+            return CodegenCondCode_EQ;
+        case CodegenCondCode_LT:
+            return CodegenCondCode_GE;
+        case CodegenCondCode_LE:
+            return CodegenCondCode_GT;
+        case CodegenCondCode_GT:
+            return CodegenCondCode_LE;
+        case CodegenCondCode_GE:
+            return CodegenCondCode_LT;
+        default:
+            return CodegenCondCode_EQ;
+    }
+}
 
+CodegenBinaryOp codegen_convert_binary_op(IRBinaryOp ir_op) {
+    CodegenBinaryOp op;
+    switch (ir_op) {
+        case IRBinaryOp_Add:
+            op = CodegenBinaryOp_ADD;
             break;
-        }
-        case IRInstructionType_Unary: {
-            CodegenOperand src = codegen_convert_val(instruction.value.unary.src, instructions);
-            CodegenOperand dst = codegen_convert_val(instruction.value.unary.dst, instructions);
-
-            if (instruction.value.unary.op == IRUnaryOp_Not) {
-                // this is actually just a x == 0
-                CodegenInstruction not_instr = {
-                    .type = CodegenInstructionType_BINARY,
-                    .value = {
-                        .binary = {
-                            .op = CodegenBinaryOp_EQUAL,
-                            .left = src,
-                            .right = {CodegenOperandType_REGISTER, .value.num = 0},
-                            .dst = dst,
-                        },
-                    },
-                };
-
-                vecptr_push(instructions, not_instr);
-
-                break;
-            }
-
-            CodegenInstruction unary_instruction = {
-                .type = CodegenInstructionType_UNARY,
-                .value = {
-                    .unary = {
-                        .op = codegen_convert_op(instruction.value.unary.op),
-                        .src = src,
-                        .dst = dst,
-                    },
-                },
-
-            };
-
-            vecptr_push(instructions, unary_instruction);
-
+        case IRBinaryOp_Subtract:
+            op = CodegenBinaryOp_SUB;
             break;
-        }
-        case IRInstructionType_Binary: {
-            CodegenOperand left = codegen_convert_val(instruction.value.binary.left, instructions);
-            CodegenOperand right = codegen_convert_val(instruction.value.binary.right, instructions);
-            CodegenOperand dst = codegen_convert_val(instruction.value.binary.dst, instructions);
-
-            CodegenBinaryOp op;
-            switch (instruction.value.binary.op) {
-                case IRBinaryOp_Add:
-                    op = CodegenBinaryOp_ADD;
-                    break;
-                case IRBinaryOp_Subtract:
-                    op = CodegenBinaryOp_SUB;
-                    break;
-                case IRBinaryOp_Multiply:
-                    op = CodegenBinaryOp_MUL;
-                    break;
-                case IRBinaryOp_Divide:
-                    op = CodegenBinaryOp_DIV;
-                    break;
-                case IRBinaryOp_Mod:
-                    op = CodegenBinaryOp_MOD;
-                    break;
-                case IRBinaryOp_BitwiseAnd:
-                    op = CodegenBinaryOp_BITWISE_AND;
-                    break;
-                case IRBinaryOp_BitwiseOr:
-                    op = CodegenBinaryOp_BITWISE_OR;
-                    break;
-                case IRBinaryOp_BitwiseXor:
-                    op = CodegenBinaryOp_BITWISE_XOR;
-                    break;
-                case IRBinaryOp_LeftShift:
-                    op = CodegenBinaryOp_LEFT_SHIFT;
-                    break;
-                case IRBinaryOp_RightShift:
-                    op = CodegenBinaryOp_RIGHT_SHIFT;
-                    break;
-                case IRBinaryOp_Equal:
-                    op = CodegenBinaryOp_EQUAL;
-                    break;
-                case IRBinaryOp_NotEqual:
-                    op = CodegenBinaryOp_NOT_EQUAL;
-                    break;
-                case IRBinaryOp_Less:
-                    op = CodegenBinaryOp_LESS;
-                    break;
-                case IRBinaryOp_LessEqual:
-                    op = CodegenBinaryOp_LESS_EQUAL;
-                    break;
-                case IRBinaryOp_Greater:
-                    op = CodegenBinaryOp_GREATER;
-                    break;
-                case IRBinaryOp_GreaterEqual:
-                    op = CodegenBinaryOp_GREATER_EQUAL;
-                    break;
-
-                default:
-                    op = CodegenBinaryOp_ADD;
-                    break;
-            }
-
-            CodegenInstruction binary_instruction = {
-                .type = CodegenInstructionType_BINARY,
-                .value = {
-                    .binary = {
-                        .op = op,
-                        .left = left,
-                        .right = right,
-                        .dst = dst,
-                    },
-                },
-            };
-
-            vecptr_push(instructions, binary_instruction);
-
+        case IRBinaryOp_Multiply:
+            op = CodegenBinaryOp_MUL;
+            break;
+        case IRBinaryOp_Divide:
+            op = CodegenBinaryOp_DIV;
+            break;
+        case IRBinaryOp_Mod:
+            op = CodegenBinaryOp_MOD;
+            break;
+        case IRBinaryOp_BitwiseAnd:
+            op = CodegenBinaryOp_BITWISE_AND;
+            break;
+        case IRBinaryOp_BitwiseOr:
+            op = CodegenBinaryOp_BITWISE_OR;
+            break;
+        case IRBinaryOp_BitwiseXor:
+            op = CodegenBinaryOp_BITWISE_XOR;
+            break;
+        case IRBinaryOp_LeftShift:
+            op = CodegenBinaryOp_LEFT_SHIFT;
+            break;
+        case IRBinaryOp_RightShift:
+            op = CodegenBinaryOp_RIGHT_SHIFT;
+            break;
+        case IRBinaryOp_Equal:
+            op = CodegenBinaryOp_EQUAL;
+            break;
+        case IRBinaryOp_NotEqual:
+            op = CodegenBinaryOp_NOT_EQUAL;
+            break;
+        case IRBinaryOp_Less:
+            op = CodegenBinaryOp_LESS;
+            break;
+        case IRBinaryOp_LessEqual:
+            op = CodegenBinaryOp_LESS_EQUAL;
+            break;
+        case IRBinaryOp_Greater:
+            op = CodegenBinaryOp_GREATER;
+            break;
+        case IRBinaryOp_GreaterEqual:
+            op = CodegenBinaryOp_GREATER_EQUAL;
             break;
-        }
-        case IRInstructionType_Copy: {
-            CodegenOperand src = codegen_convert_val(instruction.value.copy.src, instructions);
-            CodegenOperand dst = codegen_convert_val(instruction.value.copy.dst, instructions);
 
-            CodegenInstruction mov_instruction = {
-                .type = CodegenInstructionType_MOV,
-                .value = {
-                    .two_op = {
-                        .source = src,
-                        .destination = dst,
-                    },
-                },
-            };
+        default:
+            op = CodegenBinaryOp_ADD;
+            break;
+    }
 
-            vecptr_push(instructions, mov_instruction);
+    return op;
+}
 
-            break;
-        }
+void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody* instructions) {
+    switch (instruction.type) {
         case IRInstructionType_Jump: {
             CodegenInstruction jmp_instruction = {
                 .type = CodegenInstructionType_JUMP,
@@ -286,38 +213,6 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
 
             break;
         } 
-        case IRInstructionType_JumpIfZero:
-        case IRInstructionType_JumpIfNotZero: {
-            int is_zero = instruction.type == IRInstructionType_JumpIfZero;
-
-            CodegenOperand src = codegen_convert_val(instruction.value.jump_cond.val, instructions);
-
-            CodegenInstruction cmp_instruction = {
-                .type = CodegenInstructionType_CMP,
-                .value = {
-                    .cmp = {
-                        .left = src,
-                        .right = {CodegenOperandType_REGISTER, .value.num = 0},
-                    },
-                },
-            };
-
-            vecptr_push(instructions, cmp_instruction);
-
-            CodegenInstruction jc_instruction = {
-                .type = CodegenInstructionType_JUMP_COND,
-                .value = {
-                    .jump_cond = {
-                        .cond = is_zero ? CodegenCondCode_EQ : CodegenCondCode_NE,
-                        .label = instruction.value.jump_cond.label,
-                    },
-                },
-            };
-
-            vecptr_push(instructions, jc_instruction);
-
-            break;
-        }
         case IRInstructionType_Label: {
             CodegenInstruction label_instruction = {
                 .type = CodegenInstructionType_LABEL,
@@ -333,17 +228,6 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
         case IRInstructionType_Call: {
             // r3, r4, r5, r6, r7, r8, r9
             int args_len = instruction.value.call.args.length;
-            int stack_padding = 0;
-            if (args_len > 7 && args_len % 2 == 0) { // if there is an odd amount of stack args
-                stack_padding = 8;
-                CodegenInstruction alloc = {
-                    .type = CodegenInstructionType_ALLOCATE_STACK,
-                    .value = {
-                        .immediate = stack_padding
-                    }
-                };
-                vecptr_push(instructions, alloc);
-            }
             for (int reg=0;reg<7 && reg<args_len;reg++) {
                 CodegenOperand arg = codegen_convert_val(instruction.value.call.args.data[reg], instructions);
                 CodegenInstruction mov = {
@@ -369,10 +253,10 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
                     .num = 2
                 }
             };
-            for (int arg_n=args_len-1;arg_n>=7;arg_n++) {
+            for (int arg_n=args_len-1;arg_n>=7;arg_n--) {
                 CodegenOperand arg = codegen_convert_val(instruction.value.call.args.data[arg_n], instructions);
                 CodegenOperand pushing = arg;
-                if (arg.type != CodegenOperandType_IMMEDIATE && arg.type != CodegenOperandType_REGISTER) {
+                if (arg.type != CodegenOperandType_REGISTER) { // push only takes a register
                     CodegenInstruction mov = {
                         .type = CodegenInstructionType_MOV,
                         .value = {
@@ -398,7 +282,8 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
                 .type = CodegenInstructionType_CALL,
                 .value = {
                     .call = {
-                        .name = instruction.value.call.name
+                        .name = instruction.value.call.name,
+                        .arg_count = args_len,
                     }
                 }
             };
@@ -406,7 +291,7 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
 
             int stack_len = args_len - 7 > 0 ? args_len - 7 : 0;
 
-            int bytes_to_remove = 8 * stack_len + stack_padding;
+            int bytes_to_remove = 2 * stack_len;
             if (bytes_to_remove > 0) {
                 CodegenInstruction de_al = {
                     .type = CodegenInstructionType_DEALLOCATE_STACK,
@@ -428,9 +313,10 @@ void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody
                 }
             };
             vecptr_push(instructions, mov);
+            break;
         }
-        //default:
-        //    break;
+        default:
+            break;
     }
 }
 
@@ -449,4 +335,4 @@ CodegenOperand codegen_convert_val(IRVal val, CodegenFunctionBody* instructions)
         default:
             return (CodegenOperand){0};
     }
-}
\ No newline at end of file
+}
@@ -3,6 +3,8 @@
 
 #include "../ir.h"
 #include "../easy_stuff.h"
+#include "../semantic_analysis/type_checking.h"
+#include "../optimization/ir_analysis.h"
 
 typedef enum CodegenOperandType {
     CodegenOperandType_REGISTER,
@@ -47,6 +49,7 @@ typedef enum CodegenInstructionType {
     CodegenInstructionType_JUMP_COND,
     CodegenInstructionType_LABEL,
     CodegenInstructionType_CALL,
+    CodegenInstructionType_JUMP_TABLE,
 } CodegenInstructionType;
 
 typedef enum CodegenUnaryOp {
@@ -109,8 +112,15 @@ typedef union CodegenInstructionValue {
     } cmp; // functionally the same as two_op, but semantically different
     struct {
         char* name;
+        int arg_count; // so we know which of r3-r9 the call reads
     } call;
     CodegenOperand single;
+    struct {
+        CodegenOperand index;
+        char* table;
+        char** labels;
+        int count;
+    } jump_table; // the emitter expands it through r10/r11 into `jmp table + 3 * index` and the table of jmps
 } CodegenInstructionValue;
 
 typedef struct CodegenInstruction {
@@ -124,6 +134,8 @@ typedef struct CodegenFunctionDefinition {
     char* identifier;
     int global;
     CodegenFunctionBody body;
+    int frameless; // no r15 frame pointer, so no prologue and a bare ret (see frame.c)
+    int param_count; // params past the 7th came in on the stack, which a tail call can reuse
 } CodegenFunctionDefinition;
 
 typedef struct CodegenStatic {
@@ -149,11 +161,14 @@ typedef struct CodegenProgram {
     int capacity;
 } CodegenProgram;
 
-CodegenProgram codegen_generate_program(IRProgram program);
-CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition function);
+CodegenProgram codegen_generate_program(IRProgram program, TCSymbols* symbols);
+CodegenFunctionDefinition codegen_generate_function(IRFunctionDefinition function, TCSymbols* symbols);
 CodegenStatic codegen_generate_static(IRStaticVariable var);
-// takes statement and vec of instructions and returns the number of instructions
+// labels, jumps and calls; everything that computes a value goes through instruction selection
 void codegen_generate_instruction(IRInstruction instruction, CodegenFunctionBody* instructions);
+CodegenUnaryOp codegen_convert_op(IRUnaryOp op);
+CodegenBinaryOp codegen_convert_binary_op(IRBinaryOp op);
+CodegenCondCode codegen_invert_cond(CodegenCondCode cond);
 CodegenOperand codegen_convert_val(IRVal val, CodegenFunctionBody* instructions);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "codegen_analysis.h"
+#include "../easy_stuff.h"
+
+int cg_allocatable_register(int i) {
+    // r13 first, since args and return values pin down the low ones anyway
+    int registers[CG_ALLOCATABLE_COUNT] = {13, 2, 9, 8, 7, 6, 5, 4, 3};
+    return registers[i];
+}
+
+int cg_is_allocatable(int reg) {
+    return (reg >= 2 && reg <= 9) || reg == 13;
+}
+
+void cg_instruction_operands(CodegenInstruction* instruction, CodegenOperandRefs* uses, CodegenOperandRefs* defs) {
+    switch (instruction->type) {
+        case CodegenInstructionType_MOV:
+        case CodegenInstructionType_LDI:
+            vecptr_push(uses, &instruction->value.two_op.source);
+            vecptr_push(defs, &instruction->value.two_op.destination);
+            break;
+        case CodegenInstructionType_UNARY:
+            vecptr_push(uses, &instruction->value.unary.src);
+            vecptr_push(defs, &instruction->value.unary.dst);
+            break;
+        case CodegenInstructionType_BINARY:
+            vecptr_push(uses, &instruction->value.binary.left);
+            vecptr_push(uses, &instruction->value.binary.right);
+            vecptr_push(defs, &instruction->value.binary.dst);
+            break;
+        case CodegenInstructionType_LOD:
+            vecptr_push(uses, &instruction->value.mem.address);
+            vecptr_push(defs, &instruction->value.mem.reg);
+            break;
+        case CodegenInstructionType_STR:
+            vecptr_push(uses, &instruction->value.mem.address);
+            vecptr_push(uses, &instruction->value.mem.reg);
+            break;
+        case CodegenInstructionType_CMP:
+            vecptr_push(uses, &instruction->value.cmp.left);
+            vecptr_push(uses, &instruction->value.cmp.right);
+            break;
+        case CodegenInstructionType_PUSH:
+            vecptr_push(uses, &instruction->value.single);
+            break;
+        case CodegenInstructionType_JUMP_TABLE:
+            vecptr_push(uses, &instruction->value.jump_table.index);
+            break;
+        case CodegenInstructionType_ALLOCATE_STACK:
+        case CodegenInstructionType_DEALLOCATE_STACK:
+        case CodegenInstructionType_RET:
+        case CodegenInstructionType_JUMP:
+        case CodegenInstructionType_JUMP_COND:
+        case CodegenInstructionType_LABEL:
+        case CodegenInstructionType_CALL:
+            break;
+    }
+}
+
+int cg_is_move(CodegenInstruction* instruction) {
+    return instruction->type == CodegenInstructionType_MOV;
+}
+
+int cg_operand_node(CGFunctionInfo* info, CodegenOperand operand) {
+    switch (operand.type) {
+        case CodegenOperandType_REGISTER:
+            return cg_is_allocatable(operand.value.num) ? operand.value.num : -1;
+        case CodegenOperandType_PSEUDO:
+            return string_map_get(&info->pseudo_indices, operand.value.identifier);
+        default:
+            return -1;
+    }
+}
+
+void cg_add_pseudo(CGFunctionInfo* info, CodegenOperand operand, TCSymbols* symbols) {
+    if (operand.type != CodegenOperandType_PSEUDO || string_map_get(&info->pseudo_indices, operand.value.identifier) != -1) {
+        return;
+    }
+    // statics live in memory no matter what
+    if (ir_is_static_var(operand.value.identifier, symbols)) {
+        return;
+    }
+
+    int pseudo = info->node_count - CG_REGISTER_COUNT;
+    info->names = realloc(info->names, sizeof(char*) * (pseudo + 1));
+    info->names[pseudo] = operand.value.identifier;
+    string_map_set(&info->pseudo_indices, operand.value.identifier, info->node_count);
+    info->node_count++;
+}
+
+void cg_push_node(IntVec* nodes, int node) {
+    if (node != -1) {
+        vecptr_push(nodes, node);
+    }
+}
+
+void cg_build_blocks(CGFunctionInfo* info) {
+    CodegenFunctionBody* body = info->body;
+    int* instruction_blocks = malloc_n_type(int, body->length + 1);
+    StringMap labels = string_map_new();
+
+    int start = 0;
+    for (int i = 0; i <= body->length; i++) {
+        int split = i == body->length;
+        if (!split && i > start && body->data[i].type == CodegenInstructionType_LABEL) {
+            split = true;
+        }
+        if (!split && i > start) {
+            CodegenInstructionType prev = body->data[i - 1].type;
+            split = prev == CodegenInstructionType_JUMP || prev == CodegenInstructionType_JUMP_COND || prev == CodegenInstructionType_RET ||
+                prev == CodegenInstructionType_JUMP_TABLE;
+        }
+
+        if (split && (i > start || info->blocks.length == 0)) {
+            CGBlock block = {.start = start, .end = i};
+            vec_push(info->blocks, block);
+            start = i;
+        }
+
+        if (i < body->length) {
+            instruction_blocks[i] = info->blocks.length;
+            if (body->data[i].type == CodegenInstructionType_LABEL) {
+                string_map_set(&labels, body->data[i].value.str, info->blocks.length);
+            }
+        }
+    }
+
+    for (int b = 0; b < info->blocks.length; b++) {
+        CGBlock* block = &info->blocks.data[b];
+        if (block->end == block->start) {
+            continue;
+        }
+
+        CodegenInstruction* last = &body->data[block->end - 1];
+        int falls_through = last->type != CodegenInstructionType_JUMP && last->type != CodegenInstructionType_RET &&
+            last->type != CodegenInstructionType_JUMP_TABLE;
+        char** targets = NULL;
+        int target_count = 0;
+        if (last->type == CodegenInstructionType_JUMP) {
+            targets = &last->value.str;
+            target_count = 1;
+        } else if (last->type == CodegenInstructionType_JUMP_COND) {
+            targets = &last->value.jump_cond.label;
+            target_count = 1;
+        } else if (last->type == CodegenInstructionType_JUMP_TABLE) {
+            targets = last->value.jump_table.labels;
+            target_count = last->value.jump_table.count;
+        }
+
+        for (int t = 0; t < target_count; t++) {
+            int target_block = string_map_get(&labels, targets[t]);
+            if (target_block == -1) {
+                fprintf(stderr, "Jump to unknown label %s\n", targets[t]);
+                exit(1);
+            }
+            int seen = false;
+            for (int k = 0; k < block->successors.length; k++) {
+                seen |= block->successors.data[k] == target_block;
+            }
+            if (!seen) {
+                vec_push(block->successors, target_block);
+            }
+        }
+        if (falls_through && b + 1 < info->blocks.length) {
+            vec_push(block->successors, b + 1);
+        }
+    }
+
+    // anything between a label and a jump back to it is in a loop
+    int* depth_change = calloc(body->length + 1, sizeof(int));
+    for (int i = 0; i < body->length; i++) {
+        char** targets = NULL;
+        int target_count = 0;
+        if (body->data[i].type == CodegenInstructionType_JUMP) {
+            targets = &body->data[i].value.str;
+            target_count = 1;
+        } else if (body->data[i].type == CodegenInstructionType_JUMP_COND) {
+            targets = &body->data[i].value.jump_cond.label;
+            target_count = 1;
+        } else if (body->data[i].type == CodegenInstructionType_JUMP_TABLE) {
+            targets = body->data[i].value.jump_table.labels;
+            target_count = body->data[i].value.jump_table.count;
+        }
+
+        for (int t = 0; t < target_count; t++) {
+            int target_start = info->blocks.data[string_map_get(&labels, targets[t])].start;
+            if (target_start <= i) {
+                depth_change[target_start]++;
+                depth_change[i + 1]--;
+            }
+        }
+    }
+
+    int depth = 0;
+    for (int i = 0; i < body->length; i++) {
+        depth += depth_change[i];
+        info->loop_depth[i] = depth;
+    }
+
+    free(depth_change);
+    free(instruction_blocks);
+    string_map_free(labels);
+}
+
+void cg_compute_liveness(CGFunctionInfo* info) {
+    int words = bitset_words(info->node_count);
+    info->words = words;
+    info->live_in = calloc((size_t)(info->blocks.length * words), sizeof(unsigned int));
+    info->live_out = calloc((size_t)(info->blocks.length * words), sizeof(unsigned int));
+    unsigned int* live = malloc_n_type(unsigned int, words);
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = info->blocks.length - 1; b >= 0; b--) {
+            CGBlock* block = &info->blocks.data[b];
+            unsigned int* out = &info->live_out[b * words];
+            unsigned int* in = &info->live_in[b * words];
+
+            memset(out, 0, words * sizeof(unsigned int));
+            for (int s = 0; s < block->successors.length; s++) {
+                unsigned int* succ_in = &info->live_in[block->successors.data[s] * words];
+                for (int w = 0; w < words; w++) {
+                    out[w] |= succ_in[w];
+                }
+            }
+
+            memcpy(live, out, words * sizeof(unsigned int));
+            for (int i = block->end - 1; i >= block->start; i--) {
+                for (int d = 0; d < info->defs[i].length; d++) {
+                    bitset_remove(live, info->defs[i].data[d]);
+                }
+                for (int u = 0; u < info->uses[i].length; u++) {
+                    bitset_add(live, info->uses[i].data[u]);
+                }
+            }
+
+            if (memcmp(live, in, words * sizeof(unsigned int))) {
+                memcpy(in, live, words * sizeof(unsigned int));
+                changed = true;
+            }
+        }
+    }
+
+    free(live);
+}
+
+CGFunctionInfo cg_analyze_function(CodegenFunctionDefinition* function, TCSymbols* symbols) {
+    CodegenFunctionBody* body = &function->body;
+    CGFunctionInfo info = {
+        .body = body,
+        .pseudo_indices = string_map_new(),
+        .names = NULL,
+        .node_count = CG_REGISTER_COUNT,
+        .uses = calloc(body->length + 1, sizeof(IntVec)),
+        .defs = calloc(body->length + 1, sizeof(IntVec)),
+        .loop_depth = calloc(body->length + 1, sizeof(int)),
+        .blocks = {0},
+    };
+
+    CodegenOperandRefs uses = {0};
+    CodegenOperandRefs defs = {0};
+
+    for (int i = 0; i < body->length; i++) {
+        CodegenInstruction* instruction = &body->data[i];
+        uses.length = 0;
+        defs.length = 0;
+        cg_instruction_operands(instruction, &uses, &defs);
+
+        for (int u = 0; u < uses.length; u++) {
+            cg_add_pseudo(&info, *uses.data[u], symbols);
+            cg_push_node(&info.uses[i], cg_operand_node(&info, *uses.data[u]));
+        }
+        for (int d = 0; d < defs.length; d++) {
+            cg_add_pseudo(&info, *defs.data[d], symbols);
+            cg_push_node(&info.defs[i], cg_operand_node(&info, *defs.data[d]));
+        }
+
+        if (instruction->type == CodegenInstructionType_CALL) {
+            // args come in r3-r9 and the callee is free to trash every register we allocate
+            for (int a = 0; a < 7 && a < instruction->value.call.arg_count; a++) {
+                vec_push(info.uses[i], a + 3);
+            }
+            for (int r = 0; r < CG_ALLOCATABLE_COUNT; r++) {
+                vec_push(info.defs[i], cg_allocatable_register(r));
+            }
+        } else if (instruction->type == CodegenInstructionType_RET) {
+            vec_push(info.uses[i], 2);
+        }
+    }
+
+    vec_free(uses);
+    vec_free(defs);
+
+    cg_build_blocks(&info);
+    cg_compute_liveness(&info);
+
+    return info;
+}
+
+void cg_free_function_info(CGFunctionInfo* info) {
+    for (int i = 0; i < info->body->length; i++) {
+        vec_free(info->uses[i]);
+        vec_free(info->defs[i]);
+    }
+    for (int b = 0; b < info->blocks.length; b++) {
+        vec_free(info->blocks.data[b].successors);
+    }
+    free(info->uses);
+    free(info->defs);
+    free(info->loop_depth);
+    free(info->names);
+    free(info->live_in);
+    free(info->live_out);
+    vec_free(info->blocks);
+    string_map_free(info->pseudo_indices);
+}
@@ -0,0 +1,50 @@
+#ifndef CODEGEN_ANALYSIS_H
+#define CODEGEN_ANALYSIS_H
+
+#include "code_gen.h"
+#include "../string_map.h"
+#include "../optimization/ir_analysis.h"
+#include "../semantic_analysis/type_checking.h"
+
+// nodes 0-15 are the physical registers, pseudos come after them
+#define CG_REGISTER_COUNT 16
+// r2-r9 and r13. r0 is zero, r1 is reserved, r10-r12 are fixup's scratch regs, r14/r15 are sp/fp
+#define CG_ALLOCATABLE_COUNT 9
+
+typedef VEC(CodegenOperand*) CodegenOperandRefs;
+
+typedef struct CGBlock {
+    int start;
+    int end;
+    IntVec successors;
+} CGBlock;
+
+typedef struct CGFunctionInfo {
+    CodegenFunctionBody* body;
+    StringMap pseudo_indices; // name -> node
+    char** names; // node - CG_REGISTER_COUNT -> name
+    int node_count;
+    IntVec* uses; // nodes read by every instruction, including the implicit call/ret regs
+    IntVec* defs; // nodes written by every instruction
+    int* loop_depth; // per instruction, from the backwards jumps around it
+    struct {
+        CGBlock* data;
+        int length;
+        int capacity;
+    } blocks;
+    int words; // words per live set
+    unsigned int* live_in; // block * words
+    unsigned int* live_out;
+} CGFunctionInfo;
+
+int cg_allocatable_register(int i);
+int cg_is_allocatable(int reg);
+
+void cg_instruction_operands(CodegenInstruction* instruction, CodegenOperandRefs* uses, CodegenOperandRefs* defs);
+int cg_is_move(CodegenInstruction* instruction);
+
+CGFunctionInfo cg_analyze_function(CodegenFunctionDefinition* function, TCSymbols* symbols);
+int cg_operand_node(CGFunctionInfo* info, CodegenOperand operand); // -1 for things we don't track
+void cg_free_function_info(CGFunctionInfo* info);
+
+#endif
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// with a frame pointer the prologue is `push r15 / mov r14 r15` and every ret is
+// `mov r15 r14 / pop r15 / ret`, and slot s lives at r15 + s. without one, r14 is the only base:
+// after the entry allocate and whatever's been pushed for a call, slot s is at r14 + size + depth + s.
+// stack args sat past the saved r15, which isn't there anymore, so they move down a word.
+//
+// that only works if the depth is the same however an instruction is reached, which holds as long as
+// pushes and their deallocate never straddle a label or jump, which is how calls get emitted.
+//
+// without a frame pointer, `call g / ret` can also become `deallocate size / jmp g`, so g returns
+// straight to our caller. g's stack args then have to go where ours came in, so that needs at least as
+// many incoming stack args as g takes, and nothing may read ours once the first of g's is written.
+
+int frame_is_fp(CodegenOperand operand) {
+    return operand.type == CodegenOperandType_REGISTER && operand.value.num == 15;
+}
+
+// whether anything besides a lod/str base reads or writes r15
+int frame_uses_fp(CodegenInstruction* instruction) {
+    switch (instruction->type) {
+        case CodegenInstructionType_MOV:
+        case CodegenInstructionType_LDI:
+            return frame_is_fp(instruction->value.two_op.source) || frame_is_fp(instruction->value.two_op.destination);
+        case CodegenInstructionType_UNARY:
+            return frame_is_fp(instruction->value.unary.src) || frame_is_fp(instruction->value.unary.dst);
+        case CodegenInstructionType_BINARY:
+            return frame_is_fp(instruction->value.binary.left) || frame_is_fp(instruction->value.binary.right) ||
+                frame_is_fp(instruction->value.binary.dst);
+        case CodegenInstructionType_CMP:
+            return frame_is_fp(instruction->value.cmp.left) || frame_is_fp(instruction->value.cmp.right);
+        case CodegenInstructionType_PUSH:
+            return frame_is_fp(instruction->value.single);
+        case CodegenInstructionType_LOD:
+        case CodegenInstructionType_STR:
+            return frame_is_fp(instruction->value.mem.reg);
+        default:
+            return false;
+    }
+}
+
+// for a call followed by nothing but its deallocate and ret, the number of stack args it passes,
+// or -1 if it can't be a tail call. pushes[] gets the index of each of those pushes, arg 7 first
+int frame_tail_call(CodegenFunctionDefinition* function, int index, int* pushes) {
+    CodegenFunctionBody* body = &function->body;
+    int args = body->data[index].value.call.arg_count;
+    int stack_args = args > 7 ? args - 7 : 0;
+
+    int next = index + 1;
+    if (stack_args > 0) {
+        if (next >= body->length || body->data[next].type != CodegenInstructionType_DEALLOCATE_STACK ||
+            body->data[next].value.immediate != 2 * stack_args) {
+            return -1;
+        }
+        next++;
+    }
+    if (next >= body->length || body->data[next].type != CodegenInstructionType_RET) {
+        return -1;
+    }
+
+    int incoming = function->param_count > 7 ? function->param_count - 7 : 0;
+    if (stack_args > incoming) {
+        return -1;
+    }
+
+    // pushes go last arg first, so the closest one before the call is arg 7
+    int found = 0;
+    for (int i = index - 1; i >= 0 && found < stack_args; i--) {
+        CodegenInstructionType type = body->data[i].type;
+        if (type == CodegenInstructionType_LABEL || type == CodegenInstructionType_JUMP ||
+            type == CodegenInstructionType_JUMP_COND || type == CodegenInstructionType_JUMP_TABLE ||
+            type == CodegenInstructionType_CALL) {
+            return -1;
+        }
+        if (type == CodegenInstructionType_PUSH) {
+            pushes[found++] = i;
+        }
+    }
+    if (found < stack_args) {
+        return -1;
+    }
+
+    // our stack args get overwritten from the first push on
+    for (int i = stack_args > 0 ? pushes[stack_args - 1] : index; i < index; i++) {
+        CodegenInstruction* instruction = &body->data[i];
+        if (instruction->type == CodegenInstructionType_LOD && frame_is_fp(instruction->value.mem.address) &&
+            instruction->value.mem.offset.num > 0) {
+            return -1;
+        }
+    }
+
+    return stack_args;
+}
+
+int frame_function(CodegenFunctionDefinition* function, int* tail_calls) {
+    CodegenFunctionBody* body = &function->body;
+
+    int size = 0;
+    int start = 0;
+    if (body->length > 0 && body->data[0].type == CodegenInstructionType_ALLOCATE_STACK) {
+        size = body->data[0].value.immediate;
+        start = 1;
+    }
+
+    // check the depth is known everywhere before touching anything
+    int depth = 0;
+    for (int i = start; i < body->length; i++) {
+        CodegenInstruction* instruction = &body->data[i];
+        if (frame_uses_fp(instruction)) {
+            return false;
+        }
+
+        switch (instruction->type) {
+            case CodegenInstructionType_PUSH:
+                depth += 2;
+                break;
+            case CodegenInstructionType_DEALLOCATE_STACK:
+                depth -= instruction->value.immediate;
+                break;
+            case CodegenInstructionType_ALLOCATE_STACK:
+                return false;
+            case CodegenInstructionType_LABEL:
+            case CodegenInstructionType_JUMP:
+            case CodegenInstructionType_JUMP_COND:
+            case CodegenInstructionType_JUMP_TABLE:
+            case CodegenInstructionType_RET:
+                if (depth != 0) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // per instruction: -1 for untouched, otherwise which of a tail call's stack args a push is,
+    // and for a tail call how many instructions after it (deallocate, ret) go away
+    int* tail = malloc(sizeof(int) * (body->length + 1));
+    int* pushes = malloc(sizeof(int) * (body->length + 1));
+    for (int i = 0; i < body->length; i++) {
+        tail[i] = -1;
+    }
+    for (int i = start; i < body->length; i++) {
+        if (body->data[i].type != CodegenInstructionType_CALL) {
+            continue;
+        }
+        int stack_args = frame_tail_call(function, i, pushes);
+        if (stack_args < 0) {
+            continue;
+        }
+        for (int a = 0; a < stack_args; a++) {
+            tail[pushes[a]] = a;
+        }
+        tail[i] = stack_args > 0 ? 2 : 1;
+        (*tail_calls)++;
+    }
+
+    CodegenFunctionBody new_body = {NULL, 0, 0};
+    depth = 0;
+    for (int i = 0; i < body->length; i++) {
+        CodegenInstruction instruction = body->data[i];
+
+        switch (instruction.type) {
+            case CodegenInstructionType_PUSH:
+                if (tail[i] >= 0) {
+                    // straight into where our own stack arg tail[i] came in, past the return address
+                    CodegenInstruction store = {
+                        .type = CodegenInstructionType_STR,
+                        .value.mem = {
+                            .address = {CodegenOperandType_REGISTER, .value.num = 14},
+                            .offset.num = 4 + 2 * tail[i] + size + depth,
+                            .reg = instruction.value.single,
+                        },
+                    };
+                    instruction = store;
+                    break;
+                }
+                depth += 2;
+                break;
+            case CodegenInstructionType_CALL:
+                if (tail[i] >= 0) {
+                    if (size > 0) {
+                        CodegenInstruction deallocate = {
+                            .type = CodegenInstructionType_DEALLOCATE_STACK,
+                            .value.immediate = size,
+                        };
+                        vec_push(new_body, deallocate);
+                    }
+                    CodegenInstruction jump = {
+                        .type = CodegenInstructionType_JUMP,
+                        .value.str = instruction.value.call.name,
+                    };
+                    vec_push(new_body, jump);
+                    i += tail[i];
+                    continue;
+                }
+                break;
+            case CodegenInstructionType_DEALLOCATE_STACK:
+                depth -= instruction.value.immediate;
+                break;
+            case CodegenInstructionType_LOD:
+            case CodegenInstructionType_STR:
+                if (frame_is_fp(instruction.value.mem.address)) {
+                    int offset = instruction.value.mem.offset.num;
+                    instruction.value.mem.address.value.num = 14;
+                    instruction.value.mem.offset.num = (offset > 0 ? offset - 2 : offset) + size + depth;
+                }
+                break;
+            case CodegenInstructionType_RET:
+                if (size > 0) {
+                    CodegenInstruction deallocate = {
+                        .type = CodegenInstructionType_DEALLOCATE_STACK,
+                        .value.immediate = size,
+                    };
+                    vec_push(new_body, deallocate);
+                }
+                break;
+            default:
+                break;
+        }
+
+        vec_push(new_body, instruction);
+    }
+
+    vec_free(*body);
+    *body = new_body;
+    function->frameless = true;
+
+    free(tail);
+    free(pushes);
+
+    return true;
+}
+
+CodegenProgram frame_program(CodegenProgram program) {
+    int functions = 0;
+    int frameless = 0;
+    int tail_calls = 0;
+
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == CGTFunction) {
+            CodegenFunctionDefinition* function = &program.data[i].val.function;
+            int before = tail_calls;
+            functions++;
+            if (frame_function(function, &tail_calls)) {
+                frameless++;
+                remark(RemarkKind_Passed, "frame", "FramePointerOmitted", function->identifier,
+                    "frame pointer omitted, %d calls turned into jumps", tail_calls - before);
+            } else {
+                remark(RemarkKind_Missed, "frame", "FramePointerKept", function->identifier,
+                    "frame pointer kept, r15 is used directly or the stack depth isn't the same everywhere");
+            }
+        }
+    }
+
+    remark_stats("frame pointer omitted in %d of %d functions\n", frameless, functions);
+    remark_stats("tail calls turned into jumps: %d\n", tail_calls);
+
+    return program;
+}
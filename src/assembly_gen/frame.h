@@ -0,0 +1,12 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "code_gen.h"
+
+// drops the r15 frame pointer from every function whose stack depth is known at each instruction,
+// addressing slots and stack args off r14 instead. runs last, on fixed up code
+CodegenProgram frame_program(CodegenProgram program);
+// returns whether the function went frameless, and adds the calls it turned into jumps to tail_calls
+int frame_function(CodegenFunctionDefinition* function, int* tail_calls);
+
+#endif
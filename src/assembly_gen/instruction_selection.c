@@ -0,0 +1,584 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instruction_selection.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// tree pattern instruction selection
+//
+// a temp that's defined once, used once, later in the same block, and whose operands don't change
+// in between gets pulled into the expression that uses it, so every block turns into a forest of
+// expression trees. each tree is labeled bottom up with the cheapest rule for every nonterminal
+// (the iburg way, dynamic programming over the rule table below), then reduced top down from
+// whatever the root needs: a value for copies/returns, a comparison for branches.
+//
+// that's what lets !(a < b) become one gte, a branch on !x a cmp + jc eq, x + 0 a plain copy,
+// and constant subtrees fold into a single immediate.
+
+#define ISEL_INFINITE (INT_MAX / 4)
+
+int isel_is_const(ISelNode* node, int value) {
+    return node->kind == ISelNodeKind_CONST && node->val.value.integer == value;
+}
+
+int isel_is_compare(int op) {
+    return op >= IRBinaryOp_Equal && op <= IRBinaryOp_GreaterEqual;
+}
+
+int isel_match_negated_one(ISelNode* node) {
+    return node->op == IRUnaryOp_Negate && isel_is_const(node->kids[0], 1);
+}
+
+int isel_match_arith_unary(ISelNode* node) {
+    return node->op == IRUnaryOp_Negate || node->op == IRUnaryOp_Complement;
+}
+
+int isel_match_not(ISelNode* node) {
+    return node->op == IRUnaryOp_Not;
+}
+
+int isel_match_compare(ISelNode* node) {
+    return isel_is_compare(node->op);
+}
+
+// x op 0 == x
+int isel_match_right_identity(ISelNode* node) {
+    switch (node->op) {
+        case IRBinaryOp_Add:
+        case IRBinaryOp_Subtract:
+        case IRBinaryOp_BitwiseOr:
+        case IRBinaryOp_BitwiseXor:
+        case IRBinaryOp_LeftShift:
+        case IRBinaryOp_RightShift:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 0 op x == x
+int isel_match_left_identity(ISelNode* node) {
+    return node->op == IRBinaryOp_Add || node->op == IRBinaryOp_BitwiseOr || node->op == IRBinaryOp_BitwiseXor;
+}
+
+int isel_match_annihilate(ISelNode* node) {
+    return node->op == IRBinaryOp_Multiply || node->op == IRBinaryOp_BitwiseAnd;
+}
+
+int isel_match_subtract(ISelNode* node) {
+    return node->op == IRBinaryOp_Subtract;
+}
+
+int isel_match_xor(ISelNode* node) {
+    return node->op == IRBinaryOp_BitwiseXor;
+}
+
+ISelRule isel_rules[] = {
+    {ISelRule_REG_VAR, ISelNonterminal_REG, false, ISelNodeKind_VAR, NULL, 0, {0}, 0},
+    {ISelRule_REG_CONST, ISelNonterminal_REG, false, ISelNodeKind_CONST, NULL, 0, {0}, 1},
+    {ISelRule_ZERO_CONST, ISelNonterminal_ZERO, false, ISelNodeKind_CONST, NULL, 0, {0}, 0},
+    {ISelRule_ONES_NEGATED_ONE, ISelNonterminal_ONES, false, ISelNodeKind_UNARY, isel_match_negated_one, 0, {0}, 0},
+    {ISelRule_REG_UNARY, ISelNonterminal_REG, false, ISelNodeKind_UNARY, isel_match_arith_unary, 1, {ISelNonterminal_REG}, 1},
+    {ISelRule_REG_BINARY, ISelNonterminal_REG, false, ISelNodeKind_BINARY, NULL, 2, {ISelNonterminal_REG, ISelNonterminal_REG}, 1},
+    {ISelRule_REG_IDENTITY_RIGHT, ISelNonterminal_REG, false, ISelNodeKind_BINARY, isel_match_right_identity, 2, {ISelNonterminal_REG, ISelNonterminal_ZERO}, 0},
+    {ISelRule_REG_IDENTITY_LEFT, ISelNonterminal_REG, false, ISelNodeKind_BINARY, isel_match_left_identity, 2, {ISelNonterminal_ZERO, ISelNonterminal_REG}, 0},
+    {ISelRule_ZERO_ANNIHILATE, ISelNonterminal_ZERO, false, ISelNodeKind_BINARY, isel_match_annihilate, 2, {ISelNonterminal_REG, ISelNonterminal_ZERO}, 0},
+    {ISelRule_ZERO_ANNIHILATE, ISelNonterminal_ZERO, false, ISelNodeKind_BINARY, isel_match_annihilate, 2, {ISelNonterminal_ZERO, ISelNonterminal_REG}, 0},
+    {ISelRule_REG_NEGATE, ISelNonterminal_REG, false, ISelNodeKind_BINARY, isel_match_subtract, 2, {ISelNonterminal_ZERO, ISelNonterminal_REG}, 1},
+    {ISelRule_REG_COMPLEMENT, ISelNonterminal_REG, false, ISelNodeKind_BINARY, isel_match_xor, 2, {ISelNonterminal_REG, ISelNonterminal_ONES}, 1},
+    {ISelRule_REG_COMPLEMENT, ISelNonterminal_REG, false, ISelNodeKind_BINARY, isel_match_xor, 2, {ISelNonterminal_ONES, ISelNonterminal_REG}, 1},
+    {ISelRule_COND_COMPARE, ISelNonterminal_COND, false, ISelNodeKind_BINARY, isel_match_compare, 2, {ISelNonterminal_REG, ISelNonterminal_REG}, 0},
+    {ISelRule_COND_NOT, ISelNonterminal_COND, false, ISelNodeKind_UNARY, isel_match_not, 1, {ISelNonterminal_COND}, 0},
+    {ISelRule_REG_ZERO, ISelNonterminal_REG, true, 0, NULL, 1, {ISelNonterminal_ZERO}, 0},
+    {ISelRule_COND_REG, ISelNonterminal_COND, true, 0, NULL, 1, {ISelNonterminal_REG}, 0}, // x != 0
+    {ISelRule_REG_COND, ISelNonterminal_REG, true, 0, NULL, 1, {ISelNonterminal_COND}, 1}, // one compare op into a register
+};
+
+#define ISEL_RULE_COUNT ((int)(sizeof(isel_rules) / sizeof(isel_rules[0])))
+
+ISelNode* isel_node_new(ISelNodeKind kind, IRVal val) {
+    ISelNode* node = calloc(1, sizeof(ISelNode));
+    node->kind = kind;
+    node->val = val;
+    return node;
+}
+
+void isel_node_free(ISelNode* node) {
+    if (node == NULL) {
+        return;
+    }
+    isel_node_free(node->kids[0]);
+    isel_node_free(node->kids[1]);
+    free(node);
+}
+
+int isel_reads(ISelNode* node, char* name) {
+    if (node == NULL) {
+        return false;
+    }
+    if (node->kind == ISelNodeKind_VAR) {
+        return !strcmp(node->val.value.var, name);
+    }
+    return isel_reads(node->kids[0], name) || isel_reads(node->kids[1], name);
+}
+
+int isel_reads_static(ISelContext* context, ISelNode* node) {
+    if (node == NULL) {
+        return false;
+    }
+    if (node->kind == ISelNodeKind_VAR) {
+        IRVarInfo* info = ir_var_info_get(context->vars, node->val.value.var);
+        return info == NULL || info->is_static;
+    }
+    return isel_reads_static(context, node->kids[0]) || isel_reads_static(context, node->kids[1]);
+}
+
+// constant subtrees become one constant, as long as the result is something ldi can take
+// and 16 bit wraparound or signedness can't make it come out differently
+int isel_fold_constants(ISelNode* node) {
+    for (int k = 0; k < 2; k++) {
+        if (node->kids[k] != NULL && node->kids[k]->kind != ISelNodeKind_CONST) {
+            return false;
+        }
+    }
+
+    int a = node->kids[0]->val.value.integer;
+    int result;
+    if (node->kind == ISelNodeKind_UNARY ? !ir_fold_unary(node->op, a, &result) :
+        !ir_fold_binary(node->op, a, node->kids[1]->val.value.integer, &result)) {
+        return false;
+    }
+
+    isel_node_free(node->kids[0]);
+    isel_node_free(node->kids[1]);
+    node->kids[0] = NULL;
+    node->kids[1] = NULL;
+    node->kind = ISelNodeKind_CONST;
+    node->val = (IRVal){.type = IRValType_Int, .value.integer = result};
+    return true;
+}
+
+ISelNode* isel_operand(ISelContext* context, IRVal val) {
+    if (val.type == IRValType_Int) {
+        return isel_node_new(ISelNodeKind_CONST, val);
+    }
+
+    for (int p = 0; p < context->pending.length; p++) {
+        int index = context->pending.data[p];
+        if (!strcmp(context->roots[index]->val.value.var, val.value.var)) {
+            context->folded[index] = true;
+            context->pending.data[p] = context->pending.data[--context->pending.length];
+            return context->roots[index];
+        }
+    }
+
+    return isel_node_new(ISelNodeKind_VAR, val);
+}
+
+ISelNode* isel_build(ISelContext* context, IRInstruction* instruction) {
+    ISelNode* node;
+    if (instruction->type == IRInstructionType_Unary) {
+        node = isel_node_new(ISelNodeKind_UNARY, instruction->value.unary.dst);
+        node->op = instruction->value.unary.op;
+        node->kids[0] = isel_operand(context, instruction->value.unary.src);
+    } else {
+        node = isel_node_new(ISelNodeKind_BINARY, instruction->value.binary.dst);
+        node->op = instruction->value.binary.op;
+        node->kids[0] = isel_operand(context, instruction->value.binary.left);
+        node->kids[1] = isel_operand(context, instruction->value.binary.right);
+    }
+
+    IRVal dst = node->val;
+    context->constants += isel_fold_constants(node);
+    if (node->kind == ISelNodeKind_CONST) {
+        // keep the name around in case this ends up a root that has to store it
+        ISelNode* constant = node;
+        node = isel_node_new(ISelNodeKind_BINARY, dst);
+        node->op = IRBinaryOp_Add;
+        node->kids[0] = constant;
+        node->kids[1] = isel_node_new(ISelNodeKind_CONST, (IRVal){.type = IRValType_Int, .value.integer = 0});
+    }
+
+    return node;
+}
+
+int isel_is_foldable(ISelContext* context, IRVal dst) {
+    IRVarInfo* info = ir_var_info_get(context->vars, dst.value.var);
+    return info != NULL && !info->is_static && info->defs == 1 && info->uses == 1;
+}
+
+// something wrote `name` (or a call might've written any static), so trees reading it can't move past here
+void isel_invalidate(ISelContext* context, char* name, int statics) {
+    for (int p = 0; p < context->pending.length; p++) {
+        ISelNode* root = context->roots[context->pending.data[p]];
+        if ((name != NULL && isel_reads(root, name)) || (statics && isel_reads_static(context, root))) {
+            context->pending.data[p--] = context->pending.data[--context->pending.length];
+        }
+    }
+}
+
+void isel_build_trees(ISelContext* context) {
+    IRFunctionBody* body = &context->function->body;
+    for (int i = 0; i < body->length; i++) {
+        IRInstruction* instruction = &body->data[i];
+        switch (instruction->type) {
+            case IRInstructionType_Unary:
+            case IRInstructionType_Binary: {
+                ISelNode* node = isel_build(context, instruction);
+                context->roots[i] = node;
+                isel_invalidate(context, node->val.value.var, false);
+                if (isel_is_foldable(context, node->val)) {
+                    vec_push(context->pending, i);
+                }
+                break;
+            }
+            case IRInstructionType_Copy:
+                context->roots[i] = isel_operand(context, instruction->value.copy.src);
+                if (instruction->value.copy.dst.type == IRValType_Var) {
+                    isel_invalidate(context, instruction->value.copy.dst.value.var, false);
+                }
+                break;
+            case IRInstructionType_Return:
+                context->roots[i] = isel_operand(context, instruction->value.val);
+                context->pending.length = 0;
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                context->roots[i] = isel_operand(context, instruction->value.jump_cond.val);
+                context->pending.length = 0;
+                break;
+            case IRInstructionType_JumpTable:
+                context->roots[i] = isel_operand(context, instruction->value.jump_table.index);
+                context->pending.length = 0;
+                break;
+            case IRInstructionType_Call:
+                if (instruction->value.call.dst.type == IRValType_Var) {
+                    isel_invalidate(context, instruction->value.call.dst.value.var, true);
+                } else {
+                    isel_invalidate(context, NULL, true);
+                }
+                break;
+            case IRInstructionType_Jump:
+            case IRInstructionType_Label:
+                context->pending.length = 0;
+                break;
+        }
+    }
+}
+
+void isel_label(ISelNode* node) {
+    for (int k = 0; k < 2; k++) {
+        if (node->kids[k] != NULL) {
+            isel_label(node->kids[k]);
+        }
+    }
+
+    for (int nt = 0; nt < ISelNonterminal_COUNT; nt++) {
+        node->cost[nt] = ISEL_INFINITE;
+        node->rule[nt] = -1;
+    }
+
+    for (int r = 0; r < ISEL_RULE_COUNT; r++) {
+        ISelRule* rule = &isel_rules[r];
+        if (rule->chain || rule->kind != node->kind || (rule->matches != NULL && !rule->matches(node))) {
+            continue;
+        }
+        if (rule->id == ISelRule_ZERO_CONST && !isel_is_const(node, 0)) {
+            continue;
+        }
+
+        int cost = rule->cost;
+        for (int k = 0; k < rule->kid_count; k++) {
+            cost += node->kids[k]->cost[rule->kids[k]];
+        }
+        if (cost < node->cost[rule->lhs]) {
+            node->cost[rule->lhs] = cost;
+            node->rule[rule->lhs] = r;
+        }
+    }
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int r = 0; r < ISEL_RULE_COUNT; r++) {
+            ISelRule* rule = &isel_rules[r];
+            if (!rule->chain) {
+                continue;
+            }
+            int cost = node->cost[rule->kids[0]] + rule->cost;
+            if (cost < node->cost[rule->lhs]) {
+                node->cost[rule->lhs] = cost;
+                node->rule[rule->lhs] = r;
+                changed = true;
+            }
+        }
+    }
+}
+
+CodegenBinaryOp isel_compare_op(CodegenCondCode cond) {
+    switch (cond) {
+        case CodegenCondCode_EQ:
+            return CodegenBinaryOp_EQUAL;
+        case CodegenCondCode_NE:
+            return CodegenBinaryOp_NOT_EQUAL;
+        case CodegenCondCode_LT:
+            return CodegenBinaryOp_LESS;
+        case CodegenCondCode_LE:
+            return CodegenBinaryOp_LESS_EQUAL;
+        case CodegenCondCode_GT:
+            return CodegenBinaryOp_GREATER;
+        case CodegenCondCode_GE:
+            return CodegenBinaryOp_GREATER_EQUAL;
+        default:
+            return CodegenBinaryOp_EQUAL;
+    }
+}
+
+CodegenCondCode isel_compare_cond(IRBinaryOp op) {
+    switch (op) {
+        case IRBinaryOp_Equal:
+            return CodegenCondCode_EQ;
+        case IRBinaryOp_NotEqual:
+            return CodegenCondCode_NE;
+        case IRBinaryOp_Less:
+            return CodegenCondCode_LT;
+        case IRBinaryOp_LessEqual:
+            return CodegenCondCode_LE;
+        case IRBinaryOp_Greater:
+            return CodegenCondCode_GT;
+        case IRBinaryOp_GreaterEqual:
+            return CodegenCondCode_GE;
+        default:
+            return CodegenCondCode_NE;
+    }
+}
+
+CodegenOperand isel_reduce_reg(ISelContext* context, ISelNode* node, CodegenOperand* dst);
+
+ISelCond isel_reduce_cond(ISelContext* context, ISelNode* node) {
+    ISelRule* rule = &isel_rules[node->rule[ISelNonterminal_COND]];
+    switch (rule->id) {
+        case ISelRule_COND_COMPARE: {
+            CodegenOperand left = isel_reduce_reg(context, node->kids[0], NULL);
+            CodegenOperand right = isel_reduce_reg(context, node->kids[1], NULL);
+            return (ISelCond){left, right, isel_compare_cond(node->op)};
+        }
+        case ISelRule_COND_NOT: {
+            ISelCond cond = isel_reduce_cond(context, node->kids[0]);
+            cond.cond = codegen_invert_cond(cond.cond);
+            return cond;
+        }
+        case ISelRule_COND_REG:
+        default: {
+            CodegenOperand value = isel_reduce_reg(context, node, NULL);
+            return (ISelCond){value, {CodegenOperandType_REGISTER, .value.num = 0}, CodegenCondCode_NE};
+        }
+    }
+}
+
+// the kid a rule reads as a value, for the rules that only have one
+ISelNode* isel_reg_kid(ISelRule* rule, ISelNode* node) {
+    return rule->kids[0] == ISelNonterminal_REG ? node->kids[0] : node->kids[1];
+}
+
+// emits whatever the node's cheapest REG cover needs and returns the operand holding the value.
+// dst is where the caller wants it, which is only a hint, leaves and identities just hand back
+// what they already have
+CodegenOperand isel_reduce_reg(ISelContext* context, ISelNode* node, CodegenOperand* dst) {
+    ISelRule* rule = &isel_rules[node->rule[ISelNonterminal_REG]];
+    CodegenOperand out = dst != NULL ? *dst : codegen_convert_val(node->val, context->instructions);
+
+    switch (rule->id) {
+        case ISelRule_REG_VAR:
+        case ISelRule_REG_CONST:
+            return codegen_convert_val(node->val, context->instructions);
+        case ISelRule_REG_ZERO:
+            return (CodegenOperand){CodegenOperandType_REGISTER, .value.num = 0};
+        case ISelRule_REG_IDENTITY_RIGHT:
+        case ISelRule_REG_IDENTITY_LEFT:
+            return isel_reduce_reg(context, isel_reg_kid(rule, node), dst);
+        case ISelRule_REG_UNARY:
+        case ISelRule_REG_NEGATE:
+        case ISelRule_REG_COMPLEMENT: {
+            ISelNode* kid = node->kind == ISelNodeKind_UNARY ? node->kids[0] : isel_reg_kid(rule, node);
+            CodegenUnaryOp op = rule->id == ISelRule_REG_NEGATE ? CodegenUnaryOp_NEG :
+                rule->id == ISelRule_REG_COMPLEMENT ? CodegenUnaryOp_NOT : codegen_convert_op(node->op);
+
+            CodegenInstruction unary = {
+                .type = CodegenInstructionType_UNARY,
+                .value.unary = {
+                    .op = op,
+                    .src = isel_reduce_reg(context, kid, NULL),
+                    .dst = out,
+                },
+            };
+            vecptr_push(context->instructions, unary);
+            return out;
+        }
+        case ISelRule_REG_BINARY: {
+            CodegenOperand left = isel_reduce_reg(context, node->kids[0], NULL);
+            CodegenOperand right = isel_reduce_reg(context, node->kids[1], NULL);
+            CodegenInstruction binary = {
+                .type = CodegenInstructionType_BINARY,
+                .value.binary = {
+                    .op = codegen_convert_binary_op(node->op),
+                    .left = left,
+                    .right = right,
+                    .dst = out,
+                },
+            };
+            vecptr_push(context->instructions, binary);
+            return out;
+        }
+        case ISelRule_REG_COND: {
+            ISelCond cond = isel_reduce_cond(context, node);
+            CodegenInstruction binary = {
+                .type = CodegenInstructionType_BINARY,
+                .value.binary = {
+                    .op = isel_compare_op(cond.cond),
+                    .left = cond.left,
+                    .right = cond.right,
+                    .dst = out,
+                },
+            };
+            vecptr_push(context->instructions, binary);
+            return out;
+        }
+        default:
+            panic("No register cover for an expression\n");
+    }
+}
+
+int isel_same_operand(CodegenOperand a, CodegenOperand b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    if (a.type == CodegenOperandType_PSEUDO || a.type == CodegenOperandType_DATA) {
+        return !strcmp(a.value.identifier, b.value.identifier);
+    }
+    return a.value.num == b.value.num;
+}
+
+void isel_reduce_into(ISelContext* context, ISelNode* node, CodegenOperand dst) {
+    isel_label(node);
+    CodegenOperand value = isel_reduce_reg(context, node, &dst);
+    if (!isel_same_operand(value, dst)) {
+        CodegenInstruction mov = {
+            .type = CodegenInstructionType_MOV,
+            .value.two_op = {
+                .source = value,
+                .destination = dst,
+            },
+        };
+        vecptr_push(context->instructions, mov);
+    }
+}
+
+void isel_reduce_branch(ISelContext* context, ISelNode* node, IRInstruction* jump) {
+    isel_label(node);
+    ISelCond cond = isel_reduce_cond(context, node);
+    if (jump->type == IRInstructionType_JumpIfZero) {
+        cond.cond = codegen_invert_cond(cond.cond);
+    }
+
+    // the emulator's `jc lt` also jumps on equal and `jc gte` doesn't, so only gt/lte get used
+    if (cond.cond == CodegenCondCode_LT || cond.cond == CodegenCondCode_GE) {
+        cond.cond = cond.cond == CodegenCondCode_LT ? CodegenCondCode_GT : CodegenCondCode_LE;
+        CodegenOperand tmp = cond.left;
+        cond.left = cond.right;
+        cond.right = tmp;
+    }
+
+    CodegenInstruction cmp = {
+        .type = CodegenInstructionType_CMP,
+        .value.cmp = {
+            .left = cond.left,
+            .right = cond.right,
+        },
+    };
+    vecptr_push(context->instructions, cmp);
+
+    CodegenInstruction jc = {
+        .type = CodegenInstructionType_JUMP_COND,
+        .value.jump_cond = {
+            .cond = cond.cond,
+            .label = jump->value.jump_cond.label,
+        },
+    };
+    vecptr_push(context->instructions, jc);
+}
+
+void isel_function(IRFunctionDefinition* function, IRVarInfos* vars, CodegenFunctionBody* instructions) {
+    int length = function->body.length;
+    ISelContext context = {
+        .function = function,
+        .vars = vars,
+        .roots = calloc(length + 1, sizeof(ISelNode*)),
+        .folded = calloc(length + 1, sizeof(int)),
+        .pending = {0},
+        .instructions = instructions,
+    };
+
+    isel_build_trees(&context);
+
+    for (int i = 0; i < length; i++) {
+        if (context.folded[i]) {
+            continue;
+        }
+
+        IRInstruction* instruction = &function->body.data[i];
+        switch (instruction->type) {
+            case IRInstructionType_Unary:
+            case IRInstructionType_Binary:
+                isel_reduce_into(&context, context.roots[i], codegen_convert_val(context.roots[i]->val, instructions));
+                break;
+            case IRInstructionType_Copy:
+                isel_reduce_into(&context, context.roots[i], codegen_convert_val(instruction->value.copy.dst, instructions));
+                break;
+            case IRInstructionType_Return: {
+                isel_reduce_into(&context, context.roots[i], (CodegenOperand){CodegenOperandType_REGISTER, .value.num = 2});
+                CodegenInstruction ret = {.type = CodegenInstructionType_RET};
+                vecptr_push(instructions, ret);
+                break;
+            }
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                isel_reduce_branch(&context, context.roots[i], instruction);
+                break;
+            case IRInstructionType_JumpTable: {
+                isel_label(context.roots[i]);
+                CodegenInstruction table = {
+                    .type = CodegenInstructionType_JUMP_TABLE,
+                    .value.jump_table = {
+                        .index = isel_reduce_reg(&context, context.roots[i], NULL),
+                        .table = instruction->value.jump_table.table,
+                        .labels = instruction->value.jump_table.labels.data,
+                        .count = instruction->value.jump_table.labels.length,
+                    },
+                };
+                vecptr_push(instructions, table);
+                break;
+            }
+            case IRInstructionType_Jump:
+            case IRInstructionType_Label:
+            case IRInstructionType_Call:
+                codegen_generate_instruction(*instruction, instructions);
+                break;
+        }
+    }
+
+    for (int i = 0; i < length; i++) {
+        if (!context.folded[i]) {
+            isel_node_free(context.roots[i]);
+        }
+    }
+    if (context.constants > 0) {
+        remark(RemarkKind_Passed, "isel", "Folded", function->identifier, "%d constant expressions folded",
+            context.constants);
+    }
+    free(context.roots);
+    free(context.folded);
+    vec_free(context.pending);
+}
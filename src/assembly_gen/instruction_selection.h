@@ -0,0 +1,86 @@
+#ifndef INSTRUCTION_SELECTION_H
+#define INSTRUCTION_SELECTION_H
+
+#include "code_gen.h"
+#include "../optimization/ir_analysis.h"
+
+typedef enum ISelNonterminal {
+    ISelNonterminal_REG, // the value sits in an operand (pseudo, register or immediate)
+    ISelNonterminal_ZERO, // the constant 0, which never needs code since r0 has it
+    ISelNonterminal_ONES, // the constant -1, which the ir can only spell as -(1)
+    ISelNonterminal_COND, // a comparison nothing has emitted yet, so a branch can use it as cmp + jc
+    ISelNonterminal_COUNT,
+} ISelNonterminal;
+
+typedef enum ISelNodeKind {
+    ISelNodeKind_VAR,
+    ISelNodeKind_CONST,
+    ISelNodeKind_UNARY,
+    ISelNodeKind_BINARY,
+} ISelNodeKind;
+
+typedef struct ISelNode {
+    ISelNodeKind kind;
+    IRVal val; // the leaf itself, or the var the ir computed this node into
+    int op; // IRUnaryOp or IRBinaryOp
+    struct ISelNode* kids[2];
+    int cost[ISelNonterminal_COUNT];
+    int rule[ISelNonterminal_COUNT];
+} ISelNode;
+
+typedef enum ISelRuleId {
+    ISelRule_REG_VAR,
+    ISelRule_REG_CONST,
+    ISelRule_ZERO_CONST,
+    ISelRule_ONES_NEGATED_ONE,
+    ISelRule_REG_UNARY,
+    ISelRule_REG_BINARY,
+    ISelRule_REG_IDENTITY_RIGHT,
+    ISelRule_REG_IDENTITY_LEFT,
+    ISelRule_ZERO_ANNIHILATE,
+    ISelRule_REG_NEGATE,
+    ISelRule_REG_COMPLEMENT,
+    ISelRule_COND_COMPARE,
+    ISelRule_COND_NOT,
+    // chain rules, nonterminal to nonterminal
+    ISelRule_REG_ZERO,
+    ISelRule_COND_REG,
+    ISelRule_REG_COND,
+} ISelRuleId;
+
+typedef struct ISelRule {
+    ISelRuleId id;
+    ISelNonterminal lhs;
+    int chain; // for chain rules kids[0] is the nonterminal on the right
+    ISelNodeKind kind;
+    int (*matches)(ISelNode* node); // shape checks the kid nonterminals can't express, NULL for none
+    int kid_count;
+    ISelNonterminal kids[2];
+    int cost; // instructions it emits, plus one per non-zero immediate fixup has to load
+} ISelRule;
+
+typedef struct ISelCond {
+    CodegenOperand left;
+    CodegenOperand right;
+    CodegenCondCode cond;
+} ISelCond;
+
+typedef struct ISelContext {
+    IRFunctionDefinition* function;
+    IRVarInfos* vars;
+    ISelNode** roots; // per ir instruction, the tree it computes
+    int* folded; // per ir instruction, whether its tree got pulled into a later one
+    struct {
+        int* data;
+        int length;
+        int capacity;
+    } pending; // foldable instructions in the current block whose result hasn't been used yet
+    CodegenFunctionBody* instructions;
+    int constants; // expressions folded to a constant
+} ISelContext;
+
+// covers the function's expression trees with the cheapest rules and emits the result.
+// labels, jumps and calls go through codegen_generate_instruction
+void isel_function(IRFunctionDefinition* function, IRVarInfos* vars, CodegenFunctionBody* instructions);
+
+#endif
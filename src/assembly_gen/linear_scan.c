@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "linear_scan.h"
+#include "register_allocation.h"
+#include "../easy_stuff.h"
+
+// linear scan over one live interval per pseudo (no holes, no splitting)
+//
+// intervals come from the block live sets plus every read/write, so building them is linear, and
+// the scan itself is a sort plus an active list that never holds more than the register count.
+// physical registers aren't intervals, instead every register gets a prefix count of the positions
+// where it's live, so "does this interval cross a use of r3" is two lookups.
+
+void ls_extend(LSContext* context, int node, int position) {
+    if (node < CG_REGISTER_COUNT) {
+        return;
+    }
+
+    LSInterval* interval = &context->intervals.data[node - CG_REGISTER_COUNT];
+    if (interval->start == -1 || position < interval->start) {
+        interval->start = position;
+    }
+    if (position > interval->end) {
+        interval->end = position;
+    }
+}
+
+void ls_extend_live_set(LSContext* context, unsigned int* set, int position) {
+    for (int w = 0; w < context->info.words; w++) {
+        unsigned int bits = set[w];
+        while (bits) {
+            int bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            ls_extend(context, w * 32 + bit, position);
+        }
+    }
+}
+
+void ls_build_intervals(LSContext* context) {
+    CGFunctionInfo* info = &context->info;
+    int pseudo_count = info->node_count - CG_REGISTER_COUNT;
+
+    for (int p = 0; p < pseudo_count; p++) {
+        LSInterval interval = {.node = p + CG_REGISTER_COUNT, .start = -1, .end = -1};
+        vec_push(context->intervals, interval);
+    }
+
+    context->positions = info->body->length * 2;
+    int stride = context->positions + 1;
+    context->fixed_busy = calloc((size_t)CG_REGISTER_COUNT * stride, sizeof(int));
+
+    for (int b = 0; b < info->blocks.length; b++) {
+        CGBlock* block = &info->blocks.data[b];
+        if (block->start == block->end) {
+            continue;
+        }
+
+        ls_extend_live_set(context, &info->live_in[b * info->words], block->start * 2);
+        ls_extend_live_set(context, &info->live_out[b * info->words], block->end * 2 - 1);
+
+        // the registers are nodes 0-15, so they're the low bits of the first word
+        unsigned int live = info->live_out[b * info->words] & 0xffff;
+        for (int i = block->end - 1; i >= block->start; i--) {
+            unsigned int defs = 0;
+            unsigned int uses = 0;
+            for (int d = 0; d < info->defs[i].length; d++) {
+                int node = info->defs[i].data[d];
+                ls_extend(context, node, i * 2 + 1);
+                if (node < CG_REGISTER_COUNT) {
+                    defs |= 1u << node;
+                }
+            }
+            for (int u = 0; u < info->uses[i].length; u++) {
+                int node = info->uses[i].data[u];
+                ls_extend(context, node, i * 2);
+                if (node < CG_REGISTER_COUNT) {
+                    uses |= 1u << node;
+                }
+            }
+
+            unsigned int after = live | defs;
+            live = (live & ~defs) | uses;
+
+            for (int reg = 0; reg < CG_REGISTER_COUNT; reg++) {
+                context->fixed_busy[reg * stride + i * 2 + 1] = (after >> reg) & 1;
+                context->fixed_busy[reg * stride + i * 2] = (live >> reg) & 1;
+            }
+        }
+    }
+
+    for (int reg = 0; reg < CG_REGISTER_COUNT; reg++) {
+        int* busy = &context->fixed_busy[reg * stride];
+        for (int p = 1; p < stride; p++) {
+            busy[p] += busy[p - 1];
+        }
+    }
+}
+
+int ls_fixed_conflict(LSContext* context, int reg, LSInterval* interval) {
+    int* busy = &context->fixed_busy[reg * (context->positions + 1)];
+    int before = interval->start > 0 ? busy[interval->start - 1] : 0;
+    return busy[interval->end] - before > 0;
+}
+
+void ls_collect_hints(LSContext* context) {
+    CGFunctionInfo* info = &context->info;
+    for (int i = 0; i < info->body->length; i++) {
+        if (!cg_is_move(&info->body->data[i]) || info->uses[i].length != 1 || info->defs[i].length != 1) {
+            continue;
+        }
+
+        int src = info->uses[i].data[0];
+        int dst = info->defs[i].data[0];
+        if (dst >= CG_REGISTER_COUNT) {
+            context->hint[dst] = src;
+        } else if (src >= CG_REGISTER_COUNT) {
+            context->hint[src] = dst;
+        }
+    }
+}
+
+int ls_compare_intervals(const void* a, const void* b) {
+    const LSInterval* left = a;
+    const LSInterval* right = b;
+    if (left->start != right->start) {
+        return left->start - right->start;
+    }
+    return left->node - right->node;
+}
+
+void ls_scan(LSContext* context) {
+    int active[CG_ALLOCATABLE_COUNT];
+    int active_length = 0; // indices into the intervals, sorted by end
+
+    for (int c = 0; c < context->intervals.length; c++) {
+        LSInterval* current = &context->intervals.data[c];
+
+        // expire
+        int kept = 0;
+        for (int a = 0; a < active_length; a++) {
+            if (context->intervals.data[active[a]].end >= current->start) {
+                active[kept++] = active[a];
+            }
+        }
+        active_length = kept;
+
+        int taken[CG_REGISTER_COUNT] = {0};
+        for (int a = 0; a < active_length; a++) {
+            taken[context->color[context->intervals.data[active[a]].node]] = true;
+        }
+
+        int reg = -1;
+        int hint = context->hint[current->node];
+        if (hint != -1) {
+            int hinted = hint < CG_REGISTER_COUNT ? hint : context->color[hint];
+            if (hinted != -1 && cg_is_allocatable(hinted) && !taken[hinted] && !ls_fixed_conflict(context, hinted, current)) {
+                reg = hinted;
+            }
+        }
+        for (int r = 0; r < CG_ALLOCATABLE_COUNT && reg == -1; r++) {
+            int candidate = cg_allocatable_register(r);
+            if (!taken[candidate] && !ls_fixed_conflict(context, candidate, current)) {
+                reg = candidate;
+            }
+        }
+
+        if (reg == -1) {
+            // spill whatever ends last, which might be the current one
+            for (int a = active_length - 1; a >= 0; a--) {
+                LSInterval* victim = &context->intervals.data[active[a]];
+                int victim_reg = context->color[victim->node];
+                if (victim->end > current->end && !ls_fixed_conflict(context, victim_reg, current)) {
+                    reg = victim_reg;
+                    context->color[victim->node] = -1;
+                    for (int s = a; s < active_length - 1; s++) {
+                        active[s] = active[s + 1];
+                    }
+                    active_length--;
+                    break;
+                }
+            }
+        }
+
+        if (reg == -1) {
+            continue;
+        }
+
+        context->color[current->node] = reg;
+
+        int position = active_length;
+        while (position > 0 && context->intervals.data[active[position - 1]].end > current->end) {
+            active[position] = active[position - 1];
+            position--;
+        }
+        active[position] = c;
+        active_length++;
+    }
+}
+
+CodegenFunctionDefinition linear_scan_function(CodegenFunctionDefinition function, TCSymbols* symbols) {
+    LSContext context = {
+        .info = cg_analyze_function(&function, symbols),
+        .intervals = {0},
+    };
+
+    int node_count = context.info.node_count;
+    context.hint = malloc_n_type(int, node_count);
+    context.color = malloc_n_type(int, node_count);
+    int* alias = malloc_n_type(int, node_count);
+    for (int n = 0; n < node_count; n++) {
+        context.hint[n] = -1;
+        context.color[n] = n < CG_REGISTER_COUNT ? n : -1;
+        alias[n] = n;
+    }
+
+    ls_build_intervals(&context);
+    ls_collect_hints(&context);
+
+    // pseudos that never show up in a reachable spot don't get an interval
+    int kept = 0;
+    for (int i = 0; i < context.intervals.length; i++) {
+        if (context.intervals.data[i].start != -1) {
+            context.intervals.data[kept++] = context.intervals.data[i];
+        }
+    }
+    context.intervals.length = kept;
+    qsort(context.intervals.data, context.intervals.length, sizeof(LSInterval), ls_compare_intervals);
+
+    ls_scan(&context);
+
+    allocate_registers_rewrite(&function, &context.info, alias, context.color);
+
+    free(alias);
+    free(context.hint);
+    free(context.color);
+    free(context.fixed_busy);
+    vec_free(context.intervals);
+    cg_free_function_info(&context.info);
+
+    return function;
+}
@@ -0,0 +1,30 @@
+#ifndef LINEAR_SCAN_H
+#define LINEAR_SCAN_H
+
+#include "code_gen.h"
+#include "codegen_analysis.h"
+#include "../semantic_analysis/type_checking.h"
+
+typedef struct LSInterval {
+    int node;
+    int start; // positions are 2 * instruction for reads, 2 * instruction + 1 for writes
+    int end;
+} LSInterval;
+
+typedef struct LSContext {
+    CGFunctionInfo info;
+    struct {
+        LSInterval* data;
+        int length;
+        int capacity;
+    } intervals;
+    int* fixed_busy; // per register, prefix counts of positions where the register itself is live
+    int positions;
+    int* hint; // register or pseudo node a move ties the node to, -1 for none
+    int* color;
+} LSContext;
+
+// same contract as allocate_registers_function, but poletto & sarkar's linear scan over live intervals
+CodegenFunctionDefinition linear_scan_function(CodegenFunctionDefinition function, TCSymbols* symbols);
+
+#endif
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outliner.h"
+#include "../emitter.h"
+#include "../easy_stuff.h"
+#include "../string_map.h"
+#include "../remarks.h"
+
+// every machine instruction is the same 3 bytes, so sizes are counted in instructions.
+// a run of size s that shows up n times costs n * s. outlined it's n calls plus the helper
+// (the run and a ret), so it pays off when n * s > n + s + 1.
+//
+// a helper gets called, which pushes the return address, so nothing in the run can touch r14
+// (frameless functions address their slots off it) and it can't jump, call or return.
+// r15 stays put across the call, so framed slot accesses are fine.
+// helpers are frameless functions, so their ret is a bare ret.
+//
+// the call also leaves its return address right under r14, and push only writes the low byte of
+// its slot, so a later push there would pick up the high byte of that address. only functions that
+// already call (from the same depth, since they never push) and never push get helper calls,
+// so the return address lands where theirs already do.
+//
+// the framed epilogue (`add r15 r0 r14 / pop r15 / ret`) doesn't depend on the function,
+// so every framed ret but one becomes a jump to that one.
+
+// helper names have to be unique across every file we compile in this run
+int outliner_helper_count = 0;
+
+int outliner_count_lines(char* text) {
+    int lines = 0;
+    for (char* c = text; *c; c++) {
+        lines += *c == '\n';
+    }
+    return lines;
+}
+
+// the emitted text of an instruction that can go in a helper, otherwise NULL
+char* outliner_text(CodegenInstruction* instruction) {
+    switch (instruction->type) {
+        case CodegenInstructionType_MOV:
+        case CodegenInstructionType_LDI:
+        case CodegenInstructionType_UNARY:
+        case CodegenInstructionType_BINARY:
+        case CodegenInstructionType_LOD:
+        case CodegenInstructionType_STR:
+            break;
+        default:
+            // cmp too, its flags would have to make it through the ret
+            return NULL;
+    }
+
+    char* text = emit_instruction(*instruction);
+    if (strstr(text, "r14") != NULL) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+int outliner_can_call_from(CodegenFunctionDefinition* function) {
+    int calls = false;
+    for (int i = 0; i < function->body.length; i++) {
+        if (function->body.data[i].type == CodegenInstructionType_PUSH) {
+            return false;
+        }
+        calls |= function->body.data[i].type == CodegenInstructionType_CALL;
+    }
+    return calls;
+}
+
+int outliner_merge_epilogues(CodegenProgram* program) {
+    char* shared = NULL;
+    int merged = 0;
+
+    for (int f = 0; f < program->length; f++) {
+        if (program->data[f].ty != CGTFunction || program->data[f].val.function.frameless) {
+            continue;
+        }
+
+        CodegenFunctionBody* body = &program->data[f].val.function.body;
+        for (int i = 0; i < body->length; i++) {
+            if (body->data[i].type != CodegenInstructionType_RET) {
+                continue;
+            }
+
+            if (shared == NULL) {
+                shared = malloc_n_type(char, quick_log10(outliner_helper_count) + 22);
+                sprintf(shared, ".outlined.epilogue.%d", outliner_helper_count++);
+                CodegenInstruction label = {
+                    .type = CodegenInstructionType_LABEL,
+                    .value.str = shared,
+                };
+                // make room for the label in front of the ret
+                CodegenInstruction ret = body->data[i];
+                vecptr_push(body, ret);
+                for (int j = body->length - 1; j > i; j--) {
+                    body->data[j] = body->data[j - 1];
+                }
+                body->data[i] = label;
+                i++;
+                continue;
+            }
+
+            CodegenInstruction jump = {
+                .type = CodegenInstructionType_JUMP,
+                .value.str = shared,
+            };
+            body->data[i] = jump;
+            merged++;
+        }
+    }
+
+    return merged;
+}
+
+int outliner_savings(OutlinerCandidate* candidate) {
+    int n = candidate->sites.length;
+    return n * candidate->size - (n + candidate->size + 1);
+}
+
+int outliner_outline_once(CodegenProgram* program, OutlinerStats* stats) {
+    StringMap indices = string_map_new();
+    VEC(OutlinerCandidate) candidates = {0};
+
+    for (int f = 0; f < program->length; f++) {
+        if (program->data[f].ty != CGTFunction || !outliner_can_call_from(&program->data[f].val.function)) {
+            continue;
+        }
+
+        CodegenFunctionBody* body = &program->data[f].val.function.body;
+        char** texts = malloc_n_type(char*, body->length + 1);
+        int* sizes = malloc_n_type(int, body->length + 1);
+        for (int i = 0; i < body->length; i++) {
+            texts[i] = outliner_text(&body->data[i]);
+            sizes[i] = texts[i] == NULL ? 0 : outliner_count_lines(texts[i]);
+        }
+
+        for (int i = 0; i < body->length; i++) {
+            int key_length = 0;
+            int size = 0;
+            for (int l = 1; l <= OUTLINER_MAX_LENGTH && i + l <= body->length && texts[i + l - 1] != NULL; l++) {
+                key_length += strlen(texts[i + l - 1]);
+                size += sizes[i + l - 1];
+                if (l < 2) {
+                    continue;
+                }
+
+                char* key = malloc_n_type(char, key_length + 1);
+                key[0] = '\0';
+                for (int k = i; k < i + l; k++) {
+                    strcat(key, texts[k]);
+                }
+
+                int idx = string_map_get(&indices, key);
+                if (idx == -1) {
+                    OutlinerCandidate candidate = {key, l, size, {0}};
+                    idx = candidates.length;
+                    vec_push(candidates, candidate);
+                    string_map_set(&indices, key, idx);
+                } else {
+                    free(key);
+                }
+
+                // sites of one candidate can't overlap
+                OutlinerCandidate* candidate = &candidates.data[idx];
+                if (candidate->sites.length > 0) {
+                    OutlinerSite* last = &candidate->sites.data[candidate->sites.length - 1];
+                    if (last->function == f && last->start + l > i) {
+                        continue;
+                    }
+                }
+                OutlinerSite site = {f, i};
+                vec_push(candidate->sites, site);
+            }
+        }
+
+        for (int i = 0; i < body->length; i++) {
+            free(texts[i]);
+        }
+        free(texts);
+        free(sizes);
+    }
+
+    int best = -1;
+    for (int c = 0; c < candidates.length; c++) {
+        if (outliner_savings(&candidates.data[c]) > 0 &&
+            (best == -1 || outliner_savings(&candidates.data[c]) > outliner_savings(&candidates.data[best]))) {
+            best = c;
+        }
+    }
+
+    int saved = 0;
+    if (best != -1) {
+        OutlinerCandidate* candidate = &candidates.data[best];
+        saved = outliner_savings(candidate);
+
+        char* name = malloc_n_type(char, quick_log10(outliner_helper_count) + 12);
+        sprintf(name, ".outlined.%d", outliner_helper_count++);
+
+        OutlinerSite first = candidate->sites.data[0];
+        CodegenFunctionBody* first_body = &program->data[first.function].val.function.body;
+        CodegenFunctionDefinition helper = {
+            .identifier = name,
+            .global = false,
+            .body = {0},
+            .frameless = true,
+            .param_count = 0,
+        };
+        for (int k = 0; k < candidate->length; k++) {
+            vec_push(helper.body, first_body->data[first.start + k]);
+        }
+        CodegenInstruction ret = {.type = CodegenInstructionType_RET};
+        vec_push(helper.body, ret);
+
+        // sites are in program order, so each function gets rebuilt once, front to back
+        for (int s = 0; s < candidate->sites.length;) {
+            int f = candidate->sites.data[s].function;
+            CodegenFunctionBody* body = &program->data[f].val.function.body;
+            CodegenFunctionBody new_body = {0};
+            for (int i = 0; i < body->length; i++) {
+                if (s < candidate->sites.length && candidate->sites.data[s].function == f &&
+                    candidate->sites.data[s].start == i) {
+                    CodegenInstruction call = {
+                        .type = CodegenInstructionType_CALL,
+                        .value.call = {.name = name, .arg_count = 0},
+                    };
+                    vec_push(new_body, call);
+                    i += candidate->length - 1;
+                    s++;
+                    continue;
+                }
+                vec_push(new_body, body->data[i]);
+            }
+            vec_free(*body);
+            *body = new_body;
+        }
+
+        remark(RemarkKind_Passed, "outline", "Outlined", name, "%d instructions outlined from %d places, %d saved",
+            candidate->size, candidate->sites.length, saved);
+
+        CodegenTopLevel top_level = {.ty = CGTFunction, .val.function = helper};
+        vecptr_push(program, top_level);
+
+        stats->helpers++;
+        stats->sites += candidate->sites.length;
+    }
+
+    for (int c = 0; c < candidates.length; c++) {
+        free(candidates.data[c].key);
+        vec_free(candidates.data[c].sites);
+    }
+    vec_free(candidates);
+    string_map_free(indices);
+
+    return saved;
+}
+
+CodegenProgram outliner_program(CodegenProgram program) {
+    OutlinerStats stats = {0};
+
+    stats.epilogues = outliner_merge_epilogues(&program);
+    stats.saved = stats.epilogues * 2;
+
+    int saved = outliner_outline_once(&program, &stats);
+    while (saved > 0) {
+        stats.saved += saved;
+        saved = outliner_outline_once(&program, &stats);
+    }
+
+    remark_stats("outlined %d sequences into %d helpers, merged %d epilogues, saved %d instructions\n", stats.sites, stats.helpers,
+        stats.epilogues, stats.saved);
+
+    return program;
+}
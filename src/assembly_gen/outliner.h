@@ -0,0 +1,36 @@
+#ifndef OUTLINER_H
+#define OUTLINER_H
+
+#include "code_gen.h"
+
+// longest run of instructions that gets considered for a helper
+#define OUTLINER_MAX_LENGTH 16
+
+typedef struct OutlinerSite {
+    int function; // index in the program
+    int start;
+} OutlinerSite;
+
+// a run of instructions that shows up in several places, keyed by its emitted text
+typedef struct OutlinerCandidate {
+    char* key;
+    int length; // codegen instructions
+    int size; // machine instructions they emit
+    VEC(OutlinerSite) sites; // left to right, not overlapping
+} OutlinerCandidate;
+
+typedef struct OutlinerStats {
+    int helpers;
+    int sites;
+    int epilogues;
+    int saved; // machine instructions
+} OutlinerStats;
+
+// for -Os: runs last, on framed code. repeated instruction runs become calls to shared helpers,
+// and framed functions share one epilogue
+CodegenProgram outliner_program(CodegenProgram program);
+int outliner_merge_epilogues(CodegenProgram* program);
+// outlines the best candidate, returns how many machine instructions that saved (0 when nothing pays off)
+int outliner_outline_once(CodegenProgram* program, OutlinerStats* stats);
+
+#endif
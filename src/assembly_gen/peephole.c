@@ -0,0 +1,395 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "peephole.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// peephole over fixed up code
+//
+// fixup expands one instruction at a time through r10-r12, so it keeps storing a value and loading
+// it straight back, loading 0 into a register just to read it once, and so on. every rule here
+// looks at one instruction plus at most PEEPHOLE_WINDOW neighbours in the same block, and the
+// whole table gets rerun until nothing fires. rules that are just "these instructions in a row"
+// live in peephole.rules and come in through peephole_match_generated instead.
+//
+// r10-r12 never live across a block boundary (fixup only uses them inside one expansion), which
+// is what lets the dead def rule throw away scratch loads without a real liveness pass.
+
+int peephole_is_boundary(CodegenInstruction* instruction) {
+    switch (instruction->type) {
+        case CodegenInstructionType_LABEL:
+        case CodegenInstructionType_JUMP:
+        case CodegenInstructionType_JUMP_COND:
+        case CodegenInstructionType_JUMP_TABLE:
+        case CodegenInstructionType_RET:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int peephole_is_scratch(int reg) {
+    return reg >= 10 && reg <= 12;
+}
+
+unsigned int peephole_register_bit(CodegenOperand operand) {
+    return operand.type == CodegenOperandType_REGISTER ? 1u << operand.value.num : 0;
+}
+
+void peephole_registers(CodegenInstruction* instruction, unsigned int* reads, unsigned int* writes) {
+    *reads = 0;
+    *writes = 0;
+
+    switch (instruction->type) {
+        case CodegenInstructionType_MOV:
+        case CodegenInstructionType_LDI:
+            *reads = peephole_register_bit(instruction->value.two_op.source);
+            *writes = peephole_register_bit(instruction->value.two_op.destination);
+            break;
+        case CodegenInstructionType_UNARY:
+            *reads = peephole_register_bit(instruction->value.unary.src);
+            *writes = peephole_register_bit(instruction->value.unary.dst);
+            break;
+        case CodegenInstructionType_BINARY:
+            *reads = peephole_register_bit(instruction->value.binary.left) | peephole_register_bit(instruction->value.binary.right);
+            *writes = peephole_register_bit(instruction->value.binary.dst);
+            break;
+        case CodegenInstructionType_LOD:
+            *reads = peephole_register_bit(instruction->value.mem.address);
+            *writes = peephole_register_bit(instruction->value.mem.reg);
+            break;
+        case CodegenInstructionType_STR:
+            *reads = peephole_register_bit(instruction->value.mem.address) | peephole_register_bit(instruction->value.mem.reg);
+            break;
+        case CodegenInstructionType_CMP:
+            *reads = peephole_register_bit(instruction->value.cmp.left) | peephole_register_bit(instruction->value.cmp.right);
+            break;
+        case CodegenInstructionType_PUSH:
+            *reads = peephole_register_bit(instruction->value.single) | 1u << 14;
+            *writes = 1u << 14;
+            break;
+        case CodegenInstructionType_ALLOCATE_STACK:
+        case CodegenInstructionType_DEALLOCATE_STACK:
+            // the emitter goes through r10 for these
+            *reads = 1u << 14;
+            *writes = 1u << 10 | 1u << 14;
+            break;
+        case CodegenInstructionType_CALL:
+            for (int a = 0; a < 7 && a < instruction->value.call.arg_count; a++) {
+                *reads |= 1u << (a + 3);
+            }
+            *reads |= 1u << 14 | 1u << 15;
+            *writes = 0xffff & ~(1u << 0 | 1u << 14 | 1u << 15);
+            break;
+        case CodegenInstructionType_RET:
+            *reads = 1u << 2 | 1u << 15;
+            *writes = 1u << 14 | 1u << 15;
+            break;
+        case CodegenInstructionType_JUMP_TABLE:
+            // the emitter goes through r10 and r11
+            *reads = peephole_register_bit(instruction->value.jump_table.index);
+            *writes = 1u << 10 | 1u << 11;
+            break;
+        case CodegenInstructionType_JUMP:
+        case CodegenInstructionType_JUMP_COND:
+        case CodegenInstructionType_LABEL:
+            break;
+    }
+}
+
+int peephole_register_dead_after(CodegenFunctionBody* body, int index, int reg) {
+    for (int k = index + 1; k < body->length; k++) {
+        if (k > index + PEEPHOLE_WINDOW) {
+            return false;
+        }
+
+        CodegenInstruction* instruction = &body->data[k];
+        unsigned int reads, writes;
+        peephole_registers(instruction, &reads, &writes);
+
+        if ((reads >> reg) & 1) {
+            return false;
+        }
+        if ((writes >> reg) & 1 || instruction->type == CodegenInstructionType_RET) {
+            return true;
+        }
+        if (peephole_is_boundary(instruction)) {
+            return peephole_is_scratch(reg);
+        }
+    }
+
+    return true;
+}
+
+void peephole_delete(CodegenFunctionBody* body, int index) {
+    memmove(&body->data[index], &body->data[index + 1], sizeof(CodegenInstruction) * (body->length - index - 1));
+    body->length--;
+}
+
+void peephole_replace(CodegenFunctionBody* body, int index, int count, CodegenInstruction* replacement, int replacement_count) {
+    if (replacement_count > 0) {
+        memcpy(&body->data[index], replacement, sizeof(CodegenInstruction) * replacement_count);
+    }
+    int removed = count - replacement_count;
+    int tail = index + count;
+    memmove(&body->data[tail - removed], &body->data[tail], sizeof(CodegenInstruction) * (body->length - tail));
+    body->length -= removed;
+}
+
+int peephole_same_location(CodegenInstruction* a, CodegenInstruction* b) {
+    if (a->value.mem.address.type != b->value.mem.address.type) {
+        return false;
+    }
+    if (a->value.mem.address.type == CodegenOperandType_DATA) {
+        return !strcmp(a->value.mem.offset.data, b->value.mem.offset.data);
+    }
+    return a->value.mem.address.value.num == b->value.mem.address.value.num && a->value.mem.offset.num == b->value.mem.offset.num;
+}
+
+// nothing can take an address, so frame slots and statics only ever alias themselves
+int peephole_disjoint_locations(CodegenInstruction* a, CodegenInstruction* b) {
+    if (a->value.mem.address.type != b->value.mem.address.type) {
+        return true;
+    }
+    if (a->value.mem.address.type == CodegenOperandType_DATA) {
+        return !peephole_same_location(a, b);
+    }
+    return a->value.mem.address.value.num == 15 && b->value.mem.address.value.num == 15 && !peephole_same_location(a, b);
+}
+
+// the closest earlier lod/str of the same location whose register still holds the value, or -1
+int peephole_find_memory_value(CodegenFunctionBody* body, int index) {
+    CodegenInstruction* load = &body->data[index];
+    unsigned int written = 0;
+
+    for (int j = index - 1; j >= 0 && j >= index - PEEPHOLE_WINDOW; j--) {
+        CodegenInstruction* instruction = &body->data[j];
+        if (peephole_is_boundary(instruction) || instruction->type == CodegenInstructionType_CALL) {
+            return -1;
+        }
+
+        int is_memory = instruction->type == CodegenInstructionType_LOD || instruction->type == CodegenInstructionType_STR;
+        if (is_memory && peephole_same_location(instruction, load)) {
+            unsigned int needed = peephole_register_bit(instruction->value.mem.reg) | peephole_register_bit(load->value.mem.address);
+            return written & needed ? -1 : j;
+        }
+        if (instruction->type == CodegenInstructionType_STR && !peephole_disjoint_locations(instruction, load)) {
+            return -1;
+        }
+
+        unsigned int reads, writes;
+        peephole_registers(instruction, &reads, &writes);
+        written |= writes;
+    }
+
+    return -1;
+}
+
+int peephole_forward_memory(CodegenFunctionBody* body, int index, CodegenInstructionType source_type) {
+    if (body->data[index].type != CodegenInstructionType_LOD) {
+        return false;
+    }
+
+    int source = peephole_find_memory_value(body, index);
+    if (source == -1 || body->data[source].type != source_type) {
+        return false;
+    }
+
+    CodegenOperand value = body->data[source].value.mem.reg;
+    CodegenOperand target = body->data[index].value.mem.reg;
+    if (value.value.num == target.value.num) {
+        peephole_delete(body, index);
+        return true;
+    }
+
+    CodegenInstruction mov = {
+        .type = CodegenInstructionType_MOV,
+        .value.two_op = {
+            .source = value,
+            .destination = target,
+        },
+    };
+    body->data[index] = mov;
+
+    return true;
+}
+
+// str r15 r12 -2 / lod r15 r10 -2  ->  str r15 r12 -2 / mov r12 r10
+int peephole_store_to_load(CodegenFunctionBody* body, int index) {
+    return peephole_forward_memory(body, index, CodegenInstructionType_STR);
+}
+
+// lod r15 r10 -2 / ... / lod r15 r11 -2  ->  lod r15 r10 -2 / ... / mov r10 r11
+int peephole_redundant_load(CodegenFunctionBody* body, int index) {
+    return peephole_forward_memory(body, index, CodegenInstructionType_LOD);
+}
+
+int peephole_substitute_zero(CodegenOperand* operand, int reg) {
+    if (operand->type != CodegenOperandType_REGISTER || operand->value.num != reg) {
+        return false;
+    }
+    operand->value.num = 0;
+    return true;
+}
+
+// ldi r10 0 / str r15 r10 -2  ->  ldi r10 0 / str r15 r0 -2, and dead def takes the ldi.
+// a mov out of r0 (what forwarding turns a zero store + load into) counts too
+int peephole_zero_register(CodegenFunctionBody* body, int index) {
+    CodegenInstruction* zero = &body->data[index];
+    CodegenOperand source = zero->value.two_op.source;
+    int is_zero_ldi = zero->type == CodegenInstructionType_LDI && source.type == CodegenOperandType_IMMEDIATE && source.value.num == 0;
+    int is_zero_mov = zero->type == CodegenInstructionType_MOV && source.type == CodegenOperandType_REGISTER && source.value.num == 0;
+    if ((!is_zero_ldi && !is_zero_mov) ||
+        zero->value.two_op.destination.type != CodegenOperandType_REGISTER ||
+        zero->value.two_op.destination.value.num == 0) {
+        return false;
+    }
+
+    int reg = zero->value.two_op.destination.value.num;
+    int changed = false;
+    for (int k = index + 1; k < body->length && k <= index + PEEPHOLE_WINDOW; k++) {
+        CodegenInstruction* instruction = &body->data[k];
+        if (peephole_is_boundary(instruction) || instruction->type == CodegenInstructionType_CALL) {
+            break;
+        }
+
+        switch (instruction->type) {
+            case CodegenInstructionType_MOV:
+                changed |= peephole_substitute_zero(&instruction->value.two_op.source, reg);
+                break;
+            case CodegenInstructionType_UNARY:
+                changed |= peephole_substitute_zero(&instruction->value.unary.src, reg);
+                break;
+            case CodegenInstructionType_BINARY:
+                changed |= peephole_substitute_zero(&instruction->value.binary.left, reg);
+                changed |= peephole_substitute_zero(&instruction->value.binary.right, reg);
+                break;
+            case CodegenInstructionType_STR:
+                changed |= peephole_substitute_zero(&instruction->value.mem.reg, reg);
+                break;
+            case CodegenInstructionType_CMP:
+                changed |= peephole_substitute_zero(&instruction->value.cmp.left, reg);
+                changed |= peephole_substitute_zero(&instruction->value.cmp.right, reg);
+                break;
+            case CodegenInstructionType_PUSH:
+                changed |= peephole_substitute_zero(&instruction->value.single, reg);
+                break;
+            default:
+                break;
+        }
+
+        unsigned int reads, writes;
+        peephole_registers(instruction, &reads, &writes);
+        if ((writes >> reg) & 1) {
+            break;
+        }
+    }
+
+    return changed;
+}
+
+int peephole_dead_def(CodegenFunctionBody* body, int index) {
+    CodegenInstruction* instruction = &body->data[index];
+    CodegenOperand dst;
+    switch (instruction->type) {
+        case CodegenInstructionType_MOV:
+        case CodegenInstructionType_LDI:
+            dst = instruction->value.two_op.destination;
+            break;
+        case CodegenInstructionType_UNARY:
+            dst = instruction->value.unary.dst;
+            break;
+        case CodegenInstructionType_BINARY:
+            dst = instruction->value.binary.dst;
+            break;
+        case CodegenInstructionType_LOD:
+            dst = instruction->value.mem.reg;
+            break;
+        default:
+            return false;
+    }
+
+    if (dst.type != CodegenOperandType_REGISTER || dst.value.num <= 1 || dst.value.num >= 14) {
+        return false;
+    }
+    if (!peephole_register_dead_after(body, index, dst.value.num)) {
+        return false;
+    }
+
+    peephole_delete(body, index);
+    return true;
+}
+
+int peephole_unreachable(CodegenFunctionBody* body, int index) {
+    CodegenInstructionType type = body->data[index].type;
+    if ((type != CodegenInstructionType_JUMP && type != CodegenInstructionType_JUMP_TABLE && type != CodegenInstructionType_RET) ||
+        index + 1 >= body->length ||
+        body->data[index + 1].type == CodegenInstructionType_LABEL) {
+        return false;
+    }
+
+    peephole_delete(body, index + 1);
+    return true;
+}
+
+PeepholeRule peephole_rules[] = {
+    {"store-to-load forwarding", peephole_store_to_load},
+    {"redundant load", peephole_redundant_load},
+    {"zero register", peephole_zero_register},
+    {"dead def", peephole_dead_def},
+    {"unreachable", peephole_unreachable},
+};
+
+#define PEEPHOLE_RULE_COUNT ((int)(sizeof(peephole_rules) / sizeof(peephole_rules[0])))
+
+CodegenFunctionDefinition peephole_function(CodegenFunctionDefinition function, PeepholeStats* stats) {
+    int changed = true;
+    while (changed) {
+        changed = false;
+        stats->iterations++;
+
+        for (int i = 0; i < function.body.length; i++) {
+            for (int r = 0; r < PEEPHOLE_RULE_COUNT && i < function.body.length; r++) {
+                if (peephole_rules[r].apply(&function.body, i)) {
+                    stats->hits[r]++;
+                    changed = true;
+                }
+            }
+
+            int fired = i < function.body.length ? peephole_match_generated(&function.body, i) : -1;
+            if (fired != -1) {
+                stats->hits[PEEPHOLE_RULE_COUNT + fired]++;
+                changed = true;
+            }
+        }
+    }
+
+    return function;
+}
+
+CodegenProgram peephole_program(CodegenProgram program) {
+    PeepholeStats stats = {
+        .hits = calloc(PEEPHOLE_RULE_COUNT + peephole_generated_rule_count, sizeof(int)),
+        .iterations = 0,
+    };
+
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == CGTFunction) {
+            program.data[i].val.function = peephole_function(program.data[i].val.function, &stats);
+        }
+    }
+
+    for (int r = 0; r < PEEPHOLE_RULE_COUNT + peephole_generated_rule_count; r++) {
+        if (stats.hits[r]) {
+            char* name = r < PEEPHOLE_RULE_COUNT ? peephole_rules[r].name : peephole_generated_rule_names[r - PEEPHOLE_RULE_COUNT];
+            remark_stats("peephole %s: %d\n", name, stats.hits[r]);
+        }
+    }
+    remark_stats("peephole iterations: %d\n", stats.iterations);
+
+    free(stats.hits);
+
+    return program;
+}
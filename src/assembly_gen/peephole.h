@@ -0,0 +1,36 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "code_gen.h"
+
+// how far a rule looks forwards or backwards from the instruction it's matching on
+#define PEEPHOLE_WINDOW 8
+
+// returns true if it changed the body at (or around) index
+typedef int (*PeepholeRuleFn)(CodegenFunctionBody* body, int index);
+
+typedef struct PeepholeRule {
+    char* name;
+    PeepholeRuleFn apply;
+} PeepholeRule;
+
+typedef struct PeepholeStats {
+    int* hits; // per rule
+    int iterations;
+} PeepholeStats;
+
+// out/peephole_matcher.c, generated from peephole.rules by peephole_gen
+int peephole_match_generated(CodegenFunctionBody* body, int index); // the generated rule that fired, or -1
+extern char* peephole_generated_rule_names[];
+extern int peephole_generated_rule_count;
+
+// for the generated rules
+int peephole_is_scratch(int reg);
+int peephole_register_dead_after(CodegenFunctionBody* body, int index, int reg);
+void peephole_replace(CodegenFunctionBody* body, int index, int count, CodegenInstruction* replacement, int replacement_count);
+
+// runs on fixed up code, so every operand is a register, an immediate, or an r15/data address
+CodegenProgram peephole_program(CodegenProgram program);
+CodegenFunctionDefinition peephole_function(CodegenFunctionDefinition function, PeepholeStats* stats);
+
+#endif
@@ -0,0 +1,878 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../easy_stuff.h"
+
+// build time generator for the pattern half of the peephole pass
+//
+// reads peephole.rules (the format is described at the top of that file), checks the rules
+// against each other, and writes a C file with one function per rule plus a decision tree that
+// switches on the opcode of each instruction in the window. the makefile runs this before
+// compiling the compiler, peephole.c calls peephole_match_generated from its rule loop.
+
+typedef enum PGKind {
+    PGKind_REG, // CodegenOperand holding a register
+    PGKind_IMM, // CodegenOperand holding an immediate
+    PGKind_INT, // plain int field
+    PGKind_LABEL, // char* field
+} PGKind;
+
+typedef struct PGMnemonic {
+    char* name;
+    char* opcode; // constant expression, has to agree with the peephole_opcode we emit
+    char* init; // designated initializers for everything but the operands
+    int operand_count;
+    char* fields[3];
+    PGKind kinds[3];
+} PGMnemonic;
+
+#define PG_BINARY(name, op) \
+    {name, "CodegenInstructionType_BINARY * 32 + " op, ".type = CodegenInstructionType_BINARY, .value.binary.op = " op, \
+        3, {"value.binary.left", "value.binary.right", "value.binary.dst"}, {PGKind_REG, PGKind_REG, PGKind_REG}}
+#define PG_UNARY(name, op) \
+    {name, "CodegenInstructionType_UNARY * 32 + " op, ".type = CodegenInstructionType_UNARY, .value.unary.op = " op, \
+        2, {"value.unary.src", "value.unary.dst"}, {PGKind_REG, PGKind_REG, 0}}
+#define PG_JUMP_COND(name, cond) \
+    {name, "CodegenInstructionType_JUMP_COND * 32 + " cond, ".type = CodegenInstructionType_JUMP_COND, .value.jump_cond.cond = " cond, \
+        1, {"value.jump_cond.label", NULL, NULL}, {PGKind_LABEL, 0, 0}}
+
+// operands are in the order the emitter prints them
+PGMnemonic pg_mnemonics[] = {
+    {"mov", "CodegenInstructionType_MOV * 32", ".type = CodegenInstructionType_MOV",
+        2, {"value.two_op.source", "value.two_op.destination", NULL}, {PGKind_REG, PGKind_REG, 0}},
+    {"ldi", "CodegenInstructionType_LDI * 32", ".type = CodegenInstructionType_LDI",
+        2, {"value.two_op.destination", "value.two_op.source", NULL}, {PGKind_REG, PGKind_IMM, 0}},
+    PG_UNARY("neg", "CodegenUnaryOp_NEG"),
+    PG_UNARY("not", "CodegenUnaryOp_NOT"),
+    PG_BINARY("add", "CodegenBinaryOp_ADD"),
+    PG_BINARY("sub", "CodegenBinaryOp_SUB"),
+    PG_BINARY("mul", "CodegenBinaryOp_MUL"),
+    PG_BINARY("div", "CodegenBinaryOp_DIV"),
+    PG_BINARY("mod", "CodegenBinaryOp_MOD"),
+    PG_BINARY("and", "CodegenBinaryOp_BITWISE_AND"),
+    PG_BINARY("or", "CodegenBinaryOp_BITWISE_OR"),
+    PG_BINARY("xor", "CodegenBinaryOp_BITWISE_XOR"),
+    PG_BINARY("shl", "CodegenBinaryOp_LEFT_SHIFT"),
+    PG_BINARY("shr", "CodegenBinaryOp_RIGHT_SHIFT"),
+    PG_BINARY("eq", "CodegenBinaryOp_EQUAL"),
+    PG_BINARY("neq", "CodegenBinaryOp_NOT_EQUAL"),
+    PG_BINARY("lt", "CodegenBinaryOp_LESS"),
+    PG_BINARY("lte", "CodegenBinaryOp_LESS_EQUAL"),
+    PG_BINARY("gt", "CodegenBinaryOp_GREATER"),
+    PG_BINARY("gte", "CodegenBinaryOp_GREATER_EQUAL"),
+    {"lod", "CodegenInstructionType_LOD * 32", ".type = CodegenInstructionType_LOD",
+        3, {"value.mem.address", "value.mem.reg", "value.mem.offset.num"}, {PGKind_REG, PGKind_REG, PGKind_INT}},
+    {"str", "CodegenInstructionType_STR * 32", ".type = CodegenInstructionType_STR",
+        3, {"value.mem.address", "value.mem.reg", "value.mem.offset.num"}, {PGKind_REG, PGKind_REG, PGKind_INT}},
+    {"cmp", "CodegenInstructionType_CMP * 32", ".type = CodegenInstructionType_CMP",
+        2, {"value.cmp.left", "value.cmp.right", NULL}, {PGKind_REG, PGKind_REG, 0}},
+    {"jmp", "CodegenInstructionType_JUMP * 32", ".type = CodegenInstructionType_JUMP",
+        1, {"value.str", NULL, NULL}, {PGKind_LABEL, 0, 0}},
+    PG_JUMP_COND("jc eq", "CodegenCondCode_EQ"),
+    PG_JUMP_COND("jc ne", "CodegenCondCode_NE"),
+    PG_JUMP_COND("jc lt", "CodegenCondCode_LT"),
+    PG_JUMP_COND("jc lte", "CodegenCondCode_LE"),
+    PG_JUMP_COND("jc gt", "CodegenCondCode_GT"),
+    PG_JUMP_COND("jc gte", "CodegenCondCode_GE"),
+    {"label", "CodegenInstructionType_LABEL * 32", ".type = CodegenInstructionType_LABEL",
+        1, {"value.str", NULL, NULL}, {PGKind_LABEL, 0, 0}},
+    {"push", "CodegenInstructionType_PUSH * 32", ".type = CodegenInstructionType_PUSH",
+        1, {"value.single", NULL, NULL}, {PGKind_REG, 0, 0}},
+    {"allocate", "CodegenInstructionType_ALLOCATE_STACK * 32", ".type = CodegenInstructionType_ALLOCATE_STACK",
+        1, {"value.immediate", NULL, NULL}, {PGKind_INT, 0, 0}},
+    {"deallocate", "CodegenInstructionType_DEALLOCATE_STACK * 32", ".type = CodegenInstructionType_DEALLOCATE_STACK",
+        1, {"value.immediate", NULL, NULL}, {PGKind_INT, 0, 0}},
+    {"ret", "CodegenInstructionType_RET * 32", ".type = CodegenInstructionType_RET",
+        0, {NULL, NULL, NULL}, {0, 0, 0}},
+};
+
+#define PG_MNEMONIC_COUNT ((int)(sizeof(pg_mnemonics) / sizeof(pg_mnemonics[0])))
+
+typedef struct PGInstruction {
+    int mnemonic;
+    char* operands[3];
+} PGInstruction;
+
+typedef struct PGCondition {
+    char* kind; // dead, scratch, == or !=
+    char* left;
+    char* right;
+} PGCondition;
+
+typedef VEC(PGInstruction) PGInstructions;
+
+typedef struct PGRule {
+    char* name;
+    int line;
+    PGInstructions pattern;
+    VEC(PGCondition) conditions;
+    PGInstructions replacement;
+} PGRule;
+
+typedef VEC(PGRule) PGRules;
+
+typedef VEC(char*) PGTokens;
+
+typedef struct PGLine {
+    PGTokens tokens;
+    int line;
+} PGLine;
+
+typedef struct PGNode {
+    int mnemonic;
+    VEC(int) rules; // rules whose pattern ends here, in file order
+    VEC(struct PGNode*) children;
+} PGNode;
+
+char* pg_path;
+
+#define pg_error(line, ...) { \
+    fprintf(stderr, "%s:%d: ", pg_path, line); \
+    fprintf(stderr, __VA_ARGS__); \
+    fprintf(stderr, "\n"); \
+    exit(1); \
+}
+
+char* pg_read_file(char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file: %s\n", path);
+        exit(1);
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* buffer = malloc(length + 1);
+    if (fread(buffer, 1, length, file) != length) {
+        fprintf(stderr, "Could not read file: %s\n", path);
+        exit(1);
+    }
+    buffer[length] = '\0';
+
+    fclose(file);
+    return buffer;
+}
+
+PGTokens pg_tokenize(char* line) {
+    PGTokens tokens = {0};
+    for (char* token = strtok(line, " \t\r"); token != NULL; token = strtok(NULL, " \t\r")) {
+        vec_push(tokens, token);
+    }
+    return tokens;
+}
+
+int pg_is_variable(char* operand) {
+    return operand[0] == '%' || operand[0] == '#' || operand[0] == '@';
+}
+
+int pg_is_number(char* operand) {
+    if (*operand == '-') {
+        operand++;
+    }
+    if (*operand == '\0') {
+        return false;
+    }
+    for (; *operand; operand++) {
+        if (*operand < '0' || *operand > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+int pg_is_register(char* operand) {
+    return operand[0] == 'r' && operand[1] != '-' && pg_is_number(operand + 1) && atoi(operand + 1) < 16;
+}
+
+// "%a" -> "reg_a", "#n" -> "imm_n", "@l" -> "label_l", literals -> their value
+char* pg_c_value(char* operand) {
+    char* value = malloc(strlen(operand) + 8);
+    if (operand[0] == '%') {
+        sprintf(value, "reg_%s", operand + 1);
+    } else if (operand[0] == '#') {
+        sprintf(value, "imm_%s", operand + 1);
+    } else if (operand[0] == '@') {
+        sprintf(value, "label_%s", operand + 1);
+    } else if (pg_is_register(operand)) {
+        sprintf(value, "%s", operand + 1);
+    } else {
+        sprintf(value, "%s", operand);
+    }
+    return value;
+}
+
+PGInstruction pg_parse_instruction(PGTokens tokens, int line) {
+    char* name = tokens.data[0];
+    int first_operand = 1;
+    char joined[32];
+    if (!strcmp(name, "jc") && tokens.length > 1) {
+        snprintf(joined, sizeof(joined), "jc %s", tokens.data[1]);
+        name = joined;
+        first_operand = 2;
+    }
+
+    PGInstruction instruction = {.mnemonic = -1};
+    for (int m = 0; m < PG_MNEMONIC_COUNT; m++) {
+        if (!strcmp(pg_mnemonics[m].name, name)) {
+            instruction.mnemonic = m;
+        }
+    }
+    if (instruction.mnemonic == -1) {
+        pg_error(line, "unknown instruction %s", name);
+    }
+
+    PGMnemonic* mnemonic = &pg_mnemonics[instruction.mnemonic];
+    if (tokens.length - first_operand != mnemonic->operand_count) {
+        pg_error(line, "%s takes %d operands", name, mnemonic->operand_count);
+    }
+
+    for (int o = 0; o < mnemonic->operand_count; o++) {
+        char* operand = tokens.data[first_operand + o];
+        int ok = false;
+        switch (mnemonic->kinds[o]) {
+            case PGKind_REG:
+                ok = operand[0] == '%' || pg_is_register(operand);
+                break;
+            case PGKind_IMM:
+            case PGKind_INT:
+                ok = operand[0] == '#' || pg_is_number(operand);
+                break;
+            case PGKind_LABEL:
+                ok = operand[0] == '@';
+                break;
+        }
+        if (!ok) {
+            pg_error(line, "operand %d of %s can't be %s", o + 1, name, operand);
+        }
+        instruction.operands[o] = operand;
+    }
+
+    return instruction;
+}
+
+PGCondition pg_parse_condition(PGTokens tokens, int line) {
+    // tokens[0] is "when"
+    if (tokens.length == 3 && (!strcmp(tokens.data[1], "dead") || !strcmp(tokens.data[1], "scratch"))) {
+        if (tokens.data[2][0] != '%') {
+            pg_error(line, "%s takes a register variable", tokens.data[1]);
+        }
+        return (PGCondition){tokens.data[1], tokens.data[2], NULL};
+    }
+    if (tokens.length == 4 && (!strcmp(tokens.data[2], "==") || !strcmp(tokens.data[2], "!="))) {
+        return (PGCondition){tokens.data[2], tokens.data[1], tokens.data[3]};
+    }
+
+    pg_error(line, "expected 'when dead %%x', 'when scratch %%x' or 'when a == b' / 'when a != b'");
+}
+
+int pg_is_bound(PGInstructions* pattern, char* variable) {
+    for (int i = 0; i < pattern->length; i++) {
+        for (int o = 0; o < pg_mnemonics[pattern->data[i].mnemonic].operand_count; o++) {
+            if (!strcmp(pattern->data[i].operands[o], variable)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void pg_check_bound(PGRule* rule, char* operand) {
+    if (pg_is_variable(operand) && !pg_is_bound(&rule->pattern, operand)) {
+        pg_error(rule->line, "rule %s uses %s without matching it", rule->name, operand);
+    }
+}
+
+// builds one rule from its lines, with $op swapped for op
+PGRule pg_build_rule(char* name, int line, PGLine* lines, int line_count, char* op) {
+    PGRule rule = {.name = name, .line = line};
+    if (op != NULL) {
+        rule.name = malloc(strlen(name) + strlen(op) + 2);
+        sprintf(rule.name, "%s.%s", name, op);
+    }
+
+    int in_replacement = false;
+    for (int l = 0; l < line_count; l++) {
+        PGTokens tokens = {0};
+        for (int t = 0; t < lines[l].tokens.length; t++) {
+            char* token = lines[l].tokens.data[t];
+            vec_push(tokens, !strcmp(token, "$op") && op != NULL ? op : token);
+        }
+
+        if (!strcmp(tokens.data[0], "=>")) {
+            in_replacement = true;
+        } else if (!strcmp(tokens.data[0], "when")) {
+            if (in_replacement) {
+                pg_error(lines[l].line, "conditions go before =>");
+            }
+            PGCondition condition = pg_parse_condition(tokens, lines[l].line);
+            vec_push(rule.conditions, condition);
+        } else if (in_replacement) {
+            PGInstruction instruction = pg_parse_instruction(tokens, lines[l].line);
+            vec_push(rule.replacement, instruction);
+        } else {
+            if (rule.conditions.length > 0) {
+                pg_error(lines[l].line, "conditions go after the whole pattern");
+            }
+            PGInstruction instruction = pg_parse_instruction(tokens, lines[l].line);
+            vec_push(rule.pattern, instruction);
+        }
+
+        vec_free(tokens);
+    }
+
+    if (!in_replacement) {
+        pg_error(line, "rule %s has no =>", rule.name);
+    }
+    if (rule.pattern.length == 0) {
+        pg_error(line, "rule %s has an empty pattern", rule.name);
+    }
+    // keeps the fixpoint loop in peephole.c finite
+    if (rule.replacement.length >= rule.pattern.length) {
+        pg_error(line, "rule %s has to replace its pattern with fewer instructions", rule.name);
+    }
+
+    for (int c = 0; c < rule.conditions.length; c++) {
+        pg_check_bound(&rule, rule.conditions.data[c].left);
+        if (rule.conditions.data[c].right != NULL) {
+            pg_check_bound(&rule, rule.conditions.data[c].right);
+        }
+    }
+    for (int i = 0; i < rule.replacement.length; i++) {
+        PGInstruction* instruction = &rule.replacement.data[i];
+        for (int o = 0; o < pg_mnemonics[instruction->mnemonic].operand_count; o++) {
+            pg_check_bound(&rule, instruction->operands[o]);
+        }
+    }
+
+    return rule;
+}
+
+PGRules pg_parse(char* source) {
+    PGRules rules = {0};
+    VEC(PGLine) lines = {0};
+
+    char* rule_name = NULL;
+    int rule_line = 0;
+    PGTokens ops = {0};
+
+    int line_number = 0;
+    char* line = source;
+    while (line != NULL) {
+        line_number++;
+        char* next = strchr(line, '\n');
+        if (next != NULL) {
+            *next = '\0';
+            next++;
+        }
+
+        PGTokens tokens = pg_tokenize(line);
+        line = next;
+
+        if (tokens.length == 0 || !strncmp(tokens.data[0], "//", 2)) {
+            vec_free(tokens);
+            continue;
+        }
+
+        if (!strcmp(tokens.data[0], "rule")) {
+            if (rule_name != NULL) {
+                pg_error(line_number, "rule %s isn't closed with end", rule_name);
+            }
+            if (tokens.length < 2 || (tokens.length > 2 && (strcmp(tokens.data[2], "for") || tokens.length == 3))) {
+                pg_error(line_number, "expected 'rule <name>' or 'rule <name> for <op>...'");
+            }
+
+            rule_name = tokens.data[1];
+            rule_line = line_number;
+            ops.length = 0;
+            for (int t = 3; t < tokens.length; t++) {
+                vec_push(ops, tokens.data[t]);
+            }
+            vec_free(tokens);
+        } else if (!strcmp(tokens.data[0], "end")) {
+            if (rule_name == NULL) {
+                pg_error(line_number, "end without a rule");
+            }
+
+            if (ops.length == 0) {
+                PGRule rule = pg_build_rule(rule_name, rule_line, lines.data, lines.length, NULL);
+                vec_push(rules, rule);
+            }
+            for (int o = 0; o < ops.length; o++) {
+                PGRule rule = pg_build_rule(rule_name, rule_line, lines.data, lines.length, ops.data[o]);
+                vec_push(rules, rule);
+            }
+
+            for (int l = 0; l < lines.length; l++) {
+                vec_free(lines.data[l].tokens);
+            }
+            lines.length = 0;
+            rule_name = NULL;
+            vec_free(tokens);
+        } else {
+            if (rule_name == NULL) {
+                pg_error(line_number, "expected a rule");
+            }
+            PGLine rule_line_tokens = {tokens, line_number};
+            vec_push(lines, rule_line_tokens);
+        }
+    }
+
+    if (rule_name != NULL) {
+        pg_error(rule_line, "rule %s isn't closed with end", rule_name);
+    }
+
+    vec_free(lines);
+    vec_free(ops);
+    return rules;
+}
+
+typedef VEC(char*) PGNames;
+
+// does every window matching specific also match general? specific's variables are treated as
+// unknown values, so a literal in general only covers the same literal in specific. names/values
+// get what each of general's variables matches in specific
+int pg_bind(PGInstructions* general, PGInstructions* specific, PGNames* names, PGNames* values) {
+    if (general->length != specific->length) {
+        return false;
+    }
+
+    for (int i = 0; i < general->length; i++) {
+        PGInstruction* g = &general->data[i];
+        PGInstruction* s = &specific->data[i];
+        if (g->mnemonic != s->mnemonic) {
+            return false;
+        }
+
+        for (int o = 0; o < pg_mnemonics[g->mnemonic].operand_count; o++) {
+            char* operand = g->operands[o];
+            if (!pg_is_variable(operand)) {
+                if (strcmp(operand, s->operands[o])) {
+                    return false;
+                }
+                continue;
+            }
+
+            int bound = -1;
+            for (int n = 0; n < names->length; n++) {
+                if (!strcmp(names->data[n], operand)) {
+                    bound = n;
+                }
+            }
+            if (bound == -1) {
+                vecptr_push(names, operand);
+                vecptr_push(values, s->operands[o]);
+            } else if (strcmp(values->data[bound], s->operands[o])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int pg_subsumes(PGInstructions* general, PGInstructions* specific) {
+    PGNames names = {0};
+    PGNames values = {0};
+    int result = pg_bind(general, specific, &names, &values);
+    vec_free(names);
+    vec_free(values);
+    return result;
+}
+
+// what a variable of the general rule stands for in the specific one, literals stay as they are
+char* pg_bound_value(PGNames* names, PGNames* values, char* operand) {
+    if (operand == NULL || !pg_is_variable(operand)) {
+        return operand;
+    }
+    for (int n = 0; n < names->length; n++) {
+        if (!strcmp(names->data[n], operand)) {
+            return values->data[n];
+        }
+    }
+    return NULL;
+}
+
+int pg_has_condition(PGRule* rule, char* kind, char* left, char* right) {
+    for (int c = 0; c < rule->conditions.length; c++) {
+        PGCondition* condition = &rule->conditions.data[c];
+        if (strcmp(condition->kind, kind)) {
+            continue;
+        }
+        if (right == NULL) {
+            if (!strcmp(condition->left, left)) {
+                return true;
+            }
+        } else if ((!strcmp(condition->left, left) && !strcmp(condition->right, right)) ||
+            (!strcmp(condition->left, right) && !strcmp(condition->right, left))) {
+            return true; // == and != don't care about the order
+        }
+    }
+    return false;
+}
+
+// does the condition (already in the specific rule's terms) hold whenever the specific rule's do?
+// only what follows directly counts: the same condition, or one that holds for the literals involved
+int pg_implied(PGRule* specific, char* kind, char* left, char* right) {
+    if (left == NULL || (strcmp(kind, "dead") && strcmp(kind, "scratch") && right == NULL)) {
+        return false;
+    }
+    if (!strcmp(kind, "scratch") && pg_is_register(left) && atoi(left + 1) >= 10 && atoi(left + 1) <= 12) {
+        return true;
+    }
+    if (!strcmp(kind, "==") && !strcmp(left, right)) {
+        return true;
+    }
+    if (!strcmp(kind, "!=") && !pg_is_variable(left) && !pg_is_variable(right) && strcmp(left, right)) {
+        return true;
+    }
+    return pg_has_condition(specific, kind, left, right);
+}
+
+// can the general rule fire on every window the specific one fires on?
+int pg_shadows(PGRule* general, PGRule* specific) {
+    PGNames names = {0};
+    PGNames values = {0};
+    int result = pg_bind(&general->pattern, &specific->pattern, &names, &values);
+
+    for (int c = 0; c < general->conditions.length && result; c++) {
+        PGCondition* condition = &general->conditions.data[c];
+        result = pg_implied(specific, condition->kind, pg_bound_value(&names, &values, condition->left),
+            pg_bound_value(&names, &values, condition->right));
+    }
+
+    vec_free(names);
+    vec_free(values);
+    return result;
+}
+
+// where a variable first shows up in the pattern, so rules that only differ in naming compare equal
+int pg_first_use(PGRule* rule, char* operand) {
+    int position = 0;
+    for (int i = 0; i < rule->pattern.length; i++) {
+        for (int o = 0; o < pg_mnemonics[rule->pattern.data[i].mnemonic].operand_count; o++) {
+            if (!strcmp(rule->pattern.data[i].operands[o], operand)) {
+                return position;
+            }
+            position++;
+        }
+    }
+    return -1;
+}
+
+int pg_same_operand(PGRule* a, char* x, PGRule* b, char* y) {
+    if (x == NULL || y == NULL) {
+        return x == y;
+    }
+    if (pg_is_variable(x) != pg_is_variable(y)) {
+        return false;
+    }
+    return pg_is_variable(x) ? pg_first_use(a, x) == pg_first_use(b, y) : !strcmp(x, y);
+}
+
+int pg_same_conditions(PGRule* a, PGRule* b) {
+    if (a->conditions.length != b->conditions.length) {
+        return false;
+    }
+    for (int c = 0; c < a->conditions.length; c++) {
+        PGCondition* x = &a->conditions.data[c];
+        PGCondition* y = &b->conditions.data[c];
+        if (strcmp(x->kind, y->kind) || !pg_same_operand(a, x->left, b, y->left) || !pg_same_operand(a, x->right, b, y->right)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// longer patterns are always tried first, so only rules of the same length can shadow each other.
+// an earlier rule shadows a later one when its pattern is at least as general and each of its
+// conditions is one of the later rule's or holds anyway
+void pg_check_conflicts(PGRules* rules) {
+    for (int b = 0; b < rules->length; b++) {
+        for (int a = 0; a < b; a++) {
+            PGRule* first = &rules->data[a];
+            PGRule* second = &rules->data[b];
+            if (!pg_subsumes(&first->pattern, &second->pattern)) {
+                continue;
+            }
+
+            if (pg_subsumes(&second->pattern, &first->pattern) && pg_same_conditions(first, second)) {
+                pg_error(second->line, "rule %s is a duplicate of rule %s (line %d)", second->name, first->name, first->line);
+            }
+            if (pg_shadows(first, second)) {
+                pg_error(second->line, "rule %s can never fire, rule %s (line %d) matches everything it does",
+                    second->name, first->name, first->line);
+            }
+        }
+    }
+}
+
+PGNode* pg_node_new(int mnemonic) {
+    PGNode* node = calloc(1, sizeof(PGNode));
+    node->mnemonic = mnemonic;
+    return node;
+}
+
+void pg_insert(PGNode* root, PGRule* rule, int rule_index) {
+    PGNode* node = root;
+    for (int i = 0; i < rule->pattern.length; i++) {
+        PGNode* child = NULL;
+        for (int c = 0; c < node->children.length; c++) {
+            if (node->children.data[c]->mnemonic == rule->pattern.data[i].mnemonic) {
+                child = node->children.data[c];
+            }
+        }
+        if (child == NULL) {
+            child = pg_node_new(rule->pattern.data[i].mnemonic);
+            vec_push(node->children, child);
+        }
+        node = child;
+    }
+    vec_push(node->rules, rule_index);
+}
+
+int pg_uses(PGRule* rule, char* variable) {
+    int uses = 0;
+    PGInstructions* lists[2] = {&rule->pattern, &rule->replacement};
+    for (int l = 0; l < 2; l++) {
+        for (int i = 0; i < lists[l]->length; i++) {
+            for (int o = 0; o < pg_mnemonics[lists[l]->data[i].mnemonic].operand_count; o++) {
+                uses += !strcmp(lists[l]->data[i].operands[o], variable);
+            }
+        }
+    }
+    for (int c = 0; c < rule->conditions.length; c++) {
+        uses += !strcmp(rule->conditions.data[c].left, variable);
+        uses += rule->conditions.data[c].right != NULL && !strcmp(rule->conditions.data[c].right, variable);
+    }
+    return uses;
+}
+
+void pg_emit_rule(FILE* out, PGRule* rule, int index) {
+    fprintf(out, "// %s (line %d)\n", rule->name, rule->line);
+    fprintf(out, "int peephole_rule_%d(CodegenFunctionBody* body, int index) {\n", index);
+
+    // declare what gets read more than once, single uses are wildcards
+    PGTokens declared = {0};
+    for (int i = 0; i < rule->pattern.length; i++) {
+        PGInstruction* instruction = &rule->pattern.data[i];
+        for (int o = 0; o < pg_mnemonics[instruction->mnemonic].operand_count; o++) {
+            char* operand = instruction->operands[o];
+            if (!pg_is_variable(operand) || pg_uses(rule, operand) < 2) {
+                continue;
+            }
+            int seen = false;
+            for (int d = 0; d < declared.length; d++) {
+                seen |= !strcmp(declared.data[d], operand);
+            }
+            if (!seen) {
+                vec_push(declared, operand);
+                char* value = pg_c_value(operand);
+                fprintf(out, "    %s %s;\n", operand[0] == '@' ? "char*" : "int", value);
+                free(value);
+            }
+        }
+    }
+
+    PGTokens bound = {0};
+    for (int i = 0; i < rule->pattern.length; i++) {
+        PGInstruction* instruction = &rule->pattern.data[i];
+        PGMnemonic* mnemonic = &pg_mnemonics[instruction->mnemonic];
+        int checked = false;
+        for (int o = 0; o < mnemonic->operand_count; o++) {
+            char* operand = instruction->operands[o];
+            checked |= mnemonic->kinds[o] == PGKind_REG || mnemonic->kinds[o] == PGKind_IMM ||
+                !pg_is_variable(operand) || pg_uses(rule, operand) > 1;
+        }
+        if (!checked) {
+            continue;
+        }
+
+        fprintf(out, "    CodegenInstruction* i%d = &body->data[index + %d];\n", i, i);
+        for (int o = 0; o < mnemonic->operand_count; o++) {
+            char* operand = instruction->operands[o];
+            char field[64];
+            switch (mnemonic->kinds[o]) {
+                case PGKind_REG:
+                case PGKind_IMM:
+                    fprintf(out, "    if (i%d->%s.type != %s) {\n        return false;\n    }\n", i, mnemonic->fields[o],
+                        mnemonic->kinds[o] == PGKind_REG ? "CodegenOperandType_REGISTER" : "CodegenOperandType_IMMEDIATE");
+                    snprintf(field, sizeof(field), "i%d->%s.value.num", i, mnemonic->fields[o]);
+                    break;
+                case PGKind_INT:
+                case PGKind_LABEL:
+                    snprintf(field, sizeof(field), "i%d->%s", i, mnemonic->fields[o]);
+                    break;
+            }
+
+            if (pg_is_variable(operand) && pg_uses(rule, operand) < 2) {
+                continue;
+            }
+
+            int is_bound = false;
+            for (int b = 0; b < bound.length; b++) {
+                is_bound |= !strcmp(bound.data[b], operand);
+            }
+
+            char* value = pg_c_value(operand);
+            if (pg_is_variable(operand) && !is_bound) {
+                fprintf(out, "    %s = %s;\n", value, field);
+                vec_push(bound, operand);
+            } else if (mnemonic->kinds[o] == PGKind_LABEL) {
+                fprintf(out, "    if (strcmp(%s, %s)) {\n        return false;\n    }\n", field, value);
+            } else {
+                fprintf(out, "    if (%s != %s) {\n        return false;\n    }\n", field, value);
+            }
+            free(value);
+        }
+    }
+
+    for (int c = 0; c < rule->conditions.length; c++) {
+        PGCondition* condition = &rule->conditions.data[c];
+        char* left = pg_c_value(condition->left);
+        if (!strcmp(condition->kind, "dead")) {
+            fprintf(out, "    if (!peephole_register_dead_after(body, index + %d, %s)) {\n        return false;\n    }\n",
+                rule->pattern.length - 1, left);
+        } else if (!strcmp(condition->kind, "scratch")) {
+            fprintf(out, "    if (!peephole_is_scratch(%s)) {\n        return false;\n    }\n", left);
+        } else {
+            char* right = pg_c_value(condition->right);
+            int negate = !strcmp(condition->kind, "==");
+            if (condition->left[0] == '@') {
+                fprintf(out, "    if (%sstrcmp(%s, %s)) {\n        return false;\n    }\n", negate ? "" : "!", left, right);
+            } else {
+                fprintf(out, "    if (%s %s %s) {\n        return false;\n    }\n", left, negate ? "!=" : "==", right);
+            }
+            free(right);
+        }
+        free(left);
+    }
+
+    if (rule->replacement.length == 0) {
+        fprintf(out, "\n    peephole_replace(body, index, %d, NULL, 0);\n", rule->pattern.length);
+    } else {
+        fprintf(out, "\n    CodegenInstruction replacement[%d] = {\n", rule->replacement.length);
+        for (int i = 0; i < rule->replacement.length; i++) {
+            PGInstruction* instruction = &rule->replacement.data[i];
+            PGMnemonic* mnemonic = &pg_mnemonics[instruction->mnemonic];
+            fprintf(out, "        {%s", mnemonic->init);
+            for (int o = 0; o < mnemonic->operand_count; o++) {
+                char* value = pg_c_value(instruction->operands[o]);
+                switch (mnemonic->kinds[o]) {
+                    case PGKind_REG:
+                        fprintf(out, ", .%s = {CodegenOperandType_REGISTER, .value.num = %s}", mnemonic->fields[o], value);
+                        break;
+                    case PGKind_IMM:
+                        fprintf(out, ", .%s = {CodegenOperandType_IMMEDIATE, .value.num = %s}", mnemonic->fields[o], value);
+                        break;
+                    case PGKind_INT:
+                    case PGKind_LABEL:
+                        fprintf(out, ", .%s = %s", mnemonic->fields[o], value);
+                        break;
+                }
+                free(value);
+            }
+            fprintf(out, "},\n");
+        }
+        fprintf(out, "    };\n");
+        fprintf(out, "    peephole_replace(body, index, %d, replacement, %d);\n", rule->pattern.length, rule->replacement.length);
+    }
+    fprintf(out, "    return true;\n}\n\n");
+
+    vec_free(declared);
+    vec_free(bound);
+}
+
+void pg_indent(FILE* out, int indent) {
+    for (int i = 0; i < indent; i++) {
+        fprintf(out, "    ");
+    }
+}
+
+void pg_emit_node(FILE* out, PGNode* node, int depth, int indent) {
+    if (node->children.length > 0) {
+        pg_indent(out, indent);
+        fprintf(out, "if (index + %d < body->length) {\n", depth);
+        pg_indent(out, indent + 1);
+        fprintf(out, "switch (peephole_opcode(&body->data[index + %d])) {\n", depth);
+        for (int c = 0; c < node->children.length; c++) {
+            PGNode* child = node->children.data[c];
+            pg_indent(out, indent + 2);
+            fprintf(out, "case %s:\n", pg_mnemonics[child->mnemonic].opcode);
+            pg_emit_node(out, child, depth + 1, indent + 3);
+            pg_indent(out, indent + 3);
+            fprintf(out, "break;\n");
+        }
+        pg_indent(out, indent + 2);
+        fprintf(out, "default:\n");
+        pg_indent(out, indent + 3);
+        fprintf(out, "break;\n");
+        pg_indent(out, indent + 1);
+        fprintf(out, "}\n");
+        pg_indent(out, indent);
+        fprintf(out, "}\n");
+    }
+
+    for (int r = 0; r < node->rules.length; r++) {
+        pg_indent(out, indent);
+        fprintf(out, "if (peephole_rule_%d(body, index)) {\n", node->rules.data[r]);
+        pg_indent(out, indent + 1);
+        fprintf(out, "return %d;\n", node->rules.data[r]);
+        pg_indent(out, indent);
+        fprintf(out, "}\n");
+    }
+}
+
+void pg_emit(FILE* out, PGRules* rules) {
+    fprintf(out, "// generated by peephole_gen from %s, don't edit\n\n", pg_path);
+    fprintf(out, "#include <string.h>\n\n#include \"../src/assembly_gen/peephole.h\"\n#include \"../src/easy_stuff.h\"\n\n");
+
+    fprintf(out, "int peephole_opcode(CodegenInstruction* instruction) {\n");
+    fprintf(out, "    switch (instruction->type) {\n");
+    fprintf(out, "        case CodegenInstructionType_UNARY:\n            return instruction->type * 32 + instruction->value.unary.op;\n");
+    fprintf(out, "        case CodegenInstructionType_BINARY:\n            return instruction->type * 32 + instruction->value.binary.op;\n");
+    fprintf(out, "        case CodegenInstructionType_JUMP_COND:\n            return instruction->type * 32 + instruction->value.jump_cond.cond;\n");
+    fprintf(out, "        default:\n            return instruction->type * 32;\n");
+    fprintf(out, "    }\n}\n\n");
+
+    PGNode* root = pg_node_new(-1);
+    for (int r = 0; r < rules->length; r++) {
+        pg_emit_rule(out, &rules->data[r], r);
+        pg_insert(root, &rules->data[r], r);
+    }
+
+    fprintf(out, "char* peephole_generated_rule_names[] = {\n");
+    for (int r = 0; r < rules->length; r++) {
+        fprintf(out, "    \"%s\",\n", rules->data[r].name);
+    }
+    fprintf(out, "    NULL,\n};\n\n");
+    fprintf(out, "int peephole_generated_rule_count = %d;\n\n", rules->length);
+
+    fprintf(out, "int peephole_match_generated(CodegenFunctionBody* body, int index) {\n");
+    pg_emit_node(out, root, 0, 1);
+    fprintf(out, "    return -1;\n}\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <rules> <output.c>\n", argv[0]);
+        exit(1);
+    }
+
+    pg_path = argv[1];
+    char* source = pg_read_file(pg_path);
+    PGRules rules = pg_parse(source);
+    pg_check_conflicts(&rules);
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open file: %s\n", argv[2]);
+        exit(1);
+    }
+    pg_emit(out, &rules);
+    fclose(out);
+
+    return 0;
+}
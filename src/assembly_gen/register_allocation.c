@@ -0,0 +1,450 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "register_allocation.h"
+#include "linear_scan.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// chaitin-briggs graph coloring
+//
+// build: liveness over the codegen body, every def interferes with everything live after it
+//        (except the source of a move, so moves can be coalesced). the physical registers are
+//        precolored nodes, which is how the calling convention gets in (params in r3-r9,
+//        results in r2, calls clobbering all of them).
+// coalesce: conservative, briggs for two pseudos and george for a pseudo and a register.
+// simplify/select: optimistic, pseudos that don't get a color stay pseudos and end up on the stack,
+//        where fixup's scratch registers deal with them, so nothing has to be rewritten and redone.
+
+int regalloc_find(RAContext* context, int node) {
+    while (context->alias[node] != node) {
+        node = context->alias[node];
+    }
+    return node;
+}
+
+int regalloc_is_precolored(int node) {
+    return node < CG_REGISTER_COUNT;
+}
+
+int regalloc_interferes(RAGraph* graph, int a, int b) {
+    return bitset_has(&graph->matrix[a * graph->words], b);
+}
+
+void regalloc_add_edge(RAGraph* graph, int a, int b) {
+    if (a == b || regalloc_interferes(graph, a, b)) {
+        return;
+    }
+
+    bitset_add(&graph->matrix[a * graph->words], b);
+    bitset_add(&graph->matrix[b * graph->words], a);
+
+    if (!regalloc_is_precolored(a)) {
+        vec_push(graph->neighbors[a], b);
+        graph->degree[a]++;
+    }
+    if (!regalloc_is_precolored(b)) {
+        vec_push(graph->neighbors[b], a);
+        graph->degree[b]++;
+    }
+}
+
+// nodes that are still on the graph (not simplified or merged into something else)
+int regalloc_is_live_node(RAContext* context, int node) {
+    return context->alias[node] == node && !context->removed[node];
+}
+
+void regalloc_build(RAContext* context) {
+    CGFunctionInfo* info = &context->info;
+    RAGraph* graph = &context->graph;
+    int words = info->words;
+
+    unsigned int* live = malloc_n_type(unsigned int, words);
+
+    for (int b = 0; b < info->blocks.length; b++) {
+        CGBlock* block = &info->blocks.data[b];
+        memcpy(live, &info->live_out[b * words], words * sizeof(unsigned int));
+
+        for (int i = block->end - 1; i >= block->start; i--) {
+            CodegenInstruction* instruction = &info->body->data[i];
+            IntVec* uses = &info->uses[i];
+            IntVec* defs = &info->defs[i];
+
+            double weight = 1;
+            for (int d = 0; d < info->loop_depth[i] && d < 6; d++) {
+                weight *= 10;
+            }
+            for (int u = 0; u < uses->length; u++) {
+                context->spill_cost[uses->data[u]] += weight;
+            }
+            for (int d = 0; d < defs->length; d++) {
+                context->spill_cost[defs->data[d]] += weight;
+            }
+
+            int move_src = -1;
+            if (cg_is_move(instruction) && uses->length == 1 && defs->length == 1) {
+                move_src = uses->data[0];
+                RAMove move = {.dst = defs->data[0], .src = move_src};
+                vec_push(context->moves, move);
+            }
+
+            for (int d = 0; d < defs->length; d++) {
+                int def = defs->data[d];
+                for (int w = 0; w < words; w++) {
+                    unsigned int bits = live[w];
+                    while (bits) {
+                        int bit = __builtin_ctz(bits);
+                        bits &= bits - 1;
+                        int node = w * 32 + bit;
+                        if (node != move_src) {
+                            regalloc_add_edge(graph, def, node);
+                        }
+                    }
+                }
+            }
+
+            for (int d = 0; d < defs->length; d++) {
+                bitset_remove(live, defs->data[d]);
+            }
+            for (int u = 0; u < uses->length; u++) {
+                bitset_add(live, uses->data[u]);
+            }
+        }
+    }
+
+    free(live);
+}
+
+// briggs: the merged node has fewer than k neighbors of significant degree
+int regalloc_briggs(RAContext* context, int a, int b) {
+    RAGraph* graph = &context->graph;
+    int significant = 0;
+
+    int nodes[2] = {a, b};
+    for (int n = 0; n < 2; n++) {
+        IntVec* neighbors = &graph->neighbors[nodes[n]];
+        for (int i = 0; i < neighbors->length; i++) {
+            int t = neighbors->data[i];
+            if (!regalloc_is_live_node(context, t)) {
+                continue;
+            }
+            // count neighbors of both only once
+            if (n == 1 && regalloc_interferes(graph, a, t)) {
+                continue;
+            }
+            if (regalloc_is_precolored(t) || graph->degree[t] >= CG_ALLOCATABLE_COUNT) {
+                significant++;
+            }
+        }
+    }
+
+    return significant < CG_ALLOCATABLE_COUNT;
+}
+
+// george: every neighbor of the pseudo already interferes with the register or is harmless
+int regalloc_george(RAContext* context, int reg, int pseudo) {
+    RAGraph* graph = &context->graph;
+    IntVec* neighbors = &graph->neighbors[pseudo];
+
+    for (int i = 0; i < neighbors->length; i++) {
+        int t = neighbors->data[i];
+        // other registers can't end up as `reg` anyway
+        if (!regalloc_is_live_node(context, t) || regalloc_is_precolored(t)) {
+            continue;
+        }
+        if (graph->degree[t] >= CG_ALLOCATABLE_COUNT && !regalloc_interferes(graph, t, reg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void regalloc_merge(RAContext* context, int into, int from) {
+    RAGraph* graph = &context->graph;
+
+    context->alias[from] = into;
+    context->spill_cost[into] += context->spill_cost[from];
+
+    IntVec* neighbors = &graph->neighbors[from];
+    for (int i = 0; i < neighbors->length; i++) {
+        int t = neighbors->data[i];
+        if (!regalloc_is_live_node(context, t)) {
+            continue;
+        }
+        if (!regalloc_is_precolored(t)) {
+            graph->degree[t]--; // loses `from`, add_edge gives it `into` back if it didn't have it
+        }
+        regalloc_add_edge(graph, into, t);
+    }
+}
+
+int regalloc_coalesce(RAContext* context) {
+    int coalesced = 0;
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int m = 0; m < context->moves.length; m++) {
+            int a = regalloc_find(context, context->moves.data[m].dst);
+            int b = regalloc_find(context, context->moves.data[m].src);
+            if (regalloc_is_precolored(b)) {
+                int tmp = a;
+                a = b;
+                b = tmp;
+            }
+
+            if (a == b || regalloc_is_precolored(b) || regalloc_interferes(&context->graph, a, b)) {
+                continue;
+            }
+
+            int ok = regalloc_is_precolored(a) ? regalloc_george(context, a, b) : regalloc_briggs(context, a, b);
+            if (ok) {
+                regalloc_merge(context, a, b);
+                coalesced++;
+                changed = true;
+            }
+        }
+    }
+
+    return coalesced;
+}
+
+void regalloc_color(RAContext* context) {
+    RAGraph* graph = &context->graph;
+    int node_count = graph->node_count;
+    IntVec stack = {0};
+
+    int remaining = 0;
+    for (int n = CG_REGISTER_COUNT; n < node_count; n++) {
+        if (regalloc_is_live_node(context, n)) {
+            remaining++;
+        }
+    }
+
+    // simplify, and when everything left is significant push the cheapest one optimistically
+    while (remaining > 0) {
+        int picked = -1;
+        for (int n = CG_REGISTER_COUNT; n < node_count; n++) {
+            if (regalloc_is_live_node(context, n) && graph->degree[n] < CG_ALLOCATABLE_COUNT) {
+                picked = n;
+                break;
+            }
+        }
+
+        if (picked == -1) {
+            double best = 0;
+            for (int n = CG_REGISTER_COUNT; n < node_count; n++) {
+                if (!regalloc_is_live_node(context, n)) {
+                    continue;
+                }
+                double cost = context->spill_cost[n] / (graph->degree[n] + 1);
+                if (picked == -1 || cost < best) {
+                    picked = n;
+                    best = cost;
+                }
+            }
+        }
+
+        context->removed[picked] = true;
+        remaining--;
+        vec_push(stack, picked);
+
+        IntVec* neighbors = &graph->neighbors[picked];
+        for (int i = 0; i < neighbors->length; i++) {
+            int t = neighbors->data[i];
+            if (regalloc_is_live_node(context, t) && !regalloc_is_precolored(t)) {
+                graph->degree[t]--;
+            }
+        }
+    }
+
+    // select
+    while (stack.length > 0) {
+        int node = stack.data[--stack.length];
+
+        int used[CG_REGISTER_COUNT] = {0};
+        IntVec* neighbors = &graph->neighbors[node];
+        for (int i = 0; i < neighbors->length; i++) {
+            int t = regalloc_find(context, neighbors->data[i]);
+            if (regalloc_is_precolored(t)) {
+                used[t] = true;
+            } else if (context->color[t] != -1) {
+                used[context->color[t]] = true;
+            }
+        }
+
+        for (int r = 0; r < CG_ALLOCATABLE_COUNT; r++) {
+            int reg = cg_allocatable_register(r);
+            if (!used[reg]) {
+                context->color[node] = reg;
+                break;
+            }
+        }
+    }
+
+    vec_free(stack);
+}
+
+int regalloc_same_location(CodegenOperand a, CodegenOperand b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    if (a.type == CodegenOperandType_REGISTER) {
+        return a.value.num == b.value.num;
+    }
+    if (a.type == CodegenOperandType_PSEUDO) {
+        return !strcmp(a.value.identifier, b.value.identifier);
+    }
+    return false;
+}
+
+void allocate_registers_rewrite(CodegenFunctionDefinition* function, CGFunctionInfo* info, int* alias, int* color) {
+    CodegenFunctionBody new_body = {0};
+    CodegenOperandRefs uses = {0};
+    CodegenOperandRefs defs = {0};
+
+    for (int i = 0; i < function->body.length; i++) {
+        CodegenInstruction instruction = function->body.data[i];
+
+        uses.length = 0;
+        defs.length = 0;
+        cg_instruction_operands(&instruction, &uses, &defs);
+        for (int o = 0; o < uses.length + defs.length; o++) {
+            CodegenOperand* operand = o < uses.length ? uses.data[o] : defs.data[o - uses.length];
+            if (operand->type != CodegenOperandType_PSEUDO) {
+                continue;
+            }
+            int node = cg_operand_node(info, *operand);
+            if (node == -1) {
+                continue; // static
+            }
+
+            while (alias[node] != node) {
+                node = alias[node];
+            }
+
+            if (regalloc_is_precolored(node)) {
+                *operand = (CodegenOperand){CodegenOperandType_REGISTER, .value.num = node};
+            } else if (color[node] != -1) {
+                *operand = (CodegenOperand){CodegenOperandType_REGISTER, .value.num = color[node]};
+            } else {
+                // coalesced pseudos that spill share one slot
+                operand->value.identifier = info->names[node - CG_REGISTER_COUNT];
+            }
+        }
+
+        if (cg_is_move(&instruction) && regalloc_same_location(instruction.value.two_op.source, instruction.value.two_op.destination)) {
+            continue;
+        }
+
+        vec_push(new_body, instruction);
+    }
+
+    vec_free(uses);
+    vec_free(defs);
+    vec_free(function->body);
+    function->body = new_body;
+}
+
+CodegenFunctionDefinition allocate_registers_function(CodegenFunctionDefinition function, TCSymbols* symbols) {
+    RAContext context = {
+        .info = cg_analyze_function(&function, symbols),
+        .moves = {0},
+    };
+
+    int node_count = context.info.node_count;
+    int words = bitset_words(node_count);
+    context.graph = (RAGraph){
+        .node_count = node_count,
+        .words = words,
+        .matrix = calloc((size_t)node_count * words, sizeof(unsigned int)),
+        .neighbors = calloc(node_count, sizeof(IntVec)),
+        .degree = calloc(node_count, sizeof(int)),
+    };
+    context.alias = malloc_n_type(int, node_count);
+    context.removed = calloc(node_count, sizeof(int));
+    context.color = malloc_n_type(int, node_count);
+    context.spill_cost = calloc(node_count, sizeof(double));
+    for (int n = 0; n < node_count; n++) {
+        context.alias[n] = n;
+        context.color[n] = regalloc_is_precolored(n) ? n : -1;
+    }
+
+    regalloc_build(&context);
+    regalloc_coalesce(&context);
+    regalloc_color(&context);
+
+    allocate_registers_rewrite(&function, &context.info, context.alias, context.color);
+
+    for (int n = 0; n < node_count; n++) {
+        vec_free(context.graph.neighbors[n]);
+    }
+    free(context.graph.matrix);
+    free(context.graph.neighbors);
+    free(context.graph.degree);
+    free(context.alias);
+    free(context.removed);
+    free(context.color);
+    free(context.spill_cost);
+    vec_free(context.moves);
+    cg_free_function_info(&context.info);
+
+    return function;
+}
+
+// pseudos that aren't statics, and their names if `names` isn't NULL
+int allocate_registers_count_pseudos(CodegenFunctionDefinition* function, TCSymbols* symbols, char** names) {
+    CGFunctionInfo info = cg_analyze_function(function, symbols);
+    int count = info.node_count - CG_REGISTER_COUNT;
+    if (names != NULL) {
+        int length = 0;
+        for (int p = 0; p < count; p++) {
+            length += strlen(info.names[p]) + 2;
+        }
+        *names = calloc(length + 1, 1);
+        for (int p = 0; p < count; p++) {
+            strcat(*names, info.names[p]);
+            if (p + 1 < count) {
+                strcat(*names, ", ");
+            }
+        }
+    }
+    cg_free_function_info(&info);
+    return count;
+}
+
+void allocate_registers_remark(CodegenFunctionDefinition* function, TCSymbols* symbols, int pseudos) {
+    char* names = NULL;
+    int spilled = allocate_registers_count_pseudos(function, symbols, &names);
+    if (pseudos > spilled) {
+        remark(RemarkKind_Passed, "regalloc", "Allocated", function->identifier, "%d of %d pseudos got a register",
+            pseudos - spilled, pseudos);
+    }
+    if (spilled > 0) {
+        remark(RemarkKind_Missed, "regalloc", "Spilled", function->identifier, "%d pseudos spilled to the stack: %s",
+            spilled, names);
+    }
+    free(names);
+}
+
+CodegenProgram allocate_registers(CodegenProgram program, TCSymbols* symbols, RegallocMode mode) {
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty != CGTFunction) {
+            continue;
+        }
+
+        int pseudos = remarks_enabled() ? allocate_registers_count_pseudos(&program.data[i].val.function, symbols, NULL) : 0;
+
+        if (mode == RegallocMode_LinearScan) {
+            program.data[i].val.function = linear_scan_function(program.data[i].val.function, symbols);
+        } else {
+            program.data[i].val.function = allocate_registers_function(program.data[i].val.function, symbols);
+        }
+
+        if (remarks_enabled()) {
+            allocate_registers_remark(&program.data[i].val.function, symbols, pseudos);
+        }
+    }
+
+    return program;
+}
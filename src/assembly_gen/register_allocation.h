@@ -0,0 +1,48 @@
+#ifndef REGISTER_ALLOCATION_H
+#define REGISTER_ALLOCATION_H
+
+#include "code_gen.h"
+#include "codegen_analysis.h"
+#include "../semantic_analysis/type_checking.h"
+
+typedef struct RAMove {
+    int dst;
+    int src;
+} RAMove;
+
+typedef struct RAGraph {
+    int node_count;
+    int words; // words per matrix row
+    unsigned int* matrix; // node * words, interference bits
+    IntVec* neighbors; // only kept for pseudos
+    int* degree;
+} RAGraph;
+
+typedef struct RAContext {
+    CGFunctionInfo info;
+    RAGraph graph;
+    struct {
+        RAMove* data;
+        int length;
+        int capacity;
+    } moves;
+    int* alias; // coalesced nodes point at the node they got merged into
+    int* removed; // taken off the graph by simplify
+    int* color; // register or -1 for spilled
+    double* spill_cost;
+} RAContext;
+
+typedef enum RegallocMode {
+    RegallocMode_Coloring, // iterated coalescing graph coloring, the default
+    RegallocMode_LinearScan, // cheaper to run, worse code around calls and loops
+} RegallocMode;
+
+// pseudos that get a register are replaced by it, the rest stay pseudos for replace_pseudo to put on the stack
+CodegenProgram allocate_registers(CodegenProgram program, TCSymbols* symbols, RegallocMode mode);
+CodegenFunctionDefinition allocate_registers_function(CodegenFunctionDefinition function, TCSymbols* symbols);
+int allocate_registers_count_pseudos(CodegenFunctionDefinition* function, TCSymbols* symbols, char** names);
+void allocate_registers_remark(CodegenFunctionDefinition* function, TCSymbols* symbols, int pseudos);
+// rewrites the operands once every node has a color, and drops the moves that became no-ops
+void allocate_registers_rewrite(CodegenFunctionDefinition* function, CGFunctionInfo* info, int* alias, int* color);
+
+#endif
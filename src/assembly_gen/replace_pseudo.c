@@ -4,6 +4,8 @@
 
 #include "../easy_stuff.h"
 #include "replace_pseudo.h"
+#include "codegen_analysis.h"
+#include "../remarks.h"
 
 struct ReplaceResult replace_pseudo(CodegenProgram program, TCSymbols* symbol_table) {
     struct ReplaceResult new_program = {0};
@@ -18,6 +20,7 @@ struct ReplaceResult replace_pseudo(CodegenProgram program, TCSymbols* symbol_ta
                     .ty=CGTFunction,
                     .val.function=function.function
                 };
+                vec_push(new_program.offsets, function.offset);
                 break;
             }
             case CGTStatic: {
@@ -35,22 +38,127 @@ struct FuncAndOffset replace_pseudo_function(CodegenFunctionDefinition function,
 
     new_function.function.identifier = function.identifier;
     new_function.function.global = function.global;
+    new_function.function.param_count = function.param_count;
     CodegenFunctionBody new_body = {NULL, 0, 0};
 
-    PseudoInfoMap map = { -2, 0, 0, NULL };
+    // push stores at r14 and then moves it down, so after the prologue fp itself is the first free word
+    // and r14 has to end up below the last slot
+    PseudoInfoMap map = { 0, 0, 0, NULL };
+    int unshared_offset = replace_pseudo_color_slots(&function, &map, symbol_table);
 
     for (int i = 0; i < function.body.length; i++) {
         CodegenInstruction instruction = replace_pseudo_instruction(function.body.data[i], &map, symbol_table);
+
+        // a move between two spills that ended up sharing a slot
+        if (instruction.type == CodegenInstructionType_MOV &&
+            instruction.value.two_op.source.type == CodegenOperandType_STACK &&
+            instruction.value.two_op.destination.type == CodegenOperandType_STACK &&
+            instruction.value.two_op.source.value.num == instruction.value.two_op.destination.value.num) {
+            continue;
+        }
+
         vec_push(new_body, instruction);
     }
 
     new_function.function.body = new_body;
 
-    new_function.offset = -(map.current_idx + 2);
+    new_function.offset = -map.current_idx;
+
+    if (unshared_offset > new_function.offset) {
+        remark_stats("stack slots %s: %d -> %d bytes\n", function.identifier, unshared_offset, new_function.offset);
+    }
+
+    free(map.map_start);
 
     return new_function;
 }
 
+// spilled pseudos whose live ranges never overlap can share a slot, which is just graph coloring
+// again with an unlimited number of colors. fills the map with the slots and returns the frame
+// size it would've been with one slot each
+int replace_pseudo_color_slots(CodegenFunctionDefinition* function, PseudoInfoMap* map, TCSymbols* symbol_table) {
+    CGFunctionInfo info = cg_analyze_function(function, symbol_table);
+    int pseudo_count = info.node_count - CG_REGISTER_COUNT;
+    if (pseudo_count == 0) {
+        cg_free_function_info(&info);
+        return 0;
+    }
+
+    int words = bitset_words(pseudo_count);
+    unsigned int* interference = calloc((size_t)pseudo_count * words, sizeof(unsigned int));
+    unsigned int* live = malloc_n_type(unsigned int, info.words);
+
+    for (int b = 0; b < info.blocks.length; b++) {
+        CGBlock* block = &info.blocks.data[b];
+        memcpy(live, &info.live_out[b * info.words], info.words * sizeof(unsigned int));
+
+        for (int i = block->end - 1; i >= block->start; i--) {
+            int move_source = cg_is_move(&info.body->data[i]) && info.uses[i].length == 1 ? info.uses[i].data[0] : -1;
+
+            for (int d = 0; d < info.defs[i].length; d++) {
+                int def = info.defs[i].data[d] - CG_REGISTER_COUNT;
+                if (def < 0) {
+                    continue;
+                }
+
+                for (int w = 0; w < info.words; w++) {
+                    unsigned int bits = live[w];
+                    while (bits) {
+                        int node = w * 32 + __builtin_ctz(bits);
+                        bits &= bits - 1;
+
+                        int other = node - CG_REGISTER_COUNT;
+                        if (other >= 0 && other != def && node != move_source) {
+                            bitset_add(&interference[def * words], other);
+                            bitset_add(&interference[other * words], def);
+                        }
+                    }
+                }
+            }
+
+            for (int d = 0; d < info.defs[i].length; d++) {
+                bitset_remove(live, info.defs[i].data[d]);
+            }
+            for (int u = 0; u < info.uses[i].length; u++) {
+                bitset_add(live, info.uses[i].data[u]);
+            }
+        }
+    }
+
+    // first come first served, in the order the pseudos show up
+    int* slot = malloc_n_type(int, pseudo_count);
+    int slot_count = 0;
+    unsigned int* taken = malloc_n_type(unsigned int, bitset_words(pseudo_count));
+    for (int p = 0; p < pseudo_count; p++) {
+        memset(taken, 0, bitset_words(pseudo_count) * sizeof(unsigned int));
+        for (int q = 0; q < p; q++) {
+            if (bitset_has(&interference[p * words], q)) {
+                bitset_add(taken, slot[q]);
+            }
+        }
+
+        slot[p] = 0;
+        while (bitset_has(taken, slot[p])) {
+            slot[p]++;
+        }
+        if (slot[p] == slot_count) {
+            slot_count++;
+        }
+
+        pseudomap_insert(map, info.names[p]);
+        map->map_start[map->pseudo_count - 1].idx = -2 * slot[p];
+    }
+    map->current_idx = -2 * slot_count;
+
+    free(slot);
+    free(taken);
+    free(live);
+    free(interference);
+    cg_free_function_info(&info);
+
+    return 2 * pseudo_count;
+}
+
 CodegenInstruction replace_pseudo_instruction(CodegenInstruction instruction, PseudoInfoMap* map, TCSymbols* symbol_table) {
     switch (instruction.type) {
         case CodegenInstructionType_MOV:
@@ -82,6 +190,9 @@ CodegenInstruction replace_pseudo_instruction(CodegenInstruction instruction, Ps
         case CodegenInstructionType_PUSH:
             instruction.value.single = replace_pseudo_operand(instruction.value.single, map, symbol_table);
             break;
+        case CodegenInstructionType_JUMP_TABLE:
+            instruction.value.jump_table.index = replace_pseudo_operand(instruction.value.jump_table.index, map, symbol_table);
+            break;
         case CodegenInstructionType_DEALLOCATE_STACK:
         case CodegenInstructionType_CALL:
         case CodegenInstructionType_JUMP:
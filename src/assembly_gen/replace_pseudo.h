@@ -35,6 +35,7 @@ struct ReplaceResult {
 
 struct ReplaceResult replace_pseudo(CodegenProgram program, TCSymbols* symbol_table);
 struct FuncAndOffset replace_pseudo_function(CodegenFunctionDefinition function, TCSymbols* symbol_table);
+int replace_pseudo_color_slots(CodegenFunctionDefinition* function, PseudoInfoMap* map, TCSymbols* symbol_table);
 CodegenFunctionBody replace_pseudo_function_body(CodegenFunctionBody body, TCSymbols* symbol_table);
 CodegenInstruction replace_pseudo_instruction(CodegenInstruction instruction, PseudoInfoMap* map, TCSymbols* symbol_table);
 CodegenOperand replace_pseudo_operand(CodegenOperand operand, PseudoInfoMap* map, TCSymbols* symbol_table);
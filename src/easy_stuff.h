@@ -41,6 +41,12 @@
 #define vec_free(vec) \
     free((vec).data)
 
+// sets of small ints packed into unsigned int words
+#define bitset_words(bits) ((bits) / 32 + 1)
+#define bitset_add(set, idx) ((set)[(idx) / 32] |= 1u << ((idx) % 32))
+#define bitset_remove(set, idx) ((set)[(idx) / 32] &= ~(1u << ((idx) % 32)))
+#define bitset_has(set, idx) (((set)[(idx) / 32] >> ((idx) % 32)) & 1)
+
 int quick_log10(int n);
 
 #define malloc_type(T) (T*)malloc(sizeof(T))
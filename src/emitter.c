@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 #include "emitter.h"
 #include "easy_stuff.h"
@@ -17,7 +18,29 @@ char* emit_program(CodegenProgram program) {
             output = realloc(output, sizeof(char*) * output_capacity);
         }
 
-        char* function = emit_function_definition(program.data[i]);
+        if (program.data[i].ty != CGTStatic) {
+            continue;
+        }
+
+        char* static_var = emit_static_variable(program.data[i].val.static_var);
+
+        total_length += strlen(static_var);
+
+        output[output_length++] = static_var;
+    }
+
+    // the assembler can't handle a static as the last line of the file, so they all go before the functions
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty != CGTFunction) {
+            continue;
+        }
+
+        if (output_length == output_capacity) {
+            output_capacity = output_capacity == 0 ? 1 : output_capacity * 2;
+            output = realloc(output, sizeof(char*) * output_capacity);
+        }
+
+        char* function = emit_function_definition(program.data[i].val.function);
 
         total_length += strlen(function);
 
@@ -37,15 +60,36 @@ char* emit_program(CodegenProgram program) {
     return final_output;
 }
 
-char* emit_function_definition(CodegenFunctionDefinition function) {
-    char* output = (char*)malloc(strlen(function.identifier) + (function.global ? 35 : 27));
-    if (function.global) {
-        sprintf(output, ".global\n%s:\npush r15\nadd r14 r0 r15\n", function.identifier);
-    } else {
-        sprintf(output, "%s:\npush r15\nadd r14 r0 r15\n", function.identifier);
+// sprintf into a buffer sized from the format, for lines with names in them
+char* emit_format(char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    char* output = length < 0 ? NULL : malloc(length + 1);
+    if (output == NULL) {
+        fprintf(stderr, "Error allocating %d bytes for the assembly\n", length + 1);
+        exit(1);
     }
 
-    char* function_body = emit_function_body(function.body);
+    va_start(args, format);
+    vsnprintf(output, length + 1, format, args);
+    va_end(args);
+
+    return output;
+}
+
+char* emit_static_variable(CodegenStatic var) {
+    // statics are a single 16 bit word, little endian
+    return emit_format(".static %s: 2: %d, %d\n", var.identifier, var.init & 0xff, (var.init >> 8) & 0xff);
+}
+
+char* emit_function_definition(CodegenFunctionDefinition function) {
+    char* prologue = function.frameless ? "" : "push r15\nadd r14 r0 r15\n";
+    char* output = emit_format("%s%s:\n%s", function.global ? ".global\n" : "", function.identifier, prologue);
+
+    char* function_body = emit_function_body(function.body, function.frameless);
     output = realloc(output, strlen(output) + strlen(function_body) + 1);
     strcat(output, function_body);
 
@@ -53,12 +97,14 @@ char* emit_function_definition(CodegenFunctionDefinition function) {
 
     return output;
 }
-char* emit_function_body(CodegenFunctionBody body) {
+char* emit_function_body(CodegenFunctionBody body, int frameless) {
     char* output = (char*)malloc(1);
     output[0] = '\0';
 
     for (int i = 0; i < body.length; i++) {
-        char* instruction = emit_instruction(body.data[i]);
+        // a frameless function already put r14 back, there's no r15 to restore
+        char* instruction = frameless && body.data[i].type == CodegenInstructionType_RET ?
+            strdup("ret\n") : emit_instruction(body.data[i]);
         output = realloc(output, strlen(output) + strlen(instruction) + 1);
         strcat(output, instruction);
         free(instruction);
@@ -165,19 +211,19 @@ char* emit_instruction(CodegenInstruction instruction) {
                     op = "eq";
                     break;
                 case CodegenBinaryOp_NOT_EQUAL:
-                    op = "ne";
+                    op = "neq";
                     break;
                 case CodegenBinaryOp_LESS:
                     op = "lt";
                     break;
                 case CodegenBinaryOp_LESS_EQUAL:
-                    op = "le";
+                    op = "lte";
                     break;
                 case CodegenBinaryOp_GREATER:
                     op = "gt";
                     break;
                 case CodegenBinaryOp_GREATER_EQUAL:
-                    op = "ge";
+                    op = "gte";
                     break;
 
                 default:
@@ -195,19 +241,19 @@ char* emit_instruction(CodegenInstruction instruction) {
             return output;
         }
         case CodegenInstructionType_ALLOCATE_STACK: {
-            char* output = malloc(26 + quick_log10(instruction.value.immediate));
+            char* output = malloc(27 + quick_log10(instruction.value.immediate));
             sprintf(output, "ldi r10 %d\nsub r14 r10 r14\n", instruction.value.immediate);
 
             return output;
         }
         case CodegenInstructionType_DEALLOCATE_STACK: {
-            char* output = malloc(26 + quick_log10(instruction.value.immediate));
+            char* output = malloc(27 + quick_log10(instruction.value.immediate));
             sprintf(output, "ldi r10 %d\nadd r14 r10 r14\n", instruction.value.immediate);
 
             return output;
         }
         case CodegenInstructionType_CALL: {
-            char* output = malloc(7 + quick_log10(strlen(instruction.value.str)));
+            char* output = malloc(7 + strlen(instruction.value.str));
             sprintf(output, "call %s\n", instruction.value.str);
 
             return output;
@@ -221,25 +267,35 @@ char* emit_instruction(CodegenInstruction instruction) {
             return output;
         }
         case CodegenInstructionType_LOD: {
-            char* address = emit_operand(instruction.value.mem.address);
             char* reg = emit_operand(instruction.value.mem.reg);
 
-            char* output = malloc(strlen(address) + strlen(reg) + 8);
-            sprintf(output, "lod %s %s %d\n", address, reg, instruction.value.mem.offset);
+            char* output;
+            if (instruction.value.mem.address.type == CodegenOperandType_DATA) {
+                output = emit_format("lod r0 %s %s\n", reg, instruction.value.mem.offset.data);
+            } else {
+                char* address = emit_operand(instruction.value.mem.address);
+                output = malloc(strlen(address) + strlen(reg) + quick_log10(abs(instruction.value.mem.offset.num)) + 9);
+                sprintf(output, "lod %s %s %d\n", address, reg, instruction.value.mem.offset.num);
+                free(address);
+            }
 
-            free(address);
             free(reg);
 
             return output;
         }
         case CodegenInstructionType_STR: {
-            char* address = emit_operand(instruction.value.mem.address);
             char* reg = emit_operand(instruction.value.mem.reg);
 
-            char* output = malloc(strlen(address) + strlen(reg) + 8);
-            sprintf(output, "str %s %s %d\n", address, reg, instruction.value.mem.offset);
+            char* output;
+            if (instruction.value.mem.address.type == CodegenOperandType_DATA) {
+                output = emit_format("str r0 %s %s\n", reg, instruction.value.mem.offset.data);
+            } else {
+                char* address = emit_operand(instruction.value.mem.address);
+                output = malloc(strlen(address) + strlen(reg) + quick_log10(abs(instruction.value.mem.offset.num)) + 9);
+                sprintf(output, "str %s %s %d\n", address, reg, instruction.value.mem.offset.num);
+                free(address);
+            }
 
-            free(address);
             free(reg);
 
             return output;
@@ -298,6 +354,26 @@ char* emit_instruction(CodegenInstruction instruction) {
 
             return output;
         }
+        case CodegenInstructionType_JUMP_TABLE: {
+            // every `jmp label` in the table takes 3 bytes, so the entry is at table + 3 * index
+            char* index = emit_operand(instruction.value.jump_table.index);
+            char* table = instruction.value.jump_table.table;
+
+            char* output = malloc(3 * strlen(index) + 2 * strlen(table) + 60);
+            sprintf(output, "add %s %s r10\nadd r10 %s r10\nldi r11 %s\nadd r10 r11 r10\njmp r10\n%s:\n",
+                index, index, index, table, table);
+            for (int i = 0; i < instruction.value.jump_table.count; i++) {
+                char* label = instruction.value.jump_table.labels[i];
+                output = realloc(output, strlen(output) + strlen(label) + 6);
+                strcat(output, "jmp ");
+                strcat(output, label);
+                strcat(output, "\n");
+            }
+
+            free(index);
+
+            return output;
+        }
         case CodegenInstructionType_LABEL: {
             char* output = malloc(3 + strlen(instruction.value.str));
             sprintf(output, "%s:\n", instruction.value.str);
@@ -317,12 +393,12 @@ char* emit_instruction(CodegenInstruction instruction) {
 char* emit_operand(CodegenOperand operand) {
     switch (operand.type) {
         case CodegenOperandType_REGISTER: {
-            char* output = malloc(quick_log10(operand.value.num) + 2);
+            char* output = malloc(quick_log10(operand.value.num) + 3); // quick_log10(0) is 0
             sprintf(output, "r%d", operand.value.num);
             return output;
         }
         case CodegenOperandType_IMMEDIATE: {
-            char* output = malloc(quick_log10(operand.value.num) + 2);
+            char* output = malloc(12); // any int, sign included
             sprintf(output, "%d", operand.value.num);
             return output;
         }
@@ -4,8 +4,10 @@
 #include "assembly_gen/code_gen.h"
 
 char* emit_program(CodegenProgram program);
+char* emit_format(char* format, ...) __attribute__((format(printf, 1, 2)));
+char* emit_static_variable(CodegenStatic var);
 char* emit_function_definition(CodegenFunctionDefinition function);
-char* emit_function_body(CodegenFunctionBody body);
+char* emit_function_body(CodegenFunctionBody body, int frameless);
 char* emit_instruction(CodegenInstruction instruction);
 char* emit_operand(CodegenOperand operand);
 
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "asprintf.h"
 
 #include "parser.h"
@@ -27,7 +28,8 @@ void convert_symbols_to_tacky(TCSymbols* symbol_table, IRProgram* program) {
                     IRStaticVariable sv = {
                         .identifier=name,
                         .global=attr.vals.StaticAttr.global,
-                        .init=init.val
+                        .init=init.val,
+                        .initialized=true
                     };
                     IRTopLevel tl = {
                         .ty=IRTStatic,
@@ -40,7 +42,8 @@ void convert_symbols_to_tacky(TCSymbols* symbol_table, IRProgram* program) {
                     IRStaticVariable sv = {
                         .identifier=name,
                         .global=attr.vals.StaticAttr.global,
-                        .init=0
+                        .init=0,
+                        .initialized=false
                     };
                     IRTopLevel tl = {
                         .ty=IRTStatic,
@@ -102,6 +105,7 @@ IROptionalFN ir_generate_function(IRGenerator* generator, FunctionDefinition fun
         ir_function.params.data = NULL;
     }
 
+    ir_sort_switch_cases(&generator->switch_cases[function_idx]);
     ir_generate_block(generator, function.body.data, &ir_function.body, function_idx);
 
     IRInstruction final_return = {
@@ -143,7 +147,8 @@ void ir_generate_declaration(IRGenerator* generator, Declaration declaration, IR
 }
 
 void ir_generate_variable_declaration(IRGenerator* generator, VariableDeclaration declaration, IRFunctionBody* instructions) {
-    if (!declaration.expression.is_some) {
+    // statics get their initial value once, in the data section
+    if (!declaration.expression.is_some || declaration.storage_class != StorageClass_DEFAULT) {
         return;
     }
 
@@ -180,22 +185,10 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
             break;
         }
         case StatementType_IF: {
-            IRVal condition = ir_generate_expression(generator, statement.value.if_statement.condition, instructions);
-
             char* else_label = ir_make_temp_name(generator);
             char* end_label = ir_make_temp_name(generator);
 
-            IRInstruction jump_else = {
-                .type = IRInstructionType_JumpIfZero,
-                .value = {
-                    .jump_cond = {
-                        .val = condition,
-                        .label = else_label,
-                    },
-                },
-            };
-
-            vecptr_push(instructions, jump_else);
+            ir_generate_condition(generator, statement.value.if_statement.condition, NULL, else_label, instructions);
 
             ir_generate_statement(generator, *statement.value.if_statement.then_block, instructions, function_idx);
 
@@ -245,6 +238,13 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
             break;
         }
         case StatementType_WHILE: {
+            // rotated into a guarded do-while, so an iteration only runs the one conditional jump at the bottom
+            char* top_label;
+            if (0>asprintf(&top_label, ".%d.loop.top", statement.value.loop_statement.label)) {
+                fprintf(stderr, "Error creating top label\n");
+                exit(1);
+            }
+
             char* continue_label;
             if (0>asprintf(&continue_label, ".%d.loop.continue", statement.value.loop_statement.label)) {
                 fprintf(stderr, "Error creating continue label\n");
@@ -257,39 +257,29 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
                 exit(1);
             }
 
-            IRInstruction continue_label_instruction = {
-                .type = IRInstructionType_Label,
-                .value = {
-                    .label = continue_label,
-                },
-            };
+            ir_generate_condition(generator, statement.value.loop_statement.condition, NULL, break_label, instructions);
 
-            vecptr_push(instructions, continue_label_instruction);
-
-            IRVal condition = ir_generate_expression(generator, statement.value.loop_statement.condition, instructions);
-
-            IRInstruction jump_break = {
-                .type = IRInstructionType_JumpIfZero,
+            IRInstruction top_label_instruction = {
+                .type = IRInstructionType_Label,
                 .value = {
-                    .jump_cond = {
-                        .val = condition,
-                        .label = break_label,
-                    },
+                    .label = top_label,
                 },
             };
 
-            vecptr_push(instructions, jump_break);
+            vecptr_push(instructions, top_label_instruction);
 
             ir_generate_statement(generator, *statement.value.loop_statement.body, instructions, function_idx);
 
-            IRInstruction jump_continue = {
-                .type = IRInstructionType_Jump,
+            IRInstruction continue_label_instruction = {
+                .type = IRInstructionType_Label,
                 .value = {
                     .label = continue_label,
                 },
             };
 
-            vecptr_push(instructions, jump_continue);
+            vecptr_push(instructions, continue_label_instruction);
+
+            ir_generate_condition(generator, statement.value.loop_statement.condition, top_label, NULL, instructions);
 
             IRInstruction break_label_instruction = {
                 .type = IRInstructionType_Label,
@@ -341,19 +331,7 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
 
             vecptr_push(instructions, continue_label_instruction);
 
-            IRVal condition = ir_generate_expression(generator, statement.value.loop_statement.condition, instructions);
-
-            IRInstruction jump_top = {
-                .type = IRInstructionType_JumpIfNotZero,
-                .value = {
-                    .jump_cond = {
-                        .val = condition,
-                        .label = top_label,
-                    },
-                },
-            };
-
-            vecptr_push(instructions, jump_top);
+            ir_generate_condition(generator, statement.value.loop_statement.condition, top_label, NULL, instructions);
 
             IRInstruction break_label_instruction = {
                 .type = IRInstructionType_Label,
@@ -432,6 +410,11 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
                 exit(1);
             }
 
+            // same rotation as while loops, the condition gets checked once up front and then at the bottom
+            if (statement.value.for_statement.condition.is_some) {
+                ir_generate_condition(generator, statement.value.for_statement.condition.data, NULL, break_label, instructions);
+            }
+
             IRInstruction start_label_instruction = {
                 .type = IRInstructionType_Label,
                 .value = {
@@ -441,22 +424,6 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
 
             vecptr_push(instructions, start_label_instruction);
 
-            if (statement.value.for_statement.condition.is_some) {
-                IRVal condition = ir_generate_expression(generator, statement.value.for_statement.condition.data, instructions);
-
-                IRInstruction jump_break = {
-                    .type = IRInstructionType_JumpIfZero,
-                    .value = {
-                        .jump_cond = {
-                            .val = condition,
-                            .label = break_label,
-                        },
-                    },
-                };
-
-                vecptr_push(instructions, jump_break);
-            }
-
             ir_generate_statement(generator, *statement.value.for_statement.body, instructions, function_idx);
 
             IRInstruction continue_label_instruction = {
@@ -472,14 +439,18 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
                 ir_generate_expression(generator, statement.value.for_statement.post.data, instructions);
             }
 
-            IRInstruction jump_start = {
-                .type = IRInstructionType_Jump,
-                .value = {
-                    .label = start_label,
-                },
-            };
+            if (statement.value.for_statement.condition.is_some) {
+                ir_generate_condition(generator, statement.value.for_statement.condition.data, start_label, NULL, instructions);
+            } else {
+                IRInstruction jump_start = {
+                    .type = IRInstructionType_Jump,
+                    .value = {
+                        .label = start_label,
+                    },
+                };
 
-            vecptr_push(instructions, jump_start);
+                vecptr_push(instructions, jump_start);
+            }
 
             IRInstruction break_label_instruction = {
                 .type = IRInstructionType_Label,
@@ -499,60 +470,34 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
                 exit(1);
             }
 
-            Expression cond_expr = statement.value.loop_statement.condition;
-
-            IRVal condition = ir_generate_expression(generator, cond_expr, instructions);
+            IRVal condition = ir_generate_expression(generator, statement.value.loop_statement.condition, instructions);
 
+            // the cases got sorted by switch then value, so this switch's are one run
             SwitchCases switch_cases = generator->switch_cases[function_idx];
-
-            for (int i = 0; i < switch_cases.length; i++) {
-                struct SwitchCase switch_case = switch_cases.data[i];
-                if (switch_case.switch_label == statement.value.loop_statement.label) {
-                    IRVal cmping = ir_make_temp(generator);
-
-                    IRVal const_expr;
-                    switch (switch_case.expr.type) {
-                        case ExpressionType_INT:
-                            const_expr = (IRVal){.type = IRValType_Int, .value = {switch_case.expr.value.integer}};
-                            break;
-                        default:
-                            fprintf(stderr, "Only integer constants are supported in switch cases\n");
-                            exit(1);
-                    }
-
-                    IRInstruction cmp = {
-                        .type = IRInstructionType_Binary,
-                        .value = {
-                            .binary = {
-                                .op = IRBinaryOp_Equal,
-                                .left = condition,
-                                .right = const_expr,
-                                .dst = cmping,
-                            },
-                        },
-                    };
-
-                    vecptr_push(instructions, cmp);
-
-                    char* case_label;
-                    if (0>asprintf(&case_label, ".switch.case.%d", switch_case.case_label)) {
-                        fprintf(stderr, "Error creating case label\n");
-                        exit(1);
-                    }
-
-                    IRInstruction jump_case = {
-                        .type = IRInstructionType_JumpIfNotZero,
-                        .value = {
-                            .jump_cond = {
-                                .val = cmping,
-                                .label = case_label,
-                            },
-                        },
-                    };
-
-                    vecptr_push(instructions, jump_case);
+            int switch_label = statement.value.loop_statement.label;
+            int lo = 0;
+            int hi = switch_cases.length;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (switch_cases.data[mid].switch_label < switch_label) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
                 }
             }
+            int count = 0;
+            while (lo + count < switch_cases.length && switch_cases.data[lo + count].switch_label == switch_label) {
+                count++;
+            }
+
+            IRSwitch sw = {
+                .condition = condition,
+                .cases = &switch_cases.data[lo],
+                .default_label = break_label,
+            };
+            ir_cluster_switch_cases(&sw, count);
+            ir_generate_switch_dispatch(generator, &sw, 0, sw.clusters.length, INT_MIN, INT_MAX, instructions);
+            vec_free(sw.clusters);
 
             ir_generate_statement(generator, *statement.value.loop_statement.body, instructions, function_idx);
 
@@ -568,20 +513,7 @@ void ir_generate_statement(IRGenerator* generator, Statement statement, IRFuncti
             break;
         }
         case StatementType_CASE: {
-            char* case_label;
-            if (0>asprintf(&case_label, ".switch.case.%d", statement.value.case_statement.label)) {
-                fprintf(stderr, "Error creating case label\n");
-                exit(1);
-            }
-
-            IRInstruction case_label_instruction = {
-                .type = IRInstructionType_Label,
-                .value = {
-                    .label = case_label,
-                },
-            };
-
-            vecptr_push(instructions, case_label_instruction);
+            ir_push_label(ir_switch_case_label(statement.value.case_statement.label), instructions);
         }
     }
 }
@@ -638,6 +570,248 @@ IRBinaryOp ir_convert_binop(enum ExpressionBinaryType type) {
     }
 }
 
+void ir_push_label(char* label, IRFunctionBody* instructions) {
+    IRInstruction instruction = {
+        .type = IRInstructionType_Label,
+        .value = {
+            .label = label,
+        },
+    };
+
+    vecptr_push(instructions, instruction);
+}
+
+void ir_push_jump(IRInstructionType type, IRVal val, char* label, IRFunctionBody* instructions) {
+    IRInstruction instruction = {
+        .type = type,
+    };
+
+    if (type == IRInstructionType_Jump) {
+        instruction.value.label = label;
+    } else {
+        instruction.value.jump_cond.val = val;
+        instruction.value.jump_cond.label = label;
+    }
+
+    vecptr_push(instructions, instruction);
+}
+
+char* ir_switch_case_label(int label) {
+    char* case_label;
+    if (0>asprintf(&case_label, ".switch.case.%d", label)) {
+        fprintf(stderr, "Error creating case label\n");
+        exit(1);
+    }
+    return case_label;
+}
+
+int ir_switch_case_value(struct SwitchCase* switch_case) {
+    if (switch_case->expr.type != ExpressionType_INT) {
+        fprintf(stderr, "Only integer constants are supported in switch cases\n");
+        exit(1);
+    }
+    return switch_case->expr.value.integer;
+}
+
+int ir_compare_switch_cases(const void* a, const void* b) {
+    struct SwitchCase* left = (struct SwitchCase*)a;
+    struct SwitchCase* right = (struct SwitchCase*)b;
+    if (left->switch_label != right->switch_label) {
+        return left->switch_label < right->switch_label ? -1 : 1;
+    }
+    int left_value = ir_switch_case_value(left);
+    int right_value = ir_switch_case_value(right);
+    return left_value < right_value ? -1 : left_value > right_value;
+}
+
+// sorts once per function, so every switch can find its cases with a binary search
+void ir_sort_switch_cases(SwitchCases* cases) {
+    for (int i = 0; i < cases->length; i++) {
+        ir_switch_case_value(&cases->data[i]);
+    }
+    if (cases->length == 0) {
+        return;
+    }
+    qsort(cases->data, cases->length, sizeof(struct SwitchCase), ir_compare_switch_cases);
+    for (int i = 1; i < cases->length; i++) {
+        if (!ir_compare_switch_cases(&cases->data[i - 1], &cases->data[i])) {
+            fprintf(stderr, "Duplicate case value %d\n", ir_switch_case_value(&cases->data[i]));
+            exit(1);
+        }
+    }
+}
+
+void ir_push_compare_jump(IRGenerator* generator, IRBinaryOp op, IRVal left, int right, char* label, IRFunctionBody* instructions) {
+    IRVal result = ir_make_temp(generator);
+    IRInstruction compare = {
+        .type = IRInstructionType_Binary,
+        .value.binary = {
+            .op = op,
+            .left = left,
+            .right = (IRVal){.type = IRValType_Int, .value.integer = right},
+            .dst = result,
+        },
+    };
+    vecptr_push(instructions, compare);
+    ir_push_jump(IRInstructionType_JumpIfNotZero, result, label, instructions);
+}
+
+void ir_generate_jump_table(IRGenerator* generator, IRSwitch* sw, IRSwitchCluster* cluster, int lower, int upper, IRFunctionBody* instructions) {
+    int min = ir_switch_case_value(&sw->cases[cluster->first]);
+    int max = ir_switch_case_value(&sw->cases[cluster->last]);
+    if (lower < min) {
+        ir_push_compare_jump(generator, IRBinaryOp_Less, sw->condition, min, sw->default_label, instructions);
+    }
+    if (upper > max) {
+        ir_push_compare_jump(generator, IRBinaryOp_Greater, sw->condition, max, sw->default_label, instructions);
+    }
+
+    IRVal index = sw->condition;
+    if (min != 0) {
+        index = ir_make_temp(generator);
+        IRInstruction subtract = {
+            .type = IRInstructionType_Binary,
+            .value.binary = {
+                .op = IRBinaryOp_Subtract,
+                .left = sw->condition,
+                .right = (IRVal){.type = IRValType_Int, .value.integer = min},
+                .dst = index,
+            },
+        };
+        vecptr_push(instructions, subtract);
+    }
+
+    IRInstruction table = {
+        .type = IRInstructionType_JumpTable,
+        .value.jump_table = {
+            .index = index,
+            .table = ir_make_temp_name(generator),
+        },
+    };
+    // holes go to the default
+    for (int i = cluster->first, value = min; value <= max; value++) {
+        char* label = sw->default_label;
+        if (ir_switch_case_value(&sw->cases[i]) == value) {
+            label = ir_switch_case_label(sw->cases[i++].case_label);
+        }
+        vec_push(table.value.jump_table.labels, label);
+    }
+    vecptr_push(instructions, table);
+}
+
+// greedily takes the longest run from each case on that's dense enough for a table
+void ir_cluster_switch_cases(IRSwitch* sw, int count) {
+    for (int first = 0; first < count;) {
+        IRSwitchCluster cluster = {.first = first, .last = first, .table = false};
+        for (int last = count - 1; last - first + 1 >= IR_SWITCH_TABLE_MIN_CASES; last--) {
+            long range = (long)ir_switch_case_value(&sw->cases[last]) - ir_switch_case_value(&sw->cases[first]) + 1;
+            if (range <= (long)IR_SWITCH_TABLE_DENSITY * (last - first + 1)) {
+                cluster.last = last;
+                cluster.table = true;
+                break;
+            }
+        }
+        vec_push(sw->clusters, cluster);
+        first = cluster.last + 1;
+    }
+}
+
+// dispatches on clusters [lo, hi). lower and upper are what earlier compares already proved about the
+// condition, so a bound that's known to hold doesn't get checked again
+void ir_generate_switch_dispatch(IRGenerator* generator, IRSwitch* sw, int lo, int hi, int lower, int upper, IRFunctionBody* instructions) {
+    int count = hi - lo;
+    if (count == 0) {
+        ir_push_jump(IRInstructionType_Jump, (IRVal){0}, sw->default_label, instructions);
+        return;
+    }
+    if (count == 1 && sw->clusters.data[lo].table) {
+        ir_generate_jump_table(generator, sw, &sw->clusters.data[lo], lower, upper, instructions);
+        return;
+    }
+
+    int singles = true;
+    for (int c = lo; c < hi; c++) {
+        singles &= !sw->clusters.data[c].table;
+    }
+    if (singles && count <= IR_SWITCH_LINEAR_MAX) {
+        for (int c = lo; c < hi; c++) {
+            struct SwitchCase* switch_case = &sw->cases[sw->clusters.data[c].first];
+            int value = ir_switch_case_value(switch_case);
+            char* label = ir_switch_case_label(switch_case->case_label);
+            if (lower == value && upper == value) {
+                ir_push_jump(IRInstructionType_Jump, (IRVal){0}, label, instructions);
+                return;
+            }
+            ir_push_compare_jump(generator, IRBinaryOp_Equal, sw->condition, value, label, instructions);
+        }
+        ir_push_jump(IRInstructionType_Jump, (IRVal){0}, sw->default_label, instructions);
+        return;
+    }
+
+    int mid = lo + count / 2;
+    int pivot = ir_switch_case_value(&sw->cases[sw->clusters.data[mid].first]);
+    char* left_label = ir_make_temp_name(generator);
+    ir_push_compare_jump(generator, IRBinaryOp_Less, sw->condition, pivot, left_label, instructions);
+    ir_generate_switch_dispatch(generator, sw, mid, hi, pivot, upper, instructions);
+    ir_push_label(left_label, instructions);
+    ir_generate_switch_dispatch(generator, sw, lo, mid, lower, pivot - 1, instructions);
+}
+
+// jumps to true_label when the expression is nonzero and to false_label when it's zero.
+// one of the labels can be NULL, which means falling through in that case.
+// && and || turn into chains of jumps instead of a 0/1 temp
+void ir_generate_condition(IRGenerator* generator, Expression expression, char* true_label, char* false_label, IRFunctionBody* instructions) {
+    if (expression.type == ExpressionType_UNARY && expression.value.unary.type == ExpressionUnaryType_NOT) {
+        ir_generate_condition(generator, *expression.value.unary.expression, false_label, true_label, instructions);
+        return;
+    }
+
+    if (expression.type == ExpressionType_BINARY && expression.value.binary.type == ExpressionBinaryType_AND) {
+        if (false_label == NULL) {
+            char* skip_label = ir_make_temp_name(generator);
+            ir_generate_condition(generator, *expression.value.binary.left, NULL, skip_label, instructions);
+            ir_generate_condition(generator, *expression.value.binary.right, true_label, NULL, instructions);
+            ir_push_label(skip_label, instructions);
+        } else {
+            ir_generate_condition(generator, *expression.value.binary.left, NULL, false_label, instructions);
+            ir_generate_condition(generator, *expression.value.binary.right, true_label, false_label, instructions);
+        }
+        return;
+    }
+
+    if (expression.type == ExpressionType_BINARY && expression.value.binary.type == ExpressionBinaryType_OR) {
+        if (true_label == NULL) {
+            char* skip_label = ir_make_temp_name(generator);
+            ir_generate_condition(generator, *expression.value.binary.left, skip_label, NULL, instructions);
+            ir_generate_condition(generator, *expression.value.binary.right, NULL, false_label, instructions);
+            ir_push_label(skip_label, instructions);
+        } else {
+            ir_generate_condition(generator, *expression.value.binary.left, true_label, NULL, instructions);
+            ir_generate_condition(generator, *expression.value.binary.right, true_label, false_label, instructions);
+        }
+        return;
+    }
+
+    if (expression.type == ExpressionType_INT) {
+        char* target = expression.value.integer != 0 ? true_label : false_label;
+        if (target != NULL) {
+            ir_push_jump(IRInstructionType_Jump, (IRVal){0}, target, instructions);
+        }
+        return;
+    }
+
+    IRVal val = ir_generate_expression(generator, expression, instructions);
+
+    if (true_label != NULL) {
+        ir_push_jump(IRInstructionType_JumpIfNotZero, val, true_label, instructions);
+        if (false_label != NULL) {
+            ir_push_jump(IRInstructionType_Jump, (IRVal){0}, false_label, instructions);
+        }
+    } else if (false_label != NULL) {
+        ir_push_jump(IRInstructionType_JumpIfZero, val, false_label, instructions);
+    }
+}
+
 IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFunctionBody* instructions) {
     switch (expression.type) {
         case ExpressionType_INT: {
@@ -757,47 +931,19 @@ IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFu
             return dst;
         }
         case ExpressionType_BINARY: {
-            IRVal left = ir_generate_expression(generator, *expression.value.binary.left, instructions);
-
             if (expression.value.binary.type == ExpressionBinaryType_AND || expression.value.binary.type == ExpressionBinaryType_OR) {
-                int is_and = expression.value.binary.type == ExpressionBinaryType_AND;
-                
                 char* false_label = ir_make_temp_name(generator);
                 char* end_label = ir_make_temp_name(generator);
 
                 IRVal dst = ir_make_temp(generator);
 
-                IRInstruction jump_1 = {
-                    .type = is_and ? IRInstructionType_JumpIfZero : IRInstructionType_JumpIfNotZero,
-                    .value = {
-                        .jump_cond = {
-                            .val = left,
-                            .label = false_label,
-                        },
-                    },
-                };
-
-                vecptr_push(instructions, jump_1);
-
-                IRVal right = ir_generate_expression(generator, *expression.value.binary.right, instructions);
-
-                IRInstruction jump_2 = {
-                    .type = is_and ? IRInstructionType_JumpIfZero : IRInstructionType_JumpIfNotZero,
-                    .value = {
-                        .jump_cond = {
-                            .val = right,
-                            .label = false_label,
-                        },
-                    },
-                };
-
-                vecptr_push(instructions, jump_2);
+                ir_generate_condition(generator, expression, NULL, false_label, instructions);
 
                 IRInstruction copy_1 = {
                     .type = IRInstructionType_Copy,
                     .value = {
                         .copy = {
-                            .src = (IRVal){.type = IRValType_Int, .value = {is_and ? 1 : 0}},
+                            .src = (IRVal){.type = IRValType_Int, .value = {1}},
                             .dst = dst,
                         }
                     }
@@ -827,7 +973,7 @@ IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFu
                     .type = IRInstructionType_Copy,
                     .value = {
                         .copy = {
-                            .src = (IRVal){.type = IRValType_Int, .value = {is_and ? 0 : 1}},
+                            .src = (IRVal){.type = IRValType_Int, .value = {0}},
                             .dst = dst,
                         }
                     }
@@ -847,6 +993,7 @@ IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFu
                 return dst;
             }
 
+            IRVal left = ir_generate_expression(generator, *expression.value.binary.left, instructions);
             IRVal right = ir_generate_expression(generator, *expression.value.binary.right, instructions);
             IRVal dst = ir_make_temp(generator);
 
@@ -942,24 +1089,12 @@ IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFu
             return left;
         }
         case ExpressionType_TERNARY: {
-            IRVal condition = ir_generate_expression(generator, *expression.value.ternary.condition, instructions);
-
             char* else_label = ir_make_temp_name(generator);
             char* end_label = ir_make_temp_name(generator);
 
             IRVal dst = ir_make_temp(generator);
 
-            IRInstruction jump_else = {
-                .type = IRInstructionType_JumpIfZero,
-                .value = {
-                    .jump_cond = {
-                        .val = condition,
-                        .label = else_label,
-                    },
-                },
-            };
-
-            vecptr_push(instructions, jump_else);
+            ir_generate_condition(generator, *expression.value.ternary.condition, NULL, else_label, instructions);
 
             IRVal then_expr = ir_generate_expression(generator, *expression.value.ternary.then_expr, instructions);
 
@@ -1049,7 +1184,7 @@ IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFu
 }
 
 char* ir_make_temp_name(IRGenerator* generator) {
-    char* name = (char*)malloc(quick_log10(generator->tmp_count) + 4);
+    char* name = (char*)malloc(quick_log10(generator->tmp_count) + 5); // quick_log10(0) is 0, but 0 still takes a digit
     sprintf(name, ".t.%d", generator->tmp_count);
     generator->tmp_count++;
     return name;
@@ -16,6 +16,7 @@ typedef struct IRStaticVariable {
     char* identifier;
     int global;
     int init;
+    int initialized; // false for a tentative definition, which is 0 unless another file initializes it
 } IRStaticVariable;
 
 typedef enum IRInstructionType {
@@ -28,6 +29,7 @@ typedef enum IRInstructionType {
     IRInstructionType_JumpIfNotZero,
     IRInstructionType_Label,
     IRInstructionType_Call,
+    IRInstructionType_JumpTable,
 } IRInstructionType;
 
 typedef enum IRValType {
@@ -101,6 +103,15 @@ typedef union IRInstructionValue {
         } args;
         IRVal dst;
     } call;
+    struct {
+        IRVal index; // already range checked, so it picks one of the labels
+        char* table; // the table is a run of jumps in the assembly, this labels the first one
+        struct {
+            char** data;
+            int length;
+            int capacity;
+        } labels;
+    } jump_table;
 } IRInstructionValue;
 
 typedef struct IRInstruction {
@@ -139,6 +150,29 @@ typedef struct IRGenerator {
 
 typedef Option(IRFunctionDefinition) IROptionalFN;
 
+// switch dispatch first groups the sorted cases into clusters: runs dense enough for a jump table,
+// and single cases. then it binary searches over the clusters, down to a table or a short chain of compares
+#define IR_SWITCH_TABLE_MIN_CASES 8 // below this a binary search is about as fast and much smaller
+#define IR_SWITCH_TABLE_DENSITY 2 // at most this many table slots per case
+#define IR_SWITCH_LINEAR_MAX 3
+
+typedef struct IRSwitchCluster {
+    int first; // cases [first, last] of the switch
+    int last;
+    int table;
+} IRSwitchCluster;
+
+typedef struct IRSwitch {
+    IRVal condition;
+    struct SwitchCase* cases; // this switch's cases, sorted by value
+    char* default_label; // where nothing matching goes
+    struct {
+        IRSwitchCluster* data;
+        int length;
+        int capacity;
+    } clusters;
+} IRSwitch;
+
 IRGenerator ir_generator_new(SwitchCases* switch_cases, TCSymbols* symbol_table);
 IRProgram ir_generate_program(IRGenerator* generator, ParserProgram program);
 IROptionalFN ir_generate_function(IRGenerator* generator, FunctionDefinition function, int function_idx);
@@ -147,8 +181,15 @@ void ir_generate_declaration(IRGenerator* generator, Declaration declaration, IR
 void ir_generate_variable_declaration(IRGenerator* generator, VariableDeclaration declaration, IRFunctionBody* instructions);
 void ir_generate_statement(IRGenerator* generator, Statement statement, IRFunctionBody* instructions, int function_idx);
 IRVal ir_generate_expression(IRGenerator* generator, Expression expression, IRFunctionBody* instructions);
+void ir_generate_condition(IRGenerator* generator, Expression expression, char* true_label, char* false_label, IRFunctionBody* instructions);
 char* ir_make_temp_name(IRGenerator* generator);
 IRVal ir_make_temp(IRGenerator* generator);
 IRUnaryOp ir_convert_unary_op(enum ExpressionUnaryType type);
+void ir_push_label(char* label, IRFunctionBody* instructions);
+void ir_push_jump(IRInstructionType type, IRVal val, char* label, IRFunctionBody* instructions);
+char* ir_switch_case_label(int label);
+void ir_sort_switch_cases(SwitchCases* cases);
+void ir_cluster_switch_cases(IRSwitch* sw, int count);
+void ir_generate_switch_dispatch(IRGenerator* generator, IRSwitch* sw, int lo, int hi, int lower, int upper, IRFunctionBody* instructions);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir_eval.h"
+#include "easy_stuff.h"
+
+// ir interpreter
+//
+// calls push a frame instead of recursing in c, so deep recursion in the program (the tail tests
+// go about 121k calls deep) only costs heap. locals that are read before they're written read 0
+
+void ir_eval_add_var(IREvalContext* context, IREvalFunction* function, IRVal val) {
+    if (val.type != IRValType_Var || string_map_get(&context->statics, val.value.var) != -1 ||
+        string_map_get(&function->vars, val.value.var) != -1) {
+        return;
+    }
+    string_map_set(&function->vars, val.value.var, function->slots++);
+}
+
+// gives every label an index and every local a slot
+IREvalFunction ir_eval_prepare(IREvalContext* context, IRFunctionDefinition* definition) {
+    IREvalFunction function = {
+        .definition = definition,
+        .labels = string_map_new(),
+        .vars = string_map_new(),
+    };
+
+    for (int i = 0; i < definition->params.length; i++) {
+        IRVal param = {.type = IRValType_Var, .value.var = definition->params.data[i]};
+        ir_eval_add_var(context, &function, param);
+    }
+
+    for (int i = 0; i < definition->body.length; i++) {
+        IRInstruction* instruction = &definition->body.data[i];
+        switch (instruction->type) {
+            case IRInstructionType_Unary:
+                ir_eval_add_var(context, &function, instruction->value.unary.src);
+                ir_eval_add_var(context, &function, instruction->value.unary.dst);
+                break;
+            case IRInstructionType_Binary:
+                ir_eval_add_var(context, &function, instruction->value.binary.left);
+                ir_eval_add_var(context, &function, instruction->value.binary.right);
+                ir_eval_add_var(context, &function, instruction->value.binary.dst);
+                break;
+            case IRInstructionType_Copy:
+                ir_eval_add_var(context, &function, instruction->value.copy.src);
+                ir_eval_add_var(context, &function, instruction->value.copy.dst);
+                break;
+            case IRInstructionType_Return:
+                ir_eval_add_var(context, &function, instruction->value.val);
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                ir_eval_add_var(context, &function, instruction->value.jump_cond.val);
+                break;
+            case IRInstructionType_Call:
+                for (int a = 0; a < instruction->value.call.args.length; a++) {
+                    ir_eval_add_var(context, &function, instruction->value.call.args.data[a]);
+                }
+                ir_eval_add_var(context, &function, instruction->value.call.dst);
+                break;
+            case IRInstructionType_JumpTable:
+                ir_eval_add_var(context, &function, instruction->value.jump_table.index);
+                break;
+            case IRInstructionType_Label:
+                if (string_map_get(&function.labels, instruction->value.label) != -1) {
+                    fprintf(stderr, "Label %s defined twice in %s\n", instruction->value.label, definition->identifier);
+                    exit(1);
+                }
+                string_map_set(&function.labels, instruction->value.label, i);
+                break;
+            case IRInstructionType_Jump:
+                break;
+        }
+    }
+
+    return function;
+}
+
+int* ir_eval_slot(IREvalContext* context, IREvalFrame* frame, char* name) {
+    int slot = string_map_get(&frame->function->vars, name);
+    if (slot != -1) {
+        return &frame->values[slot];
+    }
+    int index = string_map_get(&context->statics, name);
+    if (index == -1) {
+        fprintf(stderr, "Unknown variable %s in %s\n", name, frame->function->definition->identifier);
+        exit(1);
+    }
+    return &context->static_values.data[index];
+}
+
+int ir_eval_read(IREvalContext* context, IREvalFrame* frame, IRVal val) {
+    if (val.type == IRValType_Int) {
+        return val.value.integer & 0xffff;
+    }
+    return *ir_eval_slot(context, frame, val.value.var);
+}
+
+void ir_eval_write(IREvalContext* context, IREvalFrame* frame, IRVal dst, int value) {
+    *ir_eval_slot(context, frame, dst.value.var) = value & 0xffff;
+}
+
+int ir_eval_unary(IRUnaryOp op, int a) {
+    switch (op) {
+        case IRUnaryOp_Negate: return -a;
+        case IRUnaryOp_Complement: return ~a;
+        case IRUnaryOp_Not: return a == 0;
+    }
+    return 0;
+}
+
+int ir_eval_binary(IRBinaryOp op, unsigned int a, unsigned int b, char* function) {
+    if ((op == IRBinaryOp_Divide || op == IRBinaryOp_Mod) && b == 0) {
+        fprintf(stderr, "Division by zero in %s\n", function);
+        exit(1);
+    }
+
+    switch (op) {
+        case IRBinaryOp_Add: return (int)((a + b) & 0xffff);
+        case IRBinaryOp_Subtract: return (int)((a - b) & 0xffff);
+        case IRBinaryOp_Multiply: return (int)((a * b) & 0xffff);
+        case IRBinaryOp_Divide: return (int)(a / b);
+        case IRBinaryOp_Mod: return (int)(a % b);
+        case IRBinaryOp_BitwiseAnd: return (int)(a & b);
+        case IRBinaryOp_BitwiseOr: return (int)(a | b);
+        case IRBinaryOp_BitwiseXor: return (int)(a ^ b);
+        case IRBinaryOp_LeftShift: return b >= 16 ? 0 : (int)((a << b) & 0xffff);
+        case IRBinaryOp_RightShift: return b >= 16 ? 0 : (int)(a >> b);
+        case IRBinaryOp_Equal: return a == b;
+        case IRBinaryOp_NotEqual: return a != b;
+        case IRBinaryOp_Less: return a < b;
+        case IRBinaryOp_LessEqual: return a <= b;
+        case IRBinaryOp_Greater: return a > b;
+        case IRBinaryOp_GreaterEqual: return a >= b;
+    }
+    return 0;
+}
+
+void ir_eval_push_frame(IREvalContext* context, char* name, IRVal dst) {
+    int index = string_map_get(&context->function_names, name);
+    if (index == -1) {
+        fprintf(stderr, "Call to undefined function %s\n", name);
+        exit(1);
+    }
+    if (context->frames.length >= IR_EVAL_MAX_DEPTH) {
+        fprintf(stderr, "Calls nested more than %d deep in %s\n", IR_EVAL_MAX_DEPTH, name);
+        exit(1);
+    }
+
+    IREvalFunction* function = &context->functions.data[index];
+    IREvalFrame frame = {
+        .function = function,
+        .pc = 0,
+        .values = calloc((size_t)function->slots + 1, sizeof(int)),
+        .dst = dst,
+    };
+    vec_push(context->frames, frame);
+}
+
+int ir_eval_jump(IREvalFrame* frame, char* label) {
+    int target = string_map_get(&frame->function->labels, label);
+    if (target == -1) {
+        fprintf(stderr, "Jump to unknown label %s in %s\n", label, frame->function->definition->identifier);
+        exit(1);
+    }
+    return target;
+}
+
+int ir_eval_program(IRProgram* program) {
+    IREvalContext context = {
+        .function_names = string_map_new(),
+        .statics = string_map_new(),
+    };
+
+    // statics first, so the functions know which names aren't theirs. without -flto a global can show
+    // up once per file, tentatively in all but the one that initializes it
+    for (int i = 0; i < program->length; i++) {
+        if (program->data[i].ty != IRTStatic) {
+            continue;
+        }
+        IRStaticVariable* var = &program->data[i].val.static_var;
+        int index = string_map_get(&context.statics, var->identifier);
+        if (index == -1) {
+            string_map_set(&context.statics, var->identifier, context.static_values.length);
+            vec_push(context.static_values, var->init & 0xffff);
+        } else if (var->initialized) {
+            context.static_values.data[index] = var->init & 0xffff;
+        }
+    }
+
+    for (int i = 0; i < program->length; i++) {
+        if (program->data[i].ty != IRTFunction) {
+            continue;
+        }
+        IRFunctionDefinition* definition = &program->data[i].val.function;
+        if (string_map_get(&context.function_names, definition->identifier) != -1) {
+            fprintf(stderr, "Function %s defined twice\n", definition->identifier);
+            exit(1);
+        }
+        string_map_set(&context.function_names, definition->identifier, context.functions.length);
+        IREvalFunction function = ir_eval_prepare(&context, definition);
+        vec_push(context.functions, function);
+    }
+
+    IRVal none = {.type = IRValType_Int};
+    ir_eval_push_frame(&context, "main", none);
+
+    int result = 0;
+    long steps = 0;
+    while (context.frames.length > 0) {
+        if (++steps > IR_EVAL_MAX_STEPS) {
+            fprintf(stderr, "Evaluation didn't finish in %d steps\n", IR_EVAL_MAX_STEPS);
+            exit(1);
+        }
+
+        IREvalFrame* frame = &context.frames.data[context.frames.length - 1];
+        IRFunctionDefinition* definition = frame->function->definition;
+        if (frame->pc >= definition->body.length) {
+            fprintf(stderr, "Ran off the end of %s\n", definition->identifier);
+            exit(1);
+        }
+        IRInstruction* instruction = &definition->body.data[frame->pc++];
+
+        switch (instruction->type) {
+            case IRInstructionType_Unary: {
+                int a = ir_eval_read(&context, frame, instruction->value.unary.src);
+                ir_eval_write(&context, frame, instruction->value.unary.dst, ir_eval_unary(instruction->value.unary.op, a));
+                break;
+            }
+            case IRInstructionType_Binary: {
+                unsigned int a = (unsigned int)ir_eval_read(&context, frame, instruction->value.binary.left);
+                unsigned int b = (unsigned int)ir_eval_read(&context, frame, instruction->value.binary.right);
+                int value = ir_eval_binary(instruction->value.binary.op, a, b, definition->identifier);
+                ir_eval_write(&context, frame, instruction->value.binary.dst, value);
+                break;
+            }
+            case IRInstructionType_Copy:
+                ir_eval_write(&context, frame, instruction->value.copy.dst, ir_eval_read(&context, frame, instruction->value.copy.src));
+                break;
+            case IRInstructionType_Jump:
+                frame->pc = ir_eval_jump(frame, instruction->value.label);
+                break;
+            case IRInstructionType_JumpIfZero:
+                if (ir_eval_read(&context, frame, instruction->value.jump_cond.val) == 0) {
+                    frame->pc = ir_eval_jump(frame, instruction->value.jump_cond.label);
+                }
+                break;
+            case IRInstructionType_JumpIfNotZero:
+                if (ir_eval_read(&context, frame, instruction->value.jump_cond.val) != 0) {
+                    frame->pc = ir_eval_jump(frame, instruction->value.jump_cond.label);
+                }
+                break;
+            case IRInstructionType_Label:
+                break;
+            case IRInstructionType_JumpTable: {
+                int index = ir_eval_read(&context, frame, instruction->value.jump_table.index);
+                if (index >= instruction->value.jump_table.labels.length) {
+                    fprintf(stderr, "Jump table index %d out of range in %s\n", index, definition->identifier);
+                    exit(1);
+                }
+                frame->pc = ir_eval_jump(frame, instruction->value.jump_table.labels.data[index]);
+                break;
+            }
+            case IRInstructionType_Call: {
+                char* name = instruction->value.call.name;
+                int index = string_map_get(&context.function_names, name);
+                int params = index == -1 ? 0 : context.functions.data[index].definition->params.length;
+                if (index != -1 && params != instruction->value.call.args.length) {
+                    fprintf(stderr, "Call to %s with %d args, it takes %d\n", name, instruction->value.call.args.length, params);
+                    exit(1);
+                }
+
+                // the args are read in the caller's frame, which the push can move
+                int* args = malloc_n_type(int, params + 1);
+                for (int a = 0; a < params; a++) {
+                    args[a] = ir_eval_read(&context, frame, instruction->value.call.args.data[a]);
+                }
+                ir_eval_push_frame(&context, name, instruction->value.call.dst);
+
+                IREvalFrame* callee = &context.frames.data[context.frames.length - 1];
+                for (int a = 0; a < params; a++) {
+                    IRVal param = {.type = IRValType_Var, .value.var = callee->function->definition->params.data[a]};
+                    ir_eval_write(&context, callee, param, args[a]);
+                }
+                free(args);
+                break;
+            }
+            case IRInstructionType_Return: {
+                int value = ir_eval_read(&context, frame, instruction->value.val);
+                IRVal dst = frame->dst;
+                free(frame->values);
+                context.frames.length--;
+
+                if (context.frames.length == 0) {
+                    result = value;
+                } else if (dst.type == IRValType_Var) {
+                    ir_eval_write(&context, &context.frames.data[context.frames.length - 1], dst, value);
+                }
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < context.functions.length; i++) {
+        string_map_free(context.functions.data[i].labels);
+        string_map_free(context.functions.data[i].vars);
+    }
+    vec_free(context.functions);
+    string_map_free(context.function_names);
+    string_map_free(context.statics);
+    vec_free(context.static_values);
+    vec_free(context.frames);
+
+    return result;
+}
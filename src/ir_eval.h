@@ -0,0 +1,38 @@
+#ifndef IR_EVAL_H
+#define IR_EVAL_H
+
+#include "ir.h"
+#include "string_map.h"
+
+// -feval-ir runs the optimized ir of the whole program, so tests can check what it computes
+// without the emulator, which can't run programs that use statics
+#define IR_EVAL_MAX_STEPS 200000000 // past this the program is taken to be stuck in a loop
+#define IR_EVAL_MAX_DEPTH 1000000
+
+typedef struct IREvalFunction {
+    IRFunctionDefinition* definition;
+    StringMap labels; // label -> index of its instruction in the body
+    StringMap vars; // local or param -> slot in the frame
+    int slots;
+} IREvalFunction;
+
+typedef struct IREvalFrame {
+    IREvalFunction* function;
+    int pc;
+    int* values; // per slot
+    IRVal dst; // where the caller wants the return value
+} IREvalFrame;
+
+typedef struct IREvalContext {
+    VEC(IREvalFunction) functions;
+    StringMap function_names; // name -> index in functions
+    StringMap statics; // name -> index in static_values
+    VEC(int) static_values;
+    VEC(IREvalFrame) frames;
+} IREvalContext;
+
+// runs main and returns what it returns, as the machine would: every value is 16 bits, and
+// compares, divides and shifts are unsigned
+int ir_eval_program(IRProgram* program);
+
+#endif
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_link.h"
+#include "easy_stuff.h"
+#include "optimization/ir_analysis.h"
+
+// linking happens on the ir, the same way a linker would do it on the object files:
+// a global is one thing however many files declare it, and has to be defined once.
+// internal (static) functions and variables are per file, and resolution already gave them
+// names no local can have, so appending `f<unit>.` keeps them apart from each other too.
+
+char* ir_link_internal_name(char* name, int unit) {
+    char* new_name = malloc(strlen(name) + quick_log10(unit) + 4);
+    sprintf(new_name, "%sf%d.", name, unit);
+    return new_name;
+}
+
+void ir_link_rename(StringMap* renames, char** new_names, char** name) {
+    int idx = string_map_get(renames, *name);
+    if (idx != -1) {
+        *name = new_names[idx];
+    }
+}
+
+void ir_link_rename_function(StringMap* renames, char** new_names, IRFunctionDefinition* function) {
+    IRValRefs vals = {0};
+
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+        if (instruction->type == IRInstructionType_Call) {
+            ir_link_rename(renames, new_names, &instruction->value.call.name);
+        }
+
+        vals.length = 0;
+        ir_instruction_sources(instruction, &vals);
+        IRVal* dst = ir_instruction_dst(instruction);
+        if (dst != NULL) {
+            vec_push(vals, dst);
+        }
+        for (int v = 0; v < vals.length; v++) {
+            if (vals.data[v]->type == IRValType_Var) {
+                ir_link_rename(renames, new_names, &vals.data[v]->value.var);
+            }
+        }
+    }
+
+    vec_free(vals);
+}
+
+// gives a unit's internal symbols their linked names, in the code and the symbol table
+void ir_link_rename_internal(IRProgram* program, TCSymbols* symbols, int unit) {
+    StringMap renames = string_map_new();
+    char** new_names = malloc_n_type(char*, program->length + 1);
+    int renamed = 0;
+
+    for (int i = 0; i < program->length; i++) {
+        IRTopLevel* tl = &program->data[i];
+        char** name = tl->ty == IRTFunction ? &tl->val.function.identifier : &tl->val.static_var.identifier;
+        int global = tl->ty == IRTFunction ? tl->val.function.global : tl->val.static_var.global;
+        if (!global && string_map_get(&renames, *name) == -1) {
+            string_map_set(&renames, *name, renamed);
+            new_names[renamed++] = ir_link_internal_name(*name, unit);
+        }
+    }
+
+    for (int i = 0; i < program->length; i++) {
+        IRTopLevel* tl = &program->data[i];
+        if (tl->ty == IRTFunction) {
+            ir_link_rename(&renames, new_names, &tl->val.function.identifier);
+            ir_link_rename_function(&renames, new_names, &tl->val.function);
+        } else {
+            ir_link_rename(&renames, new_names, &tl->val.static_var.identifier);
+        }
+    }
+
+    for (int i = 0; i < symbols->length; i++) {
+        ir_link_rename(&renames, new_names, &symbols->data[i].name);
+    }
+
+    free(new_names);
+    string_map_free(renames);
+}
+
+IRLinkResult ir_link_units(IRLinkUnits* units) {
+    IRLinkResult result = {0};
+    StringMap globals = string_map_new(); // name -> index in the linked program
+
+    for (int u = 0; u < units->length; u++) {
+        IRLinkUnit* unit = &units->data[u];
+        ir_link_rename_internal(&unit->program, unit->symbols, u);
+        for (int i = 0; i < unit->symbols->length; i++) {
+            vec_push(result.symbols, unit->symbols->data[i]);
+        }
+
+        for (int i = 0; i < unit->program.length; i++) {
+            IRTopLevel tl = unit->program.data[i];
+            if (tl.ty == IRTFunction && tl.val.function.global) {
+                if (string_map_get(&globals, tl.val.function.identifier) != -1) {
+                    fprintf(stderr, "Multiple definitions of function %s\n", tl.val.function.identifier);
+                    exit(1);
+                }
+                string_map_set(&globals, tl.val.function.identifier, result.program.length);
+            } else if (tl.ty == IRTStatic && tl.val.static_var.global) {
+                // every file that uses a global variable has it, tentative ones are just 0
+                int existing = string_map_get(&globals, tl.val.static_var.identifier);
+                if (existing != -1) {
+                    IRStaticVariable* other = &result.program.data[existing].val.static_var;
+                    if (other->initialized && tl.val.static_var.initialized && other->init != tl.val.static_var.init) {
+                        fprintf(stderr, "Conflicting definitions of variable %s\n", tl.val.static_var.identifier);
+                        exit(1);
+                    }
+                    if (tl.val.static_var.initialized) {
+                        other->init = tl.val.static_var.init;
+                        other->initialized = true;
+                    }
+                    continue;
+                }
+                string_map_set(&globals, tl.val.static_var.identifier, result.program.length);
+            }
+            vec_push(result.program, tl);
+        }
+        vec_free(unit->program);
+    }
+
+    // the start code only calls main, nothing else can come from outside
+    for (int i = 0; i < result.program.length; i++) {
+        IRTopLevel* tl = &result.program.data[i];
+        if (tl->ty == IRTFunction) {
+            tl->val.function.global = strcmp(tl->val.function.identifier, "main") == 0;
+        } else {
+            tl->val.static_var.global = false;
+        }
+    }
+
+    string_map_free(globals);
+    return result;
+}
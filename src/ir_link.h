@@ -0,0 +1,28 @@
+#ifndef IR_LINK_H
+#define IR_LINK_H
+
+#include "ir.h"
+#include "string_map.h"
+#include "semantic_analysis/type_checking.h"
+
+// one input file, compiled as far as ir
+typedef struct IRLinkUnit {
+    IRProgram program;
+    TCSymbols* symbols;
+} IRLinkUnit;
+
+typedef VEC(IRLinkUnit) IRLinkUnits;
+
+typedef struct IRLinkResult {
+    IRProgram program;
+    TCSymbols symbols;
+} IRLinkResult;
+
+// merges every unit into one program, for -flto. internal names get the unit's index so they can't clash,
+// and everything but main becomes internal, since nothing outside the program can see it anymore.
+// consumes the units' programs, and renames in their symbol tables
+IRLinkResult ir_link_units(IRLinkUnits* units);
+// the same renaming for one file on its own, since without -flto every file still goes into one assembly file
+void ir_link_rename_internal(IRProgram* program, TCSymbols* symbols, int unit);
+
+#endif
@@ -8,10 +8,9 @@
 #include "semantic_analysis/loop_labeling.h"
 #include "semantic_analysis/type_checking.h"
 #include "ir.h"
-#include "assembly_gen/code_gen.h"
-#include "assembly_gen/replace_pseudo.h"
-#include "assembly_gen/assembley_fixup.h"
-#include "emitter.h"
+#include "ir_link.h"
+#include "ir_eval.h"
+#include "pass_manager.h"
 
 // TODO! change this & assembler to have rip instead of r1, and remap r1 to actually machine-code side mean r2 (all the way up to r14/15)
 
@@ -19,10 +18,11 @@ struct Args {
     int input_length;
     char** inputs;
     char* output;
+    PassOptions passes;
 };
 
 struct Args parse_args(int argc, char** argv) {
-    struct Args args = {0, NULL, NULL};
+    struct Args args = {0, NULL, NULL, pass_options_new()};
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-o") == 0) {
@@ -33,6 +33,8 @@ struct Args parse_args(int argc, char** argv) {
                 fprintf(stderr, "No output file after -o\n");
                 exit(1);
             }
+        } else if (pass_options_parse(&args.passes, argv[i])) {
+            continue;
         } else {
             args.input_length++;
         }
@@ -47,6 +49,8 @@ struct Args parse_args(int argc, char** argv) {
             if (i + 1 < argc) {
                 i++;
             }
+        } else if (strncmp(argv[i], "-O", 2) == 0 || strncmp(argv[i], "-f", 2) == 0 || strncmp(argv[i], "-R", 2) == 0) {
+            continue;
         } else {
             args.inputs[inputs] = argv[i];
             inputs++;
@@ -65,7 +69,21 @@ struct Args parse_args(int argc, char** argv) {
     return args;
 }
 
-char* compile(char* input) {
+char* read_file(char* path);
+
+// labels end up in the assembly, so the names they're made from keep counting up across files
+struct NameCounters {
+    int loop_id;
+    int tmp_count;
+};
+
+struct Unit {
+    IRGenerator generator;
+    TCSymbols* symbols;
+    IRProgram ir;
+};
+
+struct Unit compile_to_ir(char* input, struct NameCounters* counters) {
     printf("pre lex\n");
     Lexer lexer = lexer_new(input);
 
@@ -83,6 +101,11 @@ char* compile(char* input) {
         token_count++;
         token = lexer_next_token(&lexer);
     }
+    // the parser stops when it sees the eof, so that has to be in there too
+    if (token_count >= length) {
+        tokens = realloc(tokens, sizeof(Token) * (length + 1));
+    }
+    tokens[token_count] = token;
 
     printf("pre parse\n");
     Parser parser = parser_new(tokens, token_count);
@@ -92,27 +115,54 @@ char* compile(char* input) {
     ParserProgram ident_res_program = resolve_identifiers(program);
 
     printf("pre loop label\n");
-    struct ProgramAndStructs loop_label_ret = label_loops(ident_res_program);
+    struct ProgramAndStructs loop_label_ret = label_loops(ident_res_program, &counters->loop_id);
     ParserProgram loop_label_program = loop_label_ret.program;
 
     printf("pre typecheck\n");
-    TCSymbols symbols = typecheck_program(&loop_label_program); // TODO! rewrite to return a program, so that we can annotate the ast with type data
+    TCSymbols* symbols = malloc_type(TCSymbols);
+    *symbols = typecheck_program(&loop_label_program); // TODO! rewrite to return a program, so that we can annotate the ast with type data
 
     printf("pre ir\n");
-    IRGenerator generator = ir_generator_new(loop_label_ret.switch_cases_vec, &symbols);
-    IRProgram ir_program = ir_generate_program(&generator, loop_label_program);
+    struct Unit unit = {
+        .generator = ir_generator_new(loop_label_ret.switch_cases_vec, symbols),
+        .symbols = symbols,
+    };
+    unit.generator.tmp_count = counters->tmp_count;
+    unit.ir = ir_generate_program(&unit.generator, loop_label_program);
+    counters->tmp_count = unit.generator.tmp_count;
+
+    return unit;
+}
 
-    printf("pre codegen\n");
-    CodegenProgram codegen_program = codegen_generate_program(ir_program);
+char* compile(char* input, int index, struct Args* args, struct NameCounters* counters) {
+    struct Unit unit = compile_to_ir(input, counters);
+    ir_link_rename_internal(&unit.ir, unit.symbols, index);
 
-    printf("pre replace\n");
-    struct ReplaceResult replaced_pseudos = replace_pseudo(codegen_program, &symbols);
+    char* output = pass_manager_run(&args->passes, &unit.generator, unit.symbols, unit.ir);
+    counters->tmp_count = unit.generator.tmp_count; // passes make temps and labels too
 
-    printf("pre fixup\n");
-    CodegenProgram fixed = fixup_program(replaced_pseudos);
+    printf("done\n");
+    return output;
+}
+
+// -flto: every input down to ir, then one program through the pipeline
+char* compile_whole_program(char** inputs, int input_length, struct Args* args, struct NameCounters* counters) {
+    IRLinkUnits units = {0};
+    for (int i = 0; i < input_length; i++) {
+        char* input = read_file(inputs[i]);
+        struct Unit unit = compile_to_ir(input, counters);
+        IRLinkUnit link_unit = {unit.ir, unit.symbols};
+        vec_push(units, link_unit);
+    }
 
-    printf("pre emit\n");
-    char* output = emit_program(fixed);
+    printf("pre link\n");
+    IRLinkResult linked = ir_link_units(&units);
+    IRGenerator generator = ir_generator_new(NULL, &linked.symbols);
+    generator.tmp_count = counters->tmp_count;
+
+    char* output = pass_manager_run(&args->passes, &generator, &linked.symbols, linked.program);
+    counters->tmp_count = generator.tmp_count;
+    vec_free(units);
 
     printf("done\n");
     return output;
@@ -162,6 +212,18 @@ char* read_file(char* path) {
     return buffer;
 }
 
+void append_output(char* path, char* output) {
+    FILE* file = fopen(path, "a");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file: %s\n", path);
+        exit(1);
+    }
+
+    fprintf(file, "%s", output);
+
+    fclose(file);
+}
+
 int quick_log10(int n) {
     int log = 0;
     while (n > 0) {
@@ -173,6 +235,7 @@ int quick_log10(int n) {
 
 int main(int argc, char** argv) {
     struct Args args = parse_args(argc, argv);
+    remarks_enable(args.passes.remarks);
 
     char* assembly_output_file = malloc_n_type(char, strlen(args.output) + 3);
     sprintf(assembly_output_file, "%s.s", args.output);
@@ -210,25 +273,30 @@ int main(int argc, char** argv) {
 
     fclose(output_file);
 
-    for (int i = 0; i < args.input_length; i++) {
-        char* input = read_file(args.inputs[i]);
-        char* output = compile(input);
+    struct NameCounters counters = {0, 0};
 
-        FILE* file = fopen(assembly_output_file, "a");
-        if (file == NULL) {
-            fprintf(stderr, "Could not open file: %s\n", assembly_output_file);
-            exit(1);
-        }
-
-        fprintf(file, "%s", output);
+    if (args.passes.whole_program) {
+        char* output = compile_whole_program(args.inputs, args.input_length, &args, &counters);
+        append_output(assembly_output_file, output);
+        free(output);
+    }
 
-        fclose(file);
+    for (int i = 0; i < args.input_length && !args.passes.whole_program; i++) {
+        char* input = read_file(args.inputs[i]);
+        char* output = compile(input, i, &args, &counters);
+        append_output(assembly_output_file, output);
 
         free(input);
         free(output);
     }
 
+    if (args.passes.eval_ir) {
+        printf("ir eval: main returned %d\n", ir_eval_program(&args.passes.evaluated));
+    }
+
     assemble(assembly_output_file, args.output);
+    remarks_write(args.output);
+    remarks_free();
 
     // delete the assembly file
     //remove(assembly_output_file);
@@ -236,6 +304,7 @@ int main(int argc, char** argv) {
     free(assembly_output_file);
 
     free(args.inputs);
+    pass_options_free(&args.passes);
 
     printf("fully done\n");
 
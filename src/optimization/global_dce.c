@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global_dce.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// dead function and static elimination
+//
+// main and every global symbol are live, since code outside this program can reach them.
+// anything a live function calls or reads/writes is live too. whatever is left is static
+// and unreachable, so it goes. a static that's only used by dead functions goes with them.
+
+char* global_dce_name(IRTopLevel* tl) {
+    return tl->ty == IRTFunction ? tl->val.function.identifier : tl->val.static_var.identifier;
+}
+
+int global_dce_is_root(IRTopLevel* tl) {
+    if (tl->ty == IRTFunction) {
+        return tl->val.function.global || strcmp(tl->val.function.identifier, "main") == 0;
+    }
+    return tl->val.static_var.global;
+}
+
+void global_dce_mark(GlobalDCEContext* context, char* name) {
+    int idx = string_map_get(&context->entries, name);
+    if (idx == -1 || context->live[idx]) {
+        return;
+    }
+    context->live[idx] = true;
+    if (context->program->data[idx].ty == IRTFunction) {
+        vec_push(context->worklist, idx);
+    }
+}
+
+void global_dce_scan(GlobalDCEContext* context, IRFunctionDefinition* function) {
+    IRValRefs sources = {0};
+
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+        if (instruction->type == IRInstructionType_Call) {
+            global_dce_mark(context, instruction->value.call.name);
+        }
+
+        // locals are renamed apart during resolution, so any var that names a static is that static
+        sources.length = 0;
+        ir_instruction_sources(instruction, &sources);
+        for (int s = 0; s < sources.length; s++) {
+            if (sources.data[s]->type == IRValType_Var) {
+                global_dce_mark(context, sources.data[s]->value.var);
+            }
+        }
+        IRVal* dst = ir_instruction_dst(instruction);
+        if (dst != NULL && dst->type == IRValType_Var) {
+            global_dce_mark(context, dst->value.var);
+        }
+    }
+
+    vec_free(sources);
+}
+
+IRProgram global_dce_program(IRProgram program, GlobalDCEStats* stats) {
+    GlobalDCEContext context = {
+        .program = &program,
+        .entries = string_map_new(),
+        .live = calloc(program.length + 1, 1),
+        .worklist = {0},
+    };
+
+    for (int i = 0; i < program.length; i++) {
+        string_map_set(&context.entries, global_dce_name(&program.data[i]), i);
+    }
+    for (int i = 0; i < program.length; i++) {
+        if (global_dce_is_root(&program.data[i])) {
+            global_dce_mark(&context, global_dce_name(&program.data[i]));
+        }
+    }
+    while (context.worklist.length > 0) {
+        int idx = context.worklist.data[--context.worklist.length];
+        global_dce_scan(&context, &program.data[idx].val.function);
+    }
+
+    int length = 0;
+    for (int i = 0; i < program.length; i++) {
+        IRTopLevel* tl = &program.data[i];
+        if (context.live[i]) {
+            program.data[length++] = *tl;
+            continue;
+        }
+
+        if (tl->ty == IRTFunction) {
+            stats->functions++;
+            stats->instructions += tl->val.function.body.length;
+            remark(RemarkKind_Passed, "globaldce", "Removed", tl->val.function.identifier,
+                "unreachable static function with %d instructions removed", tl->val.function.body.length);
+            vec_free(tl->val.function.body);
+        } else {
+            stats->statics++;
+            remark(RemarkKind_Passed, "globaldce", "Removed", tl->val.static_var.identifier,
+                "unreferenced static variable removed");
+        }
+    }
+    program.length = length;
+
+    free(context.live);
+    vec_free(context.worklist);
+    string_map_free(context.entries);
+
+    return program;
+}
@@ -0,0 +1,23 @@
+#ifndef GLOBAL_DCE_H
+#define GLOBAL_DCE_H
+
+#include "../ir.h"
+#include "ir_analysis.h"
+
+typedef struct GlobalDCEContext {
+    IRProgram* program;
+    StringMap entries; // function or static name -> index in the program
+    char* live; // per program entry
+    IntVec worklist; // live functions whose bodies haven't been scanned yet
+} GlobalDCEContext;
+
+typedef struct GlobalDCEStats {
+    int functions;
+    int statics;
+    int instructions; // in the removed functions
+} GlobalDCEStats;
+
+// drops static functions and variables that nothing reachable from main or a global symbol refers to
+IRProgram global_dce_program(IRProgram program, GlobalDCEStats* stats);
+
+#endif
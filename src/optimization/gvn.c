@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gvn.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// dominator based value numbering over the (non-ssa) ir
+//
+// every unary/binary result gets put in a scoped table while walking the dominator tree,
+// and later computations of the same expression become a copy of the var that already has it.
+// entries only get passed down to dominated blocks when every var involved is defined exactly once
+// and that def dominates the computation, since then nothing can change them in between.
+// everything else (statics, vars with several defs) is only reused inside the block that computed it.
+
+int gvn_is_commutative(IRBinaryOp op) {
+    switch (op) {
+        case IRBinaryOp_Add:
+        case IRBinaryOp_Multiply:
+        case IRBinaryOp_BitwiseAnd:
+        case IRBinaryOp_BitwiseOr:
+        case IRBinaryOp_BitwiseXor:
+        case IRBinaryOp_Equal:
+        case IRBinaryOp_NotEqual:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// total order on vals, so commutative operands can be sorted
+int gvn_val_compare(IRVal a, IRVal b) {
+    if (a.type != b.type) {
+        return a.type == IRValType_Int ? -1 : 1;
+    }
+    if (a.type == IRValType_Int) {
+        return (a.value.integer > b.value.integer) - (a.value.integer < b.value.integer);
+    }
+    return strcmp(a.value.var, b.value.var);
+}
+
+// whether a loop contains both instructions, so the def can run again after the copy
+int gvn_in_same_loop(GVNContext* context, int copy, int def) {
+    int copy_block = context->cfg.instruction_blocks[copy];
+    int def_block = context->cfg.instruction_blocks[def];
+    for (int i = 0; i < context->loops.length; i++) {
+        if (context->loops.data[i].contains[copy_block] && context->loops.data[i].contains[def_block]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a var defined once that has a copy of another stable val can be looked at as that val. the source's
+// def has to dominate the copy and be outside every loop around it, otherwise a later iteration can
+// change the source while the copy still has the old value
+IRVal gvn_leader(GVNContext* context, IRVal val) {
+    for (int depth = 0; depth < 32 && val.type == IRValType_Var; depth++) {
+        IRVarInfo* info = ir_var_info_get(&context->vars, val.value.var);
+        if (info == NULL || info->is_static || info->defs != 1 || info->def_index < 0) {
+            break;
+        }
+
+        IRInstruction def = context->function->body.data[info->def_index];
+        if (def.type != IRInstructionType_Copy) {
+            break;
+        }
+
+        IRVal src = def.value.copy.src;
+        if (src.type == IRValType_Var) {
+            IRVarInfo* src_info = ir_var_info_get(&context->vars, src.value.var);
+            if (src_info == NULL || src_info->is_static || src_info->defs != 1 ||
+                !cfg_instruction_dominates(&context->cfg, src_info->def_index, info->def_index) ||
+                gvn_in_same_loop(context, info->def_index, src_info->def_index)) {
+                break;
+            }
+        }
+        val = src;
+    }
+    return val;
+}
+
+// whether a var keeps its current value everywhere the instruction at `index` dominates
+int gvn_is_stable(GVNContext* context, IRVal val, int index) {
+    if (val.type == IRValType_Int) {
+        return true;
+    }
+
+    IRVarInfo* info = ir_var_info_get(&context->vars, val.value.var);
+    if (info == NULL || info->is_static || info->defs != 1) {
+        return false;
+    }
+    return cfg_instruction_dominates(&context->cfg, info->def_index, index);
+}
+
+int gvn_involves(GVNExpression* expression, char* name) {
+    return ir_val_is_var(expression->left, name) ||
+        (expression->type == IRInstructionType_Binary && ir_val_is_var(expression->right, name)) ||
+        ir_val_is_var(expression->holder, name);
+}
+
+int gvn_involves_static(GVNContext* context, GVNExpression* expression) {
+    IRVal vals[3] = {expression->left, expression->right, expression->holder};
+    for (int i = 0; i < 3; i++) {
+        if (i == 1 && expression->type != IRInstructionType_Binary) {
+            continue;
+        }
+        if (vals[i].type == IRValType_Var) {
+            IRVarInfo* info = ir_var_info_get(&context->vars, vals[i].value.var);
+            if (info != NULL && info->is_static) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void gvn_kill(GVNContext* context, int from, char* name, int statics) {
+    int kept = from;
+    for (int i = from; i < context->table.length; i++) {
+        GVNExpression* expression = &context->table.data[i];
+        int dead = (name != NULL && gvn_involves(expression, name)) ||
+            (statics && gvn_involves_static(context, expression));
+        if (!dead) {
+            context->table.data[kept++] = *expression;
+        }
+    }
+    context->table.length = kept;
+}
+
+// build the lookup key for a unary/binary instruction
+GVNExpression gvn_make_expression(GVNContext* context, IRInstruction* instruction) {
+    GVNExpression expression = {.type = instruction->type};
+
+    if (instruction->type == IRInstructionType_Unary) {
+        expression.op = instruction->value.unary.op;
+        expression.left = gvn_leader(context, instruction->value.unary.src);
+        expression.holder = instruction->value.unary.dst;
+        return expression;
+    }
+
+    IRBinaryOp op = instruction->value.binary.op;
+    IRVal left = gvn_leader(context, instruction->value.binary.left);
+    IRVal right = gvn_leader(context, instruction->value.binary.right);
+
+    // a > b is b < a
+    if (op == IRBinaryOp_Greater || op == IRBinaryOp_GreaterEqual) {
+        op = op == IRBinaryOp_Greater ? IRBinaryOp_Less : IRBinaryOp_LessEqual;
+        IRVal tmp = left;
+        left = right;
+        right = tmp;
+    } else if (gvn_is_commutative(op) && gvn_val_compare(left, right) > 0) {
+        IRVal tmp = left;
+        left = right;
+        right = tmp;
+    }
+
+    expression.op = op;
+    expression.left = left;
+    expression.right = right;
+    expression.holder = instruction->value.binary.dst;
+    return expression;
+}
+
+int gvn_lookup(GVNContext* context, GVNExpression* expression) {
+    for (int i = context->table.length - 1; i >= 0; i--) {
+        GVNExpression* entry = &context->table.data[i];
+        if (entry->type != expression->type || entry->op != expression->op) {
+            continue;
+        }
+        if (!ir_val_equal(entry->left, expression->left)) {
+            continue;
+        }
+        if (expression->type == IRInstructionType_Binary && !ir_val_equal(entry->right, expression->right)) {
+            continue;
+        }
+        return i;
+    }
+    return -1;
+}
+
+void gvn_visit_block(GVNContext* context, int block_idx) {
+    IRBlock* block = &context->cfg.data[block_idx];
+    int marker = context->table.length;
+
+    for (int i = block->start; i < block->end; i++) {
+        IRInstruction* instruction = &context->function->body.data[i];
+
+        int is_expression = instruction->type == IRInstructionType_Unary || instruction->type == IRInstructionType_Binary;
+        GVNExpression expression = {0};
+
+        if (is_expression) {
+            expression = gvn_make_expression(context, instruction);
+            int found = gvn_lookup(context, &expression);
+
+            if (found != -1 && !ir_val_equal(context->table.data[found].holder, expression.holder)) {
+                IRVal holder = context->table.data[found].holder;
+                *instruction = (IRInstruction){
+                    .type = IRInstructionType_Copy,
+                    .value = {
+                        .copy = {
+                            .src = holder,
+                            .dst = expression.holder,
+                        },
+                    },
+                };
+                context->replaced++;
+                is_expression = false;
+            }
+        }
+
+        if (instruction->type == IRInstructionType_Call) {
+            // the callee can change any static
+            gvn_kill(context, 0, NULL, true);
+        }
+
+        IRVal* dst = ir_instruction_dst(instruction);
+        if (dst != NULL && dst->type == IRValType_Var) {
+            IRVarInfo* info = ir_var_info_get(&context->vars, dst->value.var);
+            gvn_kill(context, 0, dst->value.var, info != NULL && info->is_static);
+        }
+
+        // x = x + 1 doesn't leave x + 1 anywhere
+        char* holder = expression.holder.value.var;
+        int self_referencing = is_expression && (ir_val_is_var(expression.left, holder) ||
+            (expression.type == IRInstructionType_Binary && ir_val_is_var(expression.right, holder)));
+
+        if (is_expression && !self_referencing) {
+            IRVarInfo* holder_info = ir_var_info_get(&context->vars, holder);
+            expression.local = !gvn_is_stable(context, expression.left, i) ||
+                (expression.type == IRInstructionType_Binary && !gvn_is_stable(context, expression.right, i)) ||
+                holder_info->is_static || holder_info->defs != 1;
+            vec_push(context->table, expression);
+        }
+    }
+
+    // only the entries that can't be changed on the way down survive into dominated blocks
+    int kept = marker;
+    for (int i = marker; i < context->table.length; i++) {
+        if (!context->table.data[i].local) {
+            context->table.data[kept++] = context->table.data[i];
+        }
+    }
+    context->table.length = kept;
+
+    for (int c = 0; c < block->dom_children.length; c++) {
+        gvn_visit_block(context, context->cfg.data[block_idx].dom_children.data[c]);
+    }
+
+    context->table.length = marker;
+}
+
+int gvn_function(IRFunctionDefinition* function, TCSymbols* symbols) {
+    GVNContext context = {
+        .function = function,
+        .cfg = cfg_build(&function->body),
+        .vars = ir_collect_var_info(function, symbols),
+        .table = {0},
+        .replaced = 0,
+    };
+    cfg_compute_dominators(&context.cfg);
+    context.loops = cfg_find_loops(&context.cfg);
+
+    if (context.cfg.rpo.length > 0) {
+        gvn_visit_block(&context, context.cfg.rpo.data[0]);
+    }
+
+    cfg_loops_free(&context.loops);
+    cfg_free(&context.cfg);
+    ir_var_infos_free(&context.vars);
+    vec_free(context.table);
+
+    if (context.replaced > 0) {
+        remark(RemarkKind_Passed, "gvn", "Replaced", function->identifier, "%d redundant expressions replaced", context.replaced);
+    }
+    return context.replaced;
+}
+
+IRProgram gvn_program(IRProgram program, TCSymbols* symbols, int* replaced) {
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            *replaced += gvn_function(&program.data[i].val.function, symbols);
+        }
+    }
+
+    return program;
+}
@@ -0,0 +1,35 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+typedef struct GVNExpression {
+    IRInstructionType type; // unary or binary
+    int op;
+    IRVal left;
+    IRVal right; // unused for unary expressions
+    IRVal holder; // var that has the value
+    int local; // only valid inside the block that computed it
+} GVNExpression;
+
+typedef struct GVNTable {
+    GVNExpression* data;
+    int length;
+    int capacity;
+} GVNTable;
+
+typedef struct GVNContext {
+    IRFunctionDefinition* function;
+    IRCFG cfg;
+    IRLoops loops;
+    IRVarInfos vars;
+    GVNTable table;
+    int replaced;
+} GVNContext;
+
+IRProgram gvn_program(IRProgram program, TCSymbols* symbols, int* replaced);
+int gvn_function(IRFunctionDefinition* function, TCSymbols* symbols);
+
+#endif
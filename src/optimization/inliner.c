@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inliner.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// inlining of small non-recursive functions defined in this file
+//
+// functions are visited callees first, so whatever got inlined into a callee comes along when the
+// callee gets inlined itself. every inlined copy gets its own names for the callee's locals, temps and
+// labels (statics keep theirs), the params become copies of the args, and returns become a copy into
+// the call's dst plus a jump past the body. gvn and licm run afterwards and clean up the copies.
+//
+// static functions that don't get called anymore are dropped, global ones have to stay for other files.
+
+typedef VEC(IRVal) InlinerVals;
+
+typedef struct InlinerRenames {
+    StringMap map; // original name -> index in vals
+    InlinerVals vals; // what the name turns into, a fresh var (or label) or the arg of a param
+    int site;
+} InlinerRenames;
+
+int inliner_function_index(InlinerContext* context, char* name) {
+    int index = string_map_get(&context->functions, name);
+    if (index < 0 || context->program->data[index].ty != IRTFunction) {
+        return -1;
+    }
+    return index;
+}
+
+int inliner_size(IRFunctionDefinition* function) {
+    int size = 0;
+    for (int i = 0; i < function->body.length; i++) {
+        size += function->body.data[i].type != IRInstructionType_Label;
+    }
+    return size;
+}
+
+int inliner_reaches(InlinerContext* context, int from, int target, char* seen) {
+    if (seen[from]) {
+        return false;
+    }
+    seen[from] = true;
+
+    IRFunctionBody* body = &context->program->data[from].val.function.body;
+    for (int i = 0; i < body->length; i++) {
+        if (body->data[i].type != IRInstructionType_Call) {
+            continue;
+        }
+        int callee = inliner_function_index(context, body->data[i].value.call.name);
+        if (callee == target || (callee >= 0 && inliner_reaches(context, callee, target, seen))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void inliner_count_calls(InlinerContext* context, IRFunctionBody* body, int delta) {
+    for (int i = 0; i < body->length; i++) {
+        if (body->data[i].type == IRInstructionType_Call) {
+            int callee = inliner_function_index(context, body->data[i].value.call.name);
+            if (callee >= 0) {
+                context->call_sites[callee] += delta;
+            }
+        }
+    }
+}
+
+IRVal inliner_rename(InlinerRenames* renames, char* name) {
+    int index = string_map_get(&renames->map, name);
+    if (index >= 0) {
+        return renames->vals.data[index];
+    }
+
+    char* renamed = malloc(strlen(name) + quick_log10(renames->site) + 5);
+    sprintf(renamed, "%s.in%d", name, renames->site);
+    IRVal val = {.type = IRValType_Var, .value.var = renamed};
+    string_map_set(&renames->map, name, renames->vals.length);
+    vec_push(renames->vals, val);
+    return val;
+}
+
+void inliner_rename_val(InlinerContext* context, InlinerRenames* renames, IRVal* val) {
+    if (val->type == IRValType_Var && !ir_is_static_var(val->value.var, context->symbols)) {
+        *val = inliner_rename(renames, val->value.var);
+    }
+}
+
+int inliner_has_loop(IRFunctionDefinition* function) {
+    StringMap seen = string_map_new();
+    int loop = false;
+    for (int i = 0; i < function->body.length && !loop; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+        switch (instruction->type) {
+            case IRInstructionType_Label:
+                string_map_set(&seen, instruction->value.label, i);
+                break;
+            case IRInstructionType_Jump:
+                loop = string_map_get(&seen, instruction->value.label) >= 0;
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                loop = string_map_get(&seen, instruction->value.jump_cond.label) >= 0;
+                break;
+            case IRInstructionType_JumpTable:
+                for (int l = 0; l < instruction->value.jump_table.labels.length && !loop; l++) {
+                    loop = string_map_get(&seen, instruction->value.jump_table.labels.data[l]) >= 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    string_map_free(seen);
+    return loop;
+}
+
+// a param the callee never assigns can just be the arg, since nothing in the inlined body can write
+// the caller's locals (they're not in scope) and the call's dst only gets written on the way out.
+// statics could change under a call in the body, so those still get copied. so does anything going
+// into a loop: a constant would need an ldi every iteration, and the caller's var might be long lived
+// enough to end up on the stack, while a copy is a short range the allocator can keep in a register
+int inliner_can_substitute(InlinerContext* context, IRFunctionDefinition* callee, char* param, IRVal arg) {
+    if ((arg.type == IRValType_Var && ir_is_static_var(arg.value.var, context->symbols)) || inliner_has_loop(callee)) {
+        return false;
+    }
+    for (int i = 0; i < callee->body.length; i++) {
+        IRVal* dst = ir_instruction_dst(&callee->body.data[i]);
+        if (dst != NULL && ir_val_is_var(*dst, param)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int inliner_should_inline(InlinerContext* context, int caller, IRInstruction* call, int caller_size) {
+    int callee = inliner_function_index(context, call->value.call.name);
+    if (callee < 0) {
+        return false;
+    }
+
+    char* caller_name = context->program->data[caller].val.function.identifier;
+    char* name = call->value.call.name;
+    if (callee == caller || context->recursive[callee]) {
+        remark(RemarkKind_Missed, "inline", "Recursive", caller_name, "%s not inlined, it's recursive", name);
+        return false;
+    }
+
+    IRFunctionDefinition* function = &context->program->data[callee].val.function;
+    if (function->params.length != call->value.call.args.length) {
+        remark(RemarkKind_Missed, "inline", "ArgCount", caller_name, "%s not inlined, it takes %d args but gets %d", name,
+            function->params.length, call->value.call.args.length);
+        return false;
+    }
+
+    int size = inliner_size(function);
+    if (caller_size + size > INLINER_MAX_CALLER) {
+        remark(RemarkKind_Missed, "inline", "CallerTooBig", caller_name, "%s not inlined, the caller would be %d instructions (max %d)",
+            name, caller_size + size, INLINER_MAX_CALLER);
+        return false;
+    }
+
+    // the arg moves, call and result move go away, and a static function's only caller takes over its body
+    int growth = size - (call->value.call.args.length + 2);
+    if (growth <= INLINER_GROWTH || (!function->global && context->call_sites[callee] == 1)) {
+        return true;
+    }
+    remark(RemarkKind_Missed, "inline", "TooBig", caller_name, "%s not inlined, it would add %d instructions (max %d)", name,
+        growth, INLINER_GROWTH);
+    return false;
+}
+
+void inliner_inline_call(InlinerContext* context, IRInstruction* call, IRFunctionDefinition* callee, IRFunctionBody* out) {
+    InlinerRenames renames = {
+        .map = string_map_new(),
+        .vals = {0},
+        .site = context->generator->tmp_count++,
+    };
+
+    for (int p = 0; p < callee->params.length; p++) {
+        char* name = callee->params.data[p];
+        IRVal arg = call->value.call.args.data[p];
+        if (inliner_can_substitute(context, callee, name, arg)) {
+            string_map_set(&renames.map, name, renames.vals.length);
+            vec_push(renames.vals, arg);
+            continue;
+        }
+
+        IRInstruction param = {
+            .type = IRInstructionType_Copy,
+            .value.copy = {
+                .src = arg,
+                .dst = inliner_rename(&renames, name),
+            },
+        };
+        vecptr_push(out, param);
+    }
+
+    char* end_label = ir_make_temp_name(context->generator);
+    int jumps_to_end = 0;
+    IRValRefs sources = {0};
+
+    for (int i = 0; i < callee->body.length; i++) {
+        IRInstruction instruction = callee->body.data[i];
+
+        if (instruction.type == IRInstructionType_Call) {
+            IRVal* args = malloc(sizeof(IRVal) * (instruction.value.call.args.length + 1));
+            memcpy(args, instruction.value.call.args.data, sizeof(IRVal) * instruction.value.call.args.length);
+            instruction.value.call.args.data = args;
+            instruction.value.call.args.capacity = instruction.value.call.args.length;
+        }
+
+        sources.length = 0;
+        ir_instruction_sources(&instruction, &sources);
+        for (int s = 0; s < sources.length; s++) {
+            inliner_rename_val(context, &renames, sources.data[s]);
+        }
+        IRVal* dst = ir_instruction_dst(&instruction);
+        if (dst != NULL) {
+            inliner_rename_val(context, &renames, dst);
+        }
+
+        switch (instruction.type) {
+            case IRInstructionType_Label:
+            case IRInstructionType_Jump:
+                instruction.value.label = inliner_rename(&renames, instruction.value.label).value.var;
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                instruction.value.jump_cond.label = inliner_rename(&renames, instruction.value.jump_cond.label).value.var;
+                break;
+            case IRInstructionType_JumpTable: {
+                // the callee keeps its own table, so the copy needs its own labels
+                int count = instruction.value.jump_table.labels.length;
+                char** labels = malloc_n_type(char*, count);
+                for (int l = 0; l < count; l++) {
+                    labels[l] = inliner_rename(&renames, instruction.value.jump_table.labels.data[l]).value.var;
+                }
+                instruction.value.jump_table.labels.data = labels;
+                instruction.value.jump_table.labels.capacity = count;
+                instruction.value.jump_table.table = inliner_rename(&renames, instruction.value.jump_table.table).value.var;
+                break;
+            }
+            case IRInstructionType_Return: {
+                IRInstruction result = {
+                    .type = IRInstructionType_Copy,
+                    .value.copy = {
+                        .src = instruction.value.val,
+                        .dst = call->value.call.dst,
+                    },
+                };
+                vecptr_push(out, result);
+
+                if (i == callee->body.length - 1) {
+                    continue;
+                }
+                instruction = (IRInstruction){.type = IRInstructionType_Jump, .value.label = end_label};
+                jumps_to_end++;
+                break;
+            }
+            default:
+                break;
+        }
+
+        vecptr_push(out, instruction);
+    }
+
+    if (jumps_to_end > 0) {
+        IRInstruction end = {.type = IRInstructionType_Label, .value.label = end_label};
+        vecptr_push(out, end);
+    }
+
+    vec_free(sources);
+    vec_free(renames.vals);
+    string_map_free(renames.map);
+}
+
+void inliner_function(InlinerContext* context, int caller) {
+    context->state[caller] = 1;
+
+    IRFunctionDefinition* function = &context->program->data[caller].val.function;
+    for (int i = 0; i < function->body.length; i++) {
+        if (function->body.data[i].type != IRInstructionType_Call) {
+            continue;
+        }
+        int callee = inliner_function_index(context, function->body.data[i].value.call.name);
+        if (callee >= 0 && context->state[callee] == 0) {
+            inliner_function(context, callee);
+        }
+    }
+
+    IRFunctionBody body = {NULL, 0, 0};
+    int size = inliner_size(function);
+
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+        if (instruction->type != IRInstructionType_Call || !inliner_should_inline(context, caller, instruction, size)) {
+            vec_push(body, *instruction);
+            continue;
+        }
+
+        int callee = inliner_function_index(context, instruction->value.call.name);
+        IRFunctionDefinition* callee_function = &context->program->data[callee].val.function;
+
+        context->call_sites[callee]--;
+        inliner_count_calls(context, &callee_function->body, 1);
+        size += inliner_size(callee_function) - 1;
+
+        remark(RemarkKind_Passed, "inline", "Inlined", function->identifier, "%s inlined, %d instructions",
+            callee_function->identifier, inliner_size(callee_function));
+        inliner_inline_call(context, instruction, callee_function, &body);
+        context->inlined++;
+    }
+
+    vec_free(function->body);
+    function->body = body;
+
+    context->state[caller] = 2;
+}
+
+IRProgram inliner_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols) {
+    InlinerContext context = {
+        .program = &program,
+        .generator = generator,
+        .symbols = symbols,
+        .functions = string_map_new(),
+        .recursive = calloc(program.length + 1, sizeof(int)),
+        .call_sites = calloc(program.length + 1, sizeof(int)),
+        .state = calloc(program.length + 1, sizeof(int)),
+        .inlined = 0,
+    };
+
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            string_map_set(&context.functions, program.data[i].val.function.identifier, i);
+        }
+    }
+
+    char* seen = malloc(program.length + 1);
+    int* called = calloc(program.length + 1, sizeof(int));
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            memset(seen, 0, program.length + 1);
+            context.recursive[i] = inliner_reaches(&context, i, i, seen);
+            inliner_count_calls(&context, &program.data[i].val.function.body, 1);
+        }
+    }
+    memcpy(called, context.call_sites, sizeof(int) * program.length);
+
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction && context.state[i] == 0) {
+            inliner_function(&context, i);
+        }
+    }
+
+    // static functions whose every call got inlined
+    int removed = 0;
+    int length = 0;
+    for (int i = 0; i < program.length; i++) {
+        IRTopLevel* tl = &program.data[i];
+        if (tl->ty == IRTFunction && !tl->val.function.global && called[i] > 0 && context.call_sites[i] == 0) {
+            removed++;
+            continue;
+        }
+        program.data[length++] = *tl;
+    }
+    program.length = length;
+
+    remark_stats("inlined %d calls, removed %d functions\n", context.inlined, removed);
+
+    free(seen);
+    free(called);
+    free(context.recursive);
+    free(context.call_sites);
+    free(context.state);
+    string_map_free(context.functions);
+
+    return program;
+}
@@ -0,0 +1,26 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// a callee gets inlined when its body, minus what the call itself costs, is at most this many instructions
+#define INLINER_GROWTH 10
+// callers stop taking inlined bodies past this size
+#define INLINER_MAX_CALLER 400
+
+typedef struct InlinerContext {
+    IRProgram* program;
+    IRGenerator* generator; // for fresh names
+    TCSymbols* symbols;
+    StringMap functions; // name -> index in the program
+    int* recursive; // per program entry, whether it can reach itself through calls
+    int* call_sites; // per program entry, calls to it left in the program
+    int* state; // per program entry, for the postorder walk: 0 unvisited, 1 on the stack, 2 done
+    int inlined;
+} InlinerContext;
+
+IRProgram inliner_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols);
+
+#endif
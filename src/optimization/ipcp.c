@@ -0,0 +1,522 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ipcp.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// interprocedural constant propagation and function specialization
+//
+// a param that every call to a function passes the same constant for stops being a param: the calls
+// drop the arg and the function starts by copying the constant into it. that only works when every call
+// is in the program, so not for global functions (unless -flto made them internal). gvn doesn't fold
+// constants, so the bound constants get pushed through the function right away: into the uses, through
+// whatever ops that makes constant, and into the branches, and blocks nothing reaches anymore go.
+//
+// calls that agree on some constants, but not with all the other calls, get a copy of the function
+// with those params bound the same way, as long as the calls are hot enough (the sites are weighted
+// by how deep in loops they are) and the copy fits in the budget. the original stays for everyone else,
+// and globaldce drops it if nothing calls it anymore.
+
+typedef VEC(char*) IPCPNames;
+
+int ipcp_size(IRFunctionDefinition* function) {
+    int size = 0;
+    for (int i = 0; i < function->body.length; i++) {
+        size += function->body.data[i].type != IRInstructionType_Label;
+    }
+    return size;
+}
+
+int ipcp_loop_depth(IPCPContext* context, int caller, int instruction) {
+    if (context->loop_depths[caller] == NULL) {
+        IRFunctionBody* body = &context->program->data[caller].val.function.body;
+        int* depths = calloc(body->length + 1, sizeof(int));
+
+        IRCFG cfg = cfg_build(body);
+        cfg_compute_dominators(&cfg);
+        IRLoops loops = cfg_find_loops(&cfg);
+        for (int l = 0; l < loops.length; l++) {
+            for (int b = 0; b < loops.data[l].blocks.length; b++) {
+                IRBlock* block = &cfg.data[loops.data[l].blocks.data[b]];
+                for (int i = block->start; i < block->end; i++) {
+                    depths[i]++;
+                }
+            }
+        }
+        cfg_loops_free(&loops);
+        cfg_free(&cfg);
+
+        context->loop_depths[caller] = depths;
+    }
+    return context->loop_depths[caller][instruction];
+}
+
+// every call to the function, false if one of them doesn't pass an arg per param
+int ipcp_collect_sites(IPCPContext* context, int callee, IPCPSites* sites) {
+    IRFunctionDefinition* function = &context->program->data[callee].val.function;
+
+    for (int f = 0; f < context->program->length; f++) {
+        if (context->program->data[f].ty != IRTFunction) {
+            continue;
+        }
+        IRFunctionBody* body = &context->program->data[f].val.function.body;
+        for (int i = 0; i < body->length; i++) {
+            IRInstruction* instruction = &body->data[i];
+            if (instruction->type != IRInstructionType_Call || strcmp(instruction->value.call.name, function->identifier) != 0) {
+                continue;
+            }
+            if (instruction->value.call.args.length != function->params.length) {
+                return false;
+            }
+            IPCPSite site = {f, i, 0};
+            vecptr_push(sites, site);
+        }
+    }
+    return true;
+}
+
+IRInstruction* ipcp_site_call(IPCPContext* context, IPCPSite* site) {
+    return &context->program->data[site->caller].val.function.body.data[site->instruction];
+}
+
+void ipcp_drop_args(IRInstruction* call, char* bound) {
+    int length = 0;
+    for (int a = 0; a < call->value.call.args.length; a++) {
+        if (!bound[a]) {
+            call->value.call.args.data[length++] = call->value.call.args.data[a];
+        }
+    }
+    call->value.call.args.length = length;
+}
+
+// the bound params become locals that start out as their constant
+void ipcp_bind_params(IRFunctionDefinition* function, char* bound, IRVal* values) {
+    IRFunctionBody body = {0};
+    int length = 0;
+    for (int p = 0; p < function->params.length; p++) {
+        if (!bound[p]) {
+            function->params.data[length++] = function->params.data[p];
+            continue;
+        }
+        IRInstruction copy = {
+            .type = IRInstructionType_Copy,
+            .value.copy = {
+                .src = values[p],
+                .dst = {.type = IRValType_Var, .value.var = function->params.data[p]},
+            },
+        };
+        vec_push(body, copy);
+    }
+    function->params.length = length;
+
+    for (int i = 0; i < function->body.length; i++) {
+        vec_push(body, function->body.data[i]);
+    }
+    vec_free(function->body);
+    function->body = body;
+}
+
+// a single def that copies a constant, which the uses can have directly
+int ipcp_constant_def(IRFunctionDefinition* function, IRVarInfo* info, int* value) {
+    if (info->is_static || info->defs != 1 || info->def_index < 0) {
+        return false;
+    }
+    IRInstruction* def = &function->body.data[info->def_index];
+    if (def->type != IRInstructionType_Copy || def->value.copy.src.type != IRValType_Int) {
+        return false;
+    }
+    *value = def->value.copy.src.value.integer;
+    return true;
+}
+
+int ipcp_fold(IRInstruction* instruction, char* deleted) {
+    int result;
+    switch (instruction->type) {
+        case IRInstructionType_Unary: {
+            IRVal src = instruction->value.unary.src;
+            if (src.type != IRValType_Int || !ir_fold_unary(instruction->value.unary.op, src.value.integer, &result)) {
+                return false;
+            }
+            IRVal dst = instruction->value.unary.dst;
+            *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {{IRValType_Int, {result}}, dst}};
+            return true;
+        }
+        case IRInstructionType_Binary: {
+            IRVal left = instruction->value.binary.left;
+            IRVal right = instruction->value.binary.right;
+            if (left.type != IRValType_Int || right.type != IRValType_Int ||
+                !ir_fold_binary(instruction->value.binary.op, left.value.integer, right.value.integer, &result)) {
+                return false;
+            }
+            IRVal dst = instruction->value.binary.dst;
+            *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {{IRValType_Int, {result}}, dst}};
+            return true;
+        }
+        case IRInstructionType_JumpIfZero:
+        case IRInstructionType_JumpIfNotZero: {
+            IRVal val = instruction->value.jump_cond.val;
+            if (val.type != IRValType_Int) {
+                return false;
+            }
+            int taken = (val.value.integer == 0) == (instruction->type == IRInstructionType_JumpIfZero);
+            if (taken) {
+                *instruction = (IRInstruction){.type = IRInstructionType_Jump, .value.label = instruction->value.jump_cond.label};
+            } else {
+                *deleted = true;
+            }
+            return true;
+        }
+        case IRInstructionType_JumpTable: {
+            IRVal index = instruction->value.jump_table.index;
+            if (index.type != IRValType_Int || index.value.integer < 0 ||
+                index.value.integer >= instruction->value.jump_table.labels.length) {
+                return false;
+            }
+            char* label = instruction->value.jump_table.labels.data[index.value.integer];
+            *instruction = (IRInstruction){.type = IRInstructionType_Jump, .value.label = label};
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+int ipcp_propagate(IPCPContext* context, IRFunctionDefinition* function) {
+    int folded = 0;
+    IRValRefs sources = {0};
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        IRVarInfos vars = ir_collect_var_info(function, context->symbols);
+        char* deleted = calloc(function->body.length + 1, 1);
+
+        for (int i = 0; i < function->body.length; i++) {
+            IRInstruction* instruction = &function->body.data[i];
+            sources.length = 0;
+            ir_instruction_sources(instruction, &sources);
+            for (int s = 0; s < sources.length; s++) {
+                int value;
+                if (sources.data[s]->type == IRValType_Var &&
+                    ipcp_constant_def(function, ir_var_info_get(&vars, sources.data[s]->value.var), &value)) {
+                    *sources.data[s] = (IRVal){.type = IRValType_Int, .value.integer = value};
+                    changed = true;
+                }
+            }
+        }
+
+        for (int v = 0; v < vars.length; v++) {
+            int value;
+            if (ipcp_constant_def(function, &vars.data[v], &value)) {
+                deleted[vars.data[v].def_index] = true;
+                folded++;
+            }
+        }
+        for (int i = 0; i < function->body.length; i++) {
+            if (!deleted[i] && ipcp_fold(&function->body.data[i], &deleted[i])) {
+                folded++;
+                changed = true;
+            }
+        }
+
+        int length = 0;
+        for (int i = 0; i < function->body.length; i++) {
+            if (!deleted[i]) {
+                function->body.data[length++] = function->body.data[i];
+            }
+        }
+        function->body.length = length;
+
+        free(deleted);
+        ir_var_infos_free(&vars);
+    }
+
+    IRCFG cfg = cfg_build(&function->body);
+    int length = 0;
+    for (int i = 0; i < function->body.length; i++) {
+        if (cfg.data[cfg.instruction_blocks[i]].rpo_index != -1) {
+            function->body.data[length++] = function->body.data[i];
+        } else {
+            folded++;
+        }
+    }
+    function->body.length = length;
+    cfg_free(&cfg);
+
+    vec_free(sources);
+    return folded;
+}
+
+char* ipcp_rename_label(StringMap* labels, IPCPNames* names, char* label, int clone) {
+    int index = string_map_get(labels, label);
+    if (index >= 0) {
+        return names->data[index];
+    }
+
+    char* renamed = malloc(strlen(label) + quick_log10(clone) + 5);
+    sprintf(renamed, "%s.sp%d", label, clone);
+    string_map_set(labels, label, names->length);
+    vecptr_push(names, renamed);
+    return renamed;
+}
+
+// vars are per function, so the copy keeps them, but labels have to be unique in the whole program
+IRFunctionDefinition ipcp_clone(IPCPContext* context, IRFunctionDefinition* function) {
+    int clone = context->generator->tmp_count++;
+    StringMap labels = string_map_new();
+    IPCPNames names = {0};
+
+    IRFunctionDefinition copy = {
+        .identifier = malloc(strlen(function->identifier) + quick_log10(clone) + 5),
+        .global = false,
+        .params = {malloc_n_type(char*, function->params.length + 1), function->params.length},
+        .body = {0},
+    };
+    sprintf(copy.identifier, "%s.sp%d", function->identifier, clone);
+    memcpy(copy.params.data, function->params.data, sizeof(char*) * function->params.length);
+
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction instruction = function->body.data[i];
+        switch (instruction.type) {
+            case IRInstructionType_Label:
+            case IRInstructionType_Jump:
+                instruction.value.label = ipcp_rename_label(&labels, &names, instruction.value.label, clone);
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                instruction.value.jump_cond.label = ipcp_rename_label(&labels, &names, instruction.value.jump_cond.label, clone);
+                break;
+            case IRInstructionType_JumpTable: {
+                int count = instruction.value.jump_table.labels.length;
+                char** table_labels = malloc_n_type(char*, count);
+                for (int l = 0; l < count; l++) {
+                    table_labels[l] = ipcp_rename_label(&labels, &names, instruction.value.jump_table.labels.data[l], clone);
+                }
+                instruction.value.jump_table.labels.data = table_labels;
+                instruction.value.jump_table.labels.capacity = count;
+                instruction.value.jump_table.table = ipcp_rename_label(&labels, &names, instruction.value.jump_table.table, clone);
+                break;
+            }
+            case IRInstructionType_Call: {
+                IRVal* args = malloc(sizeof(IRVal) * (instruction.value.call.args.length + 1));
+                memcpy(args, instruction.value.call.args.data, sizeof(IRVal) * instruction.value.call.args.length);
+                instruction.value.call.args.data = args;
+                instruction.value.call.args.capacity = instruction.value.call.args.length;
+                break;
+            }
+            default:
+                break;
+        }
+        vec_push(copy.body, instruction);
+    }
+
+    vec_free(names);
+    string_map_free(labels);
+    return copy;
+}
+
+void ipcp_invalidate(IPCPContext* context, int function) {
+    free(context->loop_depths[function]);
+    context->loop_depths[function] = NULL;
+}
+
+// params that get the same constant from every call
+int ipcp_substitute(IPCPContext* context, int callee, IPCPSites* sites, IPCPStats* stats) {
+    IRFunctionDefinition* function = &context->program->data[callee].val.function;
+    int params = function->params.length;
+    char* bound = malloc(params + 1);
+    IRVal* values = malloc_n_type(IRVal, params + 1);
+
+    int count = 0;
+    for (int p = 0; p < params; p++) {
+        IRVal first = ipcp_site_call(context, &sites->data[0])->value.call.args.data[p];
+        bound[p] = first.type == IRValType_Int;
+        values[p] = first;
+        for (int s = 1; s < sites->length && bound[p]; s++) {
+            bound[p] = ir_val_equal(ipcp_site_call(context, &sites->data[s])->value.call.args.data[p], first);
+        }
+        count += bound[p];
+    }
+
+    if (count > 0) {
+        // the calls first, some of them may be in the function itself
+        for (int s = 0; s < sites->length; s++) {
+            ipcp_drop_args(ipcp_site_call(context, &sites->data[s]), bound);
+        }
+        ipcp_bind_params(function, bound, values);
+        int folded = ipcp_propagate(context, function);
+        stats->folded += folded;
+        ipcp_invalidate(context, callee);
+
+        stats->params += count;
+        remark(RemarkKind_Passed, "ipcp", "ConstantParam", function->identifier,
+            "%d of %d params are the same constant in all %d calls", count, params, sites->length);
+        if (folded > 0) {
+            remark(RemarkKind_Passed, "ipcp", "Folded", function->identifier,
+                "%d instructions folded with the constant params", folded);
+        }
+    }
+
+    free(bound);
+    free(values);
+    return count;
+}
+
+char* ipcp_site_key(IRInstruction* call) {
+    char* key = malloc(call->value.call.args.length * 24 + 1);
+    int length = 0;
+    key[0] = '\0';
+    for (int a = 0; a < call->value.call.args.length; a++) {
+        IRVal arg = call->value.call.args.data[a];
+        if (arg.type == IRValType_Int) {
+            length += sprintf(key + length, "%s%d=%d", length > 0 ? "," : "", a, arg.value.integer);
+        }
+    }
+    return key;
+}
+
+void ipcp_specialize(IPCPContext* context, int callee, IPCPSites* sites, IPCPStats* stats) {
+    IRFunctionDefinition* function = &context->program->data[callee].val.function;
+    int size = ipcp_size(function);
+
+    VEC(IPCPGroup) groups = {0};
+    StringMap keys = string_map_new();
+    for (int s = 0; s < sites->length; s++) {
+        IPCPSite site = sites->data[s];
+        char* key = ipcp_site_key(ipcp_site_call(context, &site));
+        if (key[0] == '\0') {
+            free(key);
+            continue;
+        }
+
+        site.weight = 1;
+        for (int d = ipcp_loop_depth(context, site.caller, site.instruction); d > 0 && site.weight < 512; d--) {
+            site.weight *= IPCP_LOOP_WEIGHT;
+        }
+
+        int index = string_map_get(&keys, key);
+        if (index < 0) {
+            index = groups.length;
+            string_map_set(&keys, key, index);
+            IPCPGroup group = {key, {0}, 0};
+            vec_push(groups, group);
+        } else {
+            free(key);
+        }
+        vec_push(groups.data[index].sites, site);
+        groups.data[index].weight += site.weight;
+    }
+
+    // hottest first
+    int clones = 0;
+    for (int round = 0; round < groups.length; round++) {
+        int best = -1;
+        for (int g = 0; g < groups.length; g++) {
+            if (groups.data[g].weight >= IPCP_HOT_WEIGHT && (best < 0 || groups.data[g].weight > groups.data[best].weight)) {
+                best = g;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        IPCPGroup* group = &groups.data[best];
+        group->weight = 0;
+
+        if (size > IPCP_MAX_CLONE_SIZE || size > context->budget || clones == IPCP_MAX_CLONES) {
+            remark(RemarkKind_Missed, "ipcp", size > IPCP_MAX_CLONE_SIZE ? "TooBig" : "OutOfBudget", function->identifier,
+                "not specialized for constant args %s, %d instructions", group->key, size);
+            continue;
+        }
+
+        IRInstruction* first = ipcp_site_call(context, &group->sites.data[0]);
+        char* bound = malloc(function->params.length + 1);
+        for (int p = 0; p < function->params.length; p++) {
+            bound[p] = first->value.call.args.data[p].type == IRValType_Int;
+        }
+
+        IRFunctionDefinition clone = ipcp_clone(context, function);
+        ipcp_bind_params(&clone, bound, first->value.call.args.data);
+        int folded = ipcp_propagate(context, &clone);
+        if (folded * 100 < size * IPCP_MIN_FOLDED_PERCENT) {
+            remark(RemarkKind_Missed, "ipcp", "NotProfitable", function->identifier,
+                "constant args %s only fold %d of %d instructions", group->key, folded, size);
+            vec_free(clone.body);
+            free(clone.params.data);
+            free(clone.identifier);
+            free(bound);
+            continue;
+        }
+
+        for (int s = 0; s < group->sites.length; s++) {
+            IRInstruction* call = ipcp_site_call(context, &group->sites.data[s]);
+            ipcp_drop_args(call, bound);
+            call->value.call.name = clone.identifier;
+        }
+        free(bound);
+
+        remark(RemarkKind_Passed, "ipcp", "Specialized", function->identifier, "specialized as %s for constant args %s, %d calls",
+            clone.identifier, group->key, group->sites.length);
+        remark(RemarkKind_Passed, "ipcp", "Folded", clone.identifier, "%d of %d instructions folded", folded, size);
+        IRTopLevel tl = {.ty = IRTFunction, .val.function = clone};
+        vec_push(context->clones, tl);
+        context->budget -= size;
+        stats->clones++;
+        stats->redirected += group->sites.length;
+        stats->folded += folded;
+        clones++;
+    }
+
+    for (int g = 0; g < groups.length; g++) {
+        free(groups.data[g].key);
+        vec_free(groups.data[g].sites);
+    }
+    vec_free(groups);
+    string_map_free(keys);
+}
+
+IRProgram ipcp_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, int specialize, IPCPStats* stats) {
+    IPCPContext context = {
+        .program = &program,
+        .generator = generator,
+        .symbols = symbols,
+        .loop_depths = calloc(program.length + 1, sizeof(int*)),
+        .budget = specialize ? IPCP_SPECIALIZE_BUDGET : 0,
+        .clones = {0},
+    };
+
+    IPCPSites sites = {0};
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty != IRTFunction || program.data[i].val.function.params.length == 0) {
+            continue;
+        }
+
+        sites.length = 0;
+        if (!ipcp_collect_sites(&context, i, &sites) || sites.length == 0) {
+            continue;
+        }
+
+        if (!program.data[i].val.function.global && ipcp_substitute(&context, i, &sites, stats) > 0) {
+            // its body changed, so the calls it makes to itself moved
+            sites.length = 0;
+            ipcp_collect_sites(&context, i, &sites);
+        }
+        if (context.budget > 0) {
+            ipcp_specialize(&context, i, &sites, stats);
+        }
+    }
+
+    for (int i = 0; i < program.length; i++) {
+        free(context.loop_depths[i]);
+    }
+    for (int c = 0; c < context.clones.length; c++) {
+        vec_push(program, context.clones.data[c]);
+    }
+
+    free(context.loop_depths);
+    vec_free(sites);
+    vec_free(context.clones);
+
+    return program;
+}
@@ -0,0 +1,54 @@
+#ifndef IPCP_H
+#define IPCP_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// ir instructions all the specialized copies together can add to the program
+#define IPCP_SPECIALIZE_BUDGET 256
+// functions bigger than this don't get specialized
+#define IPCP_MAX_CLONE_SIZE 64
+#define IPCP_MAX_CLONES 4 // per function
+// a copy only stays if the constants got rid of at least this much of it
+#define IPCP_MIN_FOLDED_PERCENT 25
+// a set of constant args is worth a copy when its call sites add up to this much. a site in a loop
+// counts IPCP_LOOP_WEIGHT times as much as one outside, so a single call in a loop is enough
+#define IPCP_HOT_WEIGHT 8
+#define IPCP_LOOP_WEIGHT 8
+
+typedef struct IPCPSite {
+    int caller; // index in the program
+    int instruction;
+    int weight;
+} IPCPSite;
+
+typedef VEC(IPCPSite) IPCPSites;
+
+// call sites that pass the same constants in the same places
+typedef struct IPCPGroup {
+    char* key;
+    IPCPSites sites;
+    int weight;
+} IPCPGroup;
+
+typedef struct IPCPContext {
+    IRProgram* program;
+    IRGenerator* generator; // for the names of the copies
+    TCSymbols* symbols;
+    int** loop_depths; // per program entry and instruction, filled in the first time a site needs it
+    int budget; // what's left of IPCP_SPECIALIZE_BUDGET, 0 when only substituting
+    VEC(IRTopLevel) clones; // added to the program at the end, so indices into it stay put
+} IPCPContext;
+
+typedef struct IPCPStats {
+    int params; // params every call passed the same constant for
+    int clones;
+    int redirected; // calls that go to a clone now
+    int folded; // instructions the bound constants made constant, or dead
+} IPCPStats;
+
+// specialize is false for -Os, where only the params every call agrees on get substituted
+IRProgram ipcp_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, int specialize, IPCPStats* stats);
+
+#endif
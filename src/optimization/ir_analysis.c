@@ -0,0 +1,643 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_analysis.h"
+
+int ir_instruction_ends_block(IRInstruction* instruction) {
+    switch (instruction->type) {
+        case IRInstructionType_Return:
+        case IRInstructionType_Jump:
+        case IRInstructionType_JumpIfZero:
+        case IRInstructionType_JumpIfNotZero:
+        case IRInstructionType_JumpTable:
+            return true;
+        default:
+            return false;
+    }
+}
+
+IRVal* ir_instruction_dst(IRInstruction* instruction) {
+    switch (instruction->type) {
+        case IRInstructionType_Unary:
+            return &instruction->value.unary.dst;
+        case IRInstructionType_Binary:
+            return &instruction->value.binary.dst;
+        case IRInstructionType_Copy:
+            return &instruction->value.copy.dst;
+        case IRInstructionType_Call:
+            return &instruction->value.call.dst;
+        default:
+            return NULL;
+    }
+}
+
+void ir_instruction_sources(IRInstruction* instruction, IRValRefs* sources) {
+    switch (instruction->type) {
+        case IRInstructionType_Unary:
+            vecptr_push(sources, &instruction->value.unary.src);
+            break;
+        case IRInstructionType_Binary:
+            vecptr_push(sources, &instruction->value.binary.left);
+            vecptr_push(sources, &instruction->value.binary.right);
+            break;
+        case IRInstructionType_Copy:
+            vecptr_push(sources, &instruction->value.copy.src);
+            break;
+        case IRInstructionType_Return:
+            vecptr_push(sources, &instruction->value.val);
+            break;
+        case IRInstructionType_JumpIfZero:
+        case IRInstructionType_JumpIfNotZero:
+            vecptr_push(sources, &instruction->value.jump_cond.val);
+            break;
+        case IRInstructionType_JumpTable:
+            vecptr_push(sources, &instruction->value.jump_table.index);
+            break;
+        case IRInstructionType_Call:
+            for (int i = 0; i < instruction->value.call.args.length; i++) {
+                vecptr_push(sources, &instruction->value.call.args.data[i]);
+            }
+            break;
+        case IRInstructionType_Jump:
+        case IRInstructionType_Label:
+            break;
+    }
+}
+
+int ir_val_equal(IRVal a, IRVal b) {
+    if (a.type != b.type) {
+        return false;
+    }
+
+    switch (a.type) {
+        case IRValType_Int:
+            return a.value.integer == b.value.integer;
+        case IRValType_Var:
+            return a.value.var == b.value.var || !strcmp(a.value.var, b.value.var);
+    }
+
+    return false;
+}
+
+int ir_val_is_var(IRVal val, char* name) {
+    return val.type == IRValType_Var && (val.value.var == name || !strcmp(val.value.var, name));
+}
+
+int ir_is_static_var(char* name, TCSymbols* symbols) {
+    int idx = symbols_index_of(name, symbols);
+    return idx >= 0 && symbols->data[idx].attrs.ty == IAStaticAttr;
+}
+
+int ir_match_step(IRInstruction* instruction, char* name, int* step) {
+    if (instruction->type != IRInstructionType_Binary) {
+        return false;
+    }
+    IRVal left = instruction->value.binary.left;
+    IRVal right = instruction->value.binary.right;
+    switch (instruction->value.binary.op) {
+        case IRBinaryOp_Add:
+            if (ir_val_is_var(left, name) && right.type == IRValType_Int) {
+                *step = right.value.integer;
+                return true;
+            }
+            if (ir_val_is_var(right, name) && left.type == IRValType_Int) {
+                *step = left.value.integer;
+                return true;
+            }
+            return false;
+        case IRBinaryOp_Subtract:
+            if (ir_val_is_var(left, name) && right.type == IRValType_Int) {
+                *step = -right.value.integer;
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// only non-negative operands and results that fit in 15 bits, so 16 bit wraparound and the
+// machine's unsigned compares, divides and shifts can't make it come out differently
+int ir_fold_unary(IRUnaryOp op, int a, int* result) {
+    long value;
+    if (a < 0) {
+        return false;
+    }
+    switch (op) {
+        case IRUnaryOp_Not: value = !a; break;
+        case IRUnaryOp_Negate: value = -a; break;
+        default: return false;
+    }
+    if (value < 0 || value > 32767) {
+        return false;
+    }
+    *result = (int)value;
+    return true;
+}
+
+int ir_fold_binary(IRBinaryOp op, int a, int b, int* result) {
+    long value;
+    if (a < 0 || b < 0) {
+        return false;
+    }
+    switch (op) {
+        case IRBinaryOp_Add: value = (long)a + b; break;
+        case IRBinaryOp_Subtract: value = (long)a - b; break;
+        case IRBinaryOp_Multiply: value = (long)a * b; break;
+        case IRBinaryOp_Divide: if (b == 0) { return false; } value = a / b; break;
+        case IRBinaryOp_Mod: if (b == 0) { return false; } value = a % b; break;
+        case IRBinaryOp_BitwiseAnd: value = a & b; break;
+        case IRBinaryOp_BitwiseOr: value = a | b; break;
+        case IRBinaryOp_BitwiseXor: value = a ^ b; break;
+        case IRBinaryOp_LeftShift: if (b >= 15) { return false; } value = (long)a << b; break;
+        case IRBinaryOp_RightShift: if (b >= 16) { return false; } value = a >> b; break;
+        case IRBinaryOp_Equal: value = a == b; break;
+        case IRBinaryOp_NotEqual: value = a != b; break;
+        case IRBinaryOp_Less: value = a < b; break;
+        case IRBinaryOp_LessEqual: value = a <= b; break;
+        case IRBinaryOp_Greater: value = a > b; break;
+        case IRBinaryOp_GreaterEqual: value = a >= b; break;
+        default: return false;
+    }
+    if (value < 0 || value > 32767) {
+        return false;
+    }
+    *result = (int)value;
+    return true;
+}
+
+int cfg_block_for_label(IRCFG* cfg, StringMap* labels, char* label) {
+    int block = string_map_get(labels, label);
+    if (block < 0 || block >= cfg->length) {
+        fprintf(stderr, "Jump to unknown label %s\n", label);
+        exit(1);
+    }
+    return block;
+}
+
+void cfg_add_edge(IRCFG* cfg, int from, int to) {
+    for (int i = 0; i < cfg->data[from].successors.length; i++) {
+        if (cfg->data[from].successors.data[i] == to) {
+            return;
+        }
+    }
+    vec_push(cfg->data[from].successors, to);
+    vec_push(cfg->data[to].predecessors, from);
+}
+
+IRCFG cfg_build(IRFunctionBody* body) {
+    IRCFG cfg = {0};
+    cfg.instruction_blocks = malloc_n_type(int, body->length + 1);
+
+    StringMap labels = string_map_new();
+
+    // split the body into blocks
+    int start = 0;
+    for (int i = 0; i <= body->length; i++) {
+        int split = i == body->length;
+        if (!split && body->data[i].type == IRInstructionType_Label && i > start) {
+            split = true;
+        }
+        if (!split && i > start && ir_instruction_ends_block(&body->data[i - 1])) {
+            split = true;
+        }
+
+        if (split && (i > start || cfg.length == 0)) {
+            IRBlock block = {
+                .start = start,
+                .end = i,
+                .idom = -1,
+                .rpo_index = -1,
+            };
+            vec_push(cfg, block);
+            start = i;
+        }
+
+        if (i < body->length) {
+            cfg.instruction_blocks[i] = cfg.length;
+            if (body->data[i].type == IRInstructionType_Label) {
+                string_map_set(&labels, body->data[i].value.label, cfg.length);
+            }
+        }
+    }
+
+    // edges
+    for (int b = 0; b < cfg.length; b++) {
+        IRBlock block = cfg.data[b];
+        if (block.end == block.start) {
+            continue;
+        }
+
+        IRInstruction* last = &body->data[block.end - 1];
+        switch (last->type) {
+            case IRInstructionType_Return:
+                break;
+            case IRInstructionType_Jump:
+                cfg_add_edge(&cfg, b, cfg_block_for_label(&cfg, &labels, last->value.label));
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                cfg_add_edge(&cfg, b, cfg_block_for_label(&cfg, &labels, last->value.jump_cond.label));
+                if (b + 1 < cfg.length) {
+                    cfg_add_edge(&cfg, b, b + 1);
+                }
+                break;
+            case IRInstructionType_JumpTable:
+                for (int l = 0; l < last->value.jump_table.labels.length; l++) {
+                    cfg_add_edge(&cfg, b, cfg_block_for_label(&cfg, &labels, last->value.jump_table.labels.data[l]));
+                }
+                break;
+            default:
+                if (b + 1 < cfg.length) {
+                    cfg_add_edge(&cfg, b, b + 1);
+                }
+                break;
+        }
+    }
+
+    string_map_free(labels);
+
+    // reverse postorder with an explicit stack, so deep nesting doesn't blow the c stack
+    int* visited = calloc(cfg.length, sizeof(int));
+    int* next_succ = calloc(cfg.length, sizeof(int));
+    int* postorder = malloc_n_type(int, cfg.length);
+    int post_length = 0;
+    IntVec stack = {0};
+
+    vec_push(stack, 0);
+    visited[0] = true;
+    while (stack.length > 0) {
+        int b = stack.data[stack.length - 1];
+        if (next_succ[b] < cfg.data[b].successors.length) {
+            int succ = cfg.data[b].successors.data[next_succ[b]++];
+            if (!visited[succ]) {
+                visited[succ] = true;
+                vec_push(stack, succ);
+            }
+        } else {
+            postorder[post_length++] = b;
+            stack.length--;
+        }
+    }
+
+    for (int i = post_length - 1; i >= 0; i--) {
+        cfg.data[postorder[i]].rpo_index = cfg.rpo.length;
+        vec_push(cfg.rpo, postorder[i]);
+    }
+
+    free(visited);
+    free(next_succ);
+    free(postorder);
+    vec_free(stack);
+
+    return cfg;
+}
+
+int cfg_intersect(IRCFG* cfg, int a, int b) {
+    while (a != b) {
+        while (cfg->data[a].rpo_index > cfg->data[b].rpo_index) {
+            a = cfg->data[a].idom;
+        }
+        while (cfg->data[b].rpo_index > cfg->data[a].rpo_index) {
+            b = cfg->data[b].idom;
+        }
+    }
+    return a;
+}
+
+// cooper, harvey & kennedy's "a simple, fast dominance algorithm"
+void cfg_compute_dominators(IRCFG* cfg) {
+    if (cfg->rpo.length == 0) {
+        return;
+    }
+
+    int entry = cfg->rpo.data[0];
+    cfg->data[entry].idom = entry;
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < cfg->rpo.length; i++) {
+            int b = cfg->rpo.data[i];
+            int new_idom = -1;
+
+            for (int p = 0; p < cfg->data[b].predecessors.length; p++) {
+                int pred = cfg->data[b].predecessors.data[p];
+                if (cfg->data[pred].idom == -1) {
+                    continue;
+                }
+                new_idom = new_idom == -1 ? pred : cfg_intersect(cfg, pred, new_idom);
+            }
+
+            if (cfg->data[b].idom != new_idom) {
+                cfg->data[b].idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    cfg->data[entry].idom = -1;
+
+    for (int i = 1; i < cfg->rpo.length; i++) {
+        int b = cfg->rpo.data[i];
+        vec_push(cfg->data[cfg->data[b].idom].dom_children, b);
+    }
+}
+
+int cfg_dominates(IRCFG* cfg, int dominator, int block) {
+    if (cfg->data[block].rpo_index == -1) {
+        return true; // everything dominates unreachable code
+    }
+
+    while (block != -1) {
+        if (block == dominator) {
+            return true;
+        }
+        block = cfg->data[block].idom;
+    }
+    return false;
+}
+
+// instruction -1 is the function entry (where params get defined)
+int cfg_instruction_dominates(IRCFG* cfg, int dominator, int instruction) {
+    if (dominator == -1) {
+        return true;
+    }
+
+    int dom_block = cfg->instruction_blocks[dominator];
+    int block = cfg->instruction_blocks[instruction];
+    if (dom_block == block) {
+        return dominator < instruction;
+    }
+    return cfg_dominates(cfg, dom_block, block);
+}
+
+void cfg_free(IRCFG* cfg) {
+    for (int i = 0; i < cfg->length; i++) {
+        vec_free(cfg->data[i].successors);
+        vec_free(cfg->data[i].predecessors);
+        vec_free(cfg->data[i].dom_children);
+    }
+    vec_free(*cfg);
+    vec_free(cfg->rpo);
+    free(cfg->instruction_blocks);
+}
+
+// the entries need a header label to jump to, and nothing in the loop may fall into the header,
+// since it'd fall into the preheader instead
+int cfg_can_add_preheader(IRCFG* cfg, IRFunctionBody* body, IRLoop* loop) {
+    IRBlock* header = &cfg->data[loop->header];
+    if (header->start == header->end || body->data[header->start].type != IRInstructionType_Label) {
+        return false;
+    }
+    if (header->start == 0) {
+        return true;
+    }
+
+    IRInstructionType last = body->data[header->start - 1].type;
+    return !loop->contains[cfg->instruction_blocks[header->start - 1]] || last == IRInstructionType_Jump ||
+        last == IRInstructionType_JumpTable || last == IRInstructionType_Return;
+}
+
+void ir_retarget_jump(IRInstruction* instruction, char* from, char* to) {
+    switch (instruction->type) {
+        case IRInstructionType_Jump:
+            if (!strcmp(instruction->value.label, from)) {
+                instruction->value.label = to;
+            }
+            break;
+        case IRInstructionType_JumpIfZero:
+        case IRInstructionType_JumpIfNotZero:
+            if (!strcmp(instruction->value.jump_cond.label, from)) {
+                instruction->value.jump_cond.label = to;
+            }
+            break;
+        case IRInstructionType_JumpTable:
+            for (int l = 0; l < instruction->value.jump_table.labels.length; l++) {
+                if (!strcmp(instruction->value.jump_table.labels.data[l], from)) {
+                    instruction->value.jump_table.labels.data[l] = to;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// natural loops, one per header (back edges to the same header get merged)
+IRLoops cfg_find_loops(IRCFG* cfg) {
+    IRLoops loops = {0};
+    IntVec worklist = {0};
+
+    for (int i = 0; i < cfg->rpo.length; i++) {
+        int header = cfg->rpo.data[i];
+        IRLoop loop = {.header = header};
+
+        for (int p = 0; p < cfg->data[header].predecessors.length; p++) {
+            int pred = cfg->data[header].predecessors.data[p];
+            if (cfg->data[pred].rpo_index != -1 && cfg_dominates(cfg, header, pred)) {
+                vec_push(loop.latches, pred);
+            }
+        }
+
+        if (loop.latches.length == 0) {
+            continue;
+        }
+
+        loop.contains = calloc(cfg->length, sizeof(int));
+        loop.contains[header] = true;
+        vec_push(loop.blocks, header);
+
+        // walk backwards from the latches until we hit the header
+        worklist.length = 0;
+        for (int l = 0; l < loop.latches.length; l++) {
+            vec_push(worklist, loop.latches.data[l]);
+        }
+        while (worklist.length > 0) {
+            int b = worklist.data[--worklist.length];
+            if (loop.contains[b]) {
+                continue;
+            }
+            loop.contains[b] = true;
+            vec_push(loop.blocks, b);
+            for (int p = 0; p < cfg->data[b].predecessors.length; p++) {
+                int pred = cfg->data[b].predecessors.data[p];
+                if (cfg->data[pred].rpo_index != -1 && !loop.contains[pred]) {
+                    vec_push(worklist, pred);
+                }
+            }
+        }
+
+        vec_push(loops, loop);
+    }
+    vec_free(worklist);
+
+    // a loop nested in another one always has fewer blocks
+    for (int i = 1; i < loops.length; i++) {
+        IRLoop loop = loops.data[i];
+        int j = i - 1;
+        while (j >= 0 && loops.data[j].blocks.length > loop.blocks.length) {
+            loops.data[j + 1] = loops.data[j];
+            j--;
+        }
+        loops.data[j + 1] = loop;
+    }
+
+    return loops;
+}
+
+void cfg_loops_free(IRLoops* loops) {
+    for (int i = 0; i < loops->length; i++) {
+        vec_free(loops->data[i].blocks);
+        vec_free(loops->data[i].latches);
+        free(loops->data[i].contains);
+    }
+    vec_free(*loops);
+}
+
+IRVarInfo* ir_var_info_add(IRVarInfos* infos, char* name, TCSymbols* symbols) {
+    int idx = string_map_get(&infos->indices, name);
+    if (idx == -1) {
+        IRVarInfo info = {
+            .name = name,
+            .defs = 0,
+            .uses = 0,
+            .def_index = -1,
+            .is_static = ir_is_static_var(name, symbols),
+        };
+        idx = infos->length;
+        vecptr_push(infos, info);
+        string_map_set(&infos->indices, name, idx);
+    }
+    return &infos->data[idx];
+}
+
+IRVarInfos ir_collect_var_info(IRFunctionDefinition* function, TCSymbols* symbols) {
+    IRVarInfos infos = {0};
+    infos.indices = string_map_new();
+
+    // params get their first def on entry
+    for (int i = 0; i < function->params.length; i++) {
+        IRVarInfo* info = ir_var_info_add(&infos, function->params.data[i], symbols);
+        info->defs++;
+    }
+
+    IRValRefs sources = {0};
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+
+        sources.length = 0;
+        ir_instruction_sources(instruction, &sources);
+        for (int s = 0; s < sources.length; s++) {
+            if (sources.data[s]->type == IRValType_Var) {
+                ir_var_info_add(&infos, sources.data[s]->value.var, symbols)->uses++;
+            }
+        }
+
+        IRVal* dst = ir_instruction_dst(instruction);
+        if (dst != NULL && dst->type == IRValType_Var) {
+            IRVarInfo* info = ir_var_info_add(&infos, dst->value.var, symbols);
+            info->defs++;
+            info->def_index = i;
+        }
+    }
+    vec_free(sources);
+
+    return infos;
+}
+
+IRVarInfo* ir_var_info_get(IRVarInfos* infos, char* name) {
+    int idx = string_map_get(&infos->indices, name);
+    return idx == -1 ? NULL : &infos->data[idx];
+}
+
+void ir_var_infos_free(IRVarInfos* infos) {
+    vec_free(*infos);
+    string_map_free(infos->indices);
+}
+
+// backwards dataflow over the blocks, statics count as live everywhere since anyone can read them
+IRLiveness ir_compute_liveness(IRFunctionDefinition* function, IRCFG* cfg, IRVarInfos* vars) {
+    int words = bitset_words(vars->length);
+    IRLiveness liveness = {
+        .words = words,
+        .live_in = calloc((size_t)(cfg->length * words), sizeof(unsigned int)),
+        .live_out = calloc((size_t)(cfg->length * words), sizeof(unsigned int)),
+    };
+
+    unsigned int* statics = calloc(words, sizeof(unsigned int));
+    for (int v = 0; v < vars->length; v++) {
+        if (vars->data[v].is_static) {
+            bitset_add(statics, v);
+        }
+    }
+
+    unsigned int* live = malloc_n_type(unsigned int, words);
+    IRValRefs sources = {0};
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int r = cfg->rpo.length - 1; r >= 0; r--) {
+            int b = cfg->rpo.data[r];
+            IRBlock* block = &cfg->data[b];
+            unsigned int* out = &liveness.live_out[b * words];
+            unsigned int* in = &liveness.live_in[b * words];
+
+            for (int w = 0; w < words; w++) {
+                out[w] = statics[w];
+            }
+            for (int s = 0; s < block->successors.length; s++) {
+                unsigned int* succ_in = &liveness.live_in[block->successors.data[s] * words];
+                for (int w = 0; w < words; w++) {
+                    out[w] |= succ_in[w];
+                }
+            }
+
+            memcpy(live, out, words * sizeof(unsigned int));
+            for (int i = block->end - 1; i >= block->start; i--) {
+                IRInstruction* instruction = &function->body.data[i];
+
+                IRVal* dst = ir_instruction_dst(instruction);
+                if (dst != NULL && dst->type == IRValType_Var) {
+                    bitset_remove(live, string_map_get(&vars->indices, dst->value.var));
+                }
+
+                sources.length = 0;
+                ir_instruction_sources(instruction, &sources);
+                for (int s = 0; s < sources.length; s++) {
+                    if (sources.data[s]->type == IRValType_Var) {
+                        bitset_add(live, string_map_get(&vars->indices, sources.data[s]->value.var));
+                    }
+                }
+            }
+            for (int w = 0; w < words; w++) {
+                live[w] |= statics[w];
+            }
+
+            if (memcmp(live, in, words * sizeof(unsigned int))) {
+                memcpy(in, live, words * sizeof(unsigned int));
+                changed = true;
+            }
+        }
+    }
+
+    free(statics);
+    free(live);
+    vec_free(sources);
+
+    return liveness;
+}
+
+int ir_live_in(IRLiveness* liveness, int block, int var) {
+    return bitset_has(&liveness->live_in[block * liveness->words], var);
+}
+
+int ir_live_out(IRLiveness* liveness, int block, int var) {
+    return bitset_has(&liveness->live_out[block * liveness->words], var);
+}
+
+void ir_liveness_free(IRLiveness* liveness) {
+    free(liveness->live_in);
+    free(liveness->live_out);
+}
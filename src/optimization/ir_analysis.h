@@ -0,0 +1,93 @@
+#ifndef IR_ANALYSIS_H
+#define IR_ANALYSIS_H
+
+#include "../ir.h"
+#include "../easy_stuff.h"
+#include "../string_map.h"
+#include "../semantic_analysis/type_checking.h"
+
+typedef VEC(int) IntVec;
+typedef VEC(IRVal*) IRValRefs;
+
+typedef struct IRBlock {
+    int start; // index of the first instruction in the function body
+    int end; // one past the last instruction
+    IntVec successors;
+    IntVec predecessors;
+    IntVec dom_children;
+    int idom; // -1 for the entry block and unreachable blocks
+    int rpo_index; // -1 if the block is unreachable
+} IRBlock;
+
+typedef struct IRCFG {
+    IRBlock* data;
+    int length;
+    int capacity;
+    IntVec rpo; // reachable blocks in reverse postorder
+    int* instruction_blocks; // block of every instruction in the body
+} IRCFG;
+
+typedef struct IRLoop {
+    int header;
+    IntVec blocks; // every block in the loop, header included
+    IntVec latches; // blocks with a back edge to the header
+    int* contains; // per block flag
+} IRLoop;
+
+typedef VEC(IRLoop) IRLoops;
+
+typedef struct IRVarInfo {
+    char* name;
+    int defs;
+    int uses;
+    int def_index; // instruction index of the last def we saw
+    int is_static;
+} IRVarInfo;
+
+typedef struct IRVarInfos {
+    IRVarInfo* data;
+    int length;
+    int capacity;
+    StringMap indices;
+} IRVarInfos;
+
+typedef struct IRLiveness {
+    int words; // words per set
+    unsigned int* live_in; // block * words
+    unsigned int* live_out;
+} IRLiveness;
+
+IRCFG cfg_build(IRFunctionBody* body);
+void cfg_compute_dominators(IRCFG* cfg);
+int cfg_dominates(IRCFG* cfg, int dominator, int block);
+int cfg_instruction_dominates(IRCFG* cfg, int dominator, int instruction);
+void cfg_free(IRCFG* cfg);
+IRLoops cfg_find_loops(IRCFG* cfg); // needs dominators, innermost loops come first
+void cfg_loops_free(IRLoops* loops);
+// a preheader is a new block right before the header that only the entries into the loop go through
+int cfg_can_add_preheader(IRCFG* cfg, IRFunctionBody* body, IRLoop* loop);
+void ir_retarget_jump(IRInstruction* instruction, char* from, char* to);
+
+int ir_instruction_ends_block(IRInstruction* instruction);
+IRVal* ir_instruction_dst(IRInstruction* instruction);
+void ir_instruction_sources(IRInstruction* instruction, IRValRefs* sources);
+int ir_val_equal(IRVal a, IRVal b);
+int ir_val_is_var(IRVal val, char* name);
+int ir_is_static_var(char* name, TCSymbols* symbols);
+// `name = name + c`, `name = c + name` or `name = name - c`, how loop counters move
+int ir_match_step(IRInstruction* instruction, char* name, int* step);
+// constant folding the way the machine would do it, false when that can't be done safely
+int ir_fold_unary(IRUnaryOp op, int a, int* result);
+int ir_fold_binary(IRBinaryOp op, int a, int b, int* result);
+
+IRVarInfos ir_collect_var_info(IRFunctionDefinition* function, TCSymbols* symbols);
+IRVarInfo* ir_var_info_get(IRVarInfos* infos, char* name); // NULL for names that never show up
+void ir_var_infos_free(IRVarInfos* infos);
+
+// var sets are indexed like the var infos
+IRLiveness ir_compute_liveness(IRFunctionDefinition* function, IRCFG* cfg, IRVarInfos* vars);
+int ir_live_in(IRLiveness* liveness, int block, int var);
+int ir_live_out(IRLiveness* liveness, int block, int var);
+void ir_liveness_free(IRLiveness* liveness);
+
+#endif
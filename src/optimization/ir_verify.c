@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "ir_verify.h"
+#include "../easy_stuff.h"
+
+// sanity checks the passes can break without the output failing loudly:
+// every label is unique (the assembler can't handle duplicates), every jump has a target in its function,
+// everything that gets written is a var, and compiler temps are never read before they're written
+
+int ir_verify_is_temp(char* name) {
+    return strncmp(name, ".t.", 3) == 0;
+}
+
+int ir_verify_add_label(StringMap* labels, char* function, char* label) {
+    if (string_map_get(labels, label) != -1) {
+        fprintf(stderr, "%s: label %s defined more than once\n", function, label);
+        return 1;
+    }
+    string_map_set(labels, label, 1);
+    return 0;
+}
+
+int ir_verify_target(StringMap* own_labels, char* function, char* label) {
+    if (string_map_get(own_labels, label) == -1) {
+        fprintf(stderr, "%s: jump to missing label %s\n", function, label);
+        return 1;
+    }
+    return 0;
+}
+
+int ir_verify_function(IRFunctionDefinition* function, TCSymbols* symbols, StringMap* labels) {
+    IRFunctionBody* body = &function->body;
+    char* name = function->identifier;
+    int errors = 0;
+
+    StringMap own_labels = string_map_new();
+    for (int i = 0; i < body->length; i++) {
+        IRInstruction* instruction = &body->data[i];
+        if (instruction->type == IRInstructionType_Label) {
+            errors += ir_verify_add_label(labels, name, instruction->value.label);
+            string_map_set(&own_labels, instruction->value.label, 1);
+        } else if (instruction->type == IRInstructionType_JumpTable) {
+            errors += ir_verify_add_label(labels, name, instruction->value.jump_table.table);
+        }
+    }
+
+    for (int i = 0; i < body->length; i++) {
+        IRInstruction* instruction = &body->data[i];
+        switch (instruction->type) {
+            case IRInstructionType_Jump:
+                errors += ir_verify_target(&own_labels, name, instruction->value.label);
+                break;
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero:
+                errors += ir_verify_target(&own_labels, name, instruction->value.jump_cond.label);
+                break;
+            case IRInstructionType_JumpTable:
+                for (int l = 0; l < instruction->value.jump_table.labels.length; l++) {
+                    errors += ir_verify_target(&own_labels, name, instruction->value.jump_table.labels.data[l]);
+                }
+                break;
+            default:
+                break;
+        }
+
+        IRVal* dst = ir_instruction_dst(instruction);
+        if (dst != NULL && dst->type != IRValType_Var) {
+            fprintf(stderr, "%s: instruction %d writes to a constant\n", name, i);
+            errors++;
+        }
+    }
+    string_map_free(own_labels);
+
+    // a temp that's live into the entry block can be read on some path that never wrote it
+    IRCFG cfg = cfg_build(body);
+    IRVarInfos vars = ir_collect_var_info(function, symbols);
+    IRLiveness liveness = ir_compute_liveness(function, &cfg, &vars);
+    for (int v = 0; v < vars.length; v++) {
+        if (ir_verify_is_temp(vars.data[v].name) && cfg.length > 0 && ir_live_in(&liveness, 0, v)) {
+            fprintf(stderr, "%s: %s can be read before it's written\n", name, vars.data[v].name);
+            errors++;
+        }
+    }
+    ir_liveness_free(&liveness);
+    ir_var_infos_free(&vars);
+    cfg_free(&cfg);
+
+    return errors;
+}
+
+void ir_verify_program(IRProgram* program, TCSymbols* symbols, char* after) {
+    StringMap labels = string_map_new();
+    int errors = 0;
+    for (int i = 0; i < program->length; i++) {
+        if (program->data[i].ty == IRTFunction) {
+            errors += ir_verify_function(&program->data[i].val.function, symbols, &labels);
+        }
+    }
+    string_map_free(labels);
+
+    if (errors > 0) {
+        fprintf(stderr, "IR verification failed after %s\n", after);
+        exit(1);
+    }
+}
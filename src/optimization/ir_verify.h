@@ -0,0 +1,13 @@
+#ifndef IR_VERIFY_H
+#define IR_VERIFY_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// exits with a message naming `after` (the pass that just ran) if the program is malformed
+void ir_verify_program(IRProgram* program, TCSymbols* symbols, char* after);
+// returns the number of problems it printed
+int ir_verify_function(IRFunctionDefinition* function, TCSymbols* symbols, StringMap* labels);
+
+#endif
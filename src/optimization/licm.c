@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "licm.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// loop invariant code motion over natural loops
+//
+// an instruction gets moved into a preheader (a new block right before the header that only
+// the entries into the loop go through) when its operands can't change inside the loop,
+// it's the only def of its dst in the loop, and every use of the dst in the loop sees that def.
+// if the dst is used after the loop, or the op can trap (div/mod), the def also has to run
+// on every way out of the loop, otherwise a loop that runs 0 times would see the hoisted value.
+
+int licm_var_index(LICMContext* context, char* name) {
+    return string_map_get(&context->vars.indices, name);
+}
+
+int licm_is_exit_block(LICMContext* context, IRLoop* loop, int block) {
+    IRBlock* b = &context->cfg.data[block];
+    for (int s = 0; s < b->successors.length; s++) {
+        if (!loop->contains[b->successors.data[s]]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int licm_dominates_exits(LICMContext* context, IRLoop* loop, int block) {
+    for (int i = 0; i < loop->blocks.length; i++) {
+        int b = loop->blocks.data[i];
+        if (licm_is_exit_block(context, loop, b) && !cfg_dominates(&context->cfg, block, b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int licm_live_after_loop(LICMContext* context, IRLoop* loop, int var) {
+    for (int i = 0; i < loop->blocks.length; i++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[i]];
+        for (int s = 0; s < b->successors.length; s++) {
+            int succ = b->successors.data[s];
+            if (!loop->contains[succ] && ir_live_in(&context->liveness, succ, var)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int licm_is_invariant(LICMContext* context, IRVal val, int has_call) {
+    if (val.type == IRValType_Int) {
+        return true;
+    }
+
+    int var = licm_var_index(context, val.value.var);
+    if (context->loop_defs[var] == 0) {
+        // a call in the loop could change a static
+        return !(context->vars.data[var].is_static && has_call);
+    }
+    return context->loop_defs[var] == 1 && context->hoisted[context->loop_def_index[var]];
+}
+
+// every use of the var inside the loop has to come after the def
+int licm_uses_dominated(LICMContext* context, IRLoop* loop, char* name, int def) {
+    IRValRefs sources = {0};
+    int dominated = true;
+
+    for (int l = 0; l < loop->blocks.length && dominated; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end && dominated; i++) {
+            sources.length = 0;
+            ir_instruction_sources(&context->function->body.data[i], &sources);
+            for (int s = 0; s < sources.length; s++) {
+                if (ir_val_is_var(*sources.data[s], name) && !cfg_instruction_dominates(&context->cfg, def, i)) {
+                    dominated = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    vec_free(sources);
+    return dominated;
+}
+
+int licm_can_hoist(LICMContext* context, IRLoop* loop, int idx, int has_call) {
+    IRInstruction* instruction = &context->function->body.data[idx];
+
+    int may_trap = false;
+    switch (instruction->type) {
+        case IRInstructionType_Unary:
+            if (!licm_is_invariant(context, instruction->value.unary.src, has_call)) {
+                return false;
+            }
+            break;
+        case IRInstructionType_Binary: {
+            IRVal right = instruction->value.binary.right;
+            if (!licm_is_invariant(context, instruction->value.binary.left, has_call) ||
+                !licm_is_invariant(context, right, has_call)) {
+                return false;
+            }
+            IRBinaryOp op = instruction->value.binary.op;
+            may_trap = (op == IRBinaryOp_Divide || op == IRBinaryOp_Mod) &&
+                !(right.type == IRValType_Int && right.value.integer != 0);
+            break;
+        }
+        case IRInstructionType_Copy:
+            if (!licm_is_invariant(context, instruction->value.copy.src, has_call)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+
+    IRVal* dst = ir_instruction_dst(instruction);
+    int var = licm_var_index(context, dst->value.var);
+    if (context->vars.data[var].is_static || context->loop_defs[var] != 1) {
+        return false;
+    }
+
+    if (!licm_uses_dominated(context, loop, dst->value.var, idx)) {
+        return false;
+    }
+
+    if (may_trap || licm_live_after_loop(context, loop, var)) {
+        return licm_dominates_exits(context, loop, context->cfg.instruction_blocks[idx]);
+    }
+    return true;
+}
+
+int licm_loop(LICMContext* context, IRLoop* loop) {
+    IRFunctionBody* body = &context->function->body;
+    IRBlock* header = &context->cfg.data[loop->header];
+
+    if (!cfg_can_add_preheader(&context->cfg, body, loop)) {
+        return 0;
+    }
+    char* header_label = body->data[header->start].value.label;
+
+    memset(context->loop_defs, 0, context->vars.length * sizeof(int));
+    memset(context->hoisted, 0, body->length);
+    context->order.length = 0;
+
+    int has_call = false;
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            if (body->data[i].type == IRInstructionType_Call) {
+                has_call = true;
+            }
+            IRVal* dst = ir_instruction_dst(&body->data[i]);
+            if (dst != NULL && dst->type == IRValType_Var) {
+                int var = licm_var_index(context, dst->value.var);
+                context->loop_defs[var]++;
+                context->loop_def_index[var] = i;
+            }
+        }
+    }
+
+    int changed = true;
+    while (changed) {
+        changed = false;
+        for (int l = 0; l < loop->blocks.length; l++) {
+            IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+            for (int i = b->start; i < b->end; i++) {
+                if (!context->hoisted[i] && licm_can_hoist(context, loop, i, has_call)) {
+                    context->hoisted[i] = true;
+                    vec_push(context->order, i);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    if (context->order.length == 0) {
+        return 0;
+    }
+
+    char* preheader_label = ir_make_temp_name(context->generator);
+
+    IRFunctionBody new_body = {0};
+    for (int i = 0; i < body->length; i++) {
+        if (i == header->start) {
+            IRInstruction label = {
+                .type = IRInstructionType_Label,
+                .value = {.label = preheader_label},
+            };
+            vec_push(new_body, label);
+            for (int h = 0; h < context->order.length; h++) {
+                vec_push(new_body, body->data[context->order.data[h]]);
+            }
+        }
+
+        if (context->hoisted[i]) {
+            continue;
+        }
+
+        IRInstruction instruction = body->data[i];
+
+        // entries into the loop go through the preheader now
+        if (!loop->contains[context->cfg.instruction_blocks[i]]) {
+            ir_retarget_jump(&instruction, header_label, preheader_label);
+        }
+
+        vec_push(new_body, instruction);
+    }
+
+    int hoisted = context->order.length;
+    remark(RemarkKind_Passed, "licm", "Hoisted", context->function->identifier, "%d instructions hoisted out of the loop at %s",
+        hoisted, header_label);
+    vec_free(*body);
+    *body = new_body;
+
+    return hoisted;
+}
+
+int licm_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols) {
+    int total = 0;
+
+    // hoisting changes the blocks, so start over after every loop that changed
+    // (inner loops come first, so things can get hoisted through several levels)
+    int changed = true;
+    while (changed) {
+        changed = false;
+
+        LICMContext context = {
+            .function = function,
+            .generator = generator,
+            .cfg = cfg_build(&function->body),
+            .vars = ir_collect_var_info(function, symbols),
+            .order = {0},
+        };
+        cfg_compute_dominators(&context.cfg);
+        context.liveness = ir_compute_liveness(function, &context.cfg, &context.vars);
+        context.loop_defs = malloc_n_type(int, context.vars.length + 1);
+        context.loop_def_index = malloc_n_type(int, context.vars.length + 1);
+        context.hoisted = malloc_n_type(char, function->body.length + 1);
+
+        IRLoops loops = cfg_find_loops(&context.cfg);
+        for (int i = 0; i < loops.length; i++) {
+            int hoisted = licm_loop(&context, &loops.data[i]);
+            if (hoisted > 0) {
+                total += hoisted;
+                changed = true;
+                break;
+            }
+        }
+
+        cfg_loops_free(&loops);
+        cfg_free(&context.cfg);
+        ir_liveness_free(&context.liveness);
+        ir_var_infos_free(&context.vars);
+        free(context.loop_defs);
+        free(context.loop_def_index);
+        free(context.hoisted);
+        vec_free(context.order);
+    }
+
+    return total;
+}
+
+IRProgram licm_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, int* hoisted) {
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            *hoisted += licm_function(&program.data[i].val.function, generator, symbols);
+        }
+    }
+
+    return program;
+}
@@ -0,0 +1,23 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+typedef struct LICMContext {
+    IRFunctionDefinition* function;
+    IRGenerator* generator; // for preheader labels
+    IRCFG cfg;
+    IRVarInfos vars;
+    IRLiveness liveness;
+    int* loop_defs; // defs of every var inside the current loop
+    int* loop_def_index; // index of the last one
+    char* hoisted; // per instruction
+    IntVec order; // hoisted instructions, in the order they have to run
+} LICMContext;
+
+IRProgram licm_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, int* hoisted);
+int licm_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols);
+
+#endif
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "promote_statics.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// keeps statics in plain vars while a loop without calls runs
+//
+// every read of a static is a load from its DATA slot and every write a store, and regalloc
+// never gets to keep one in a register. nothing but the loop itself can touch a static while a
+// loop with no calls in it runs, so the statics it uses get loaded into new vars in a preheader,
+// the loop works on those, and the ones it writes get stored back on every way out: before a
+// return, right where it falls out of the loop, and in a pad that a jump out of the loop goes through.
+
+int promote_var_index(PromoteContext* context, char* name) {
+    return string_map_get(&context->vars.indices, name);
+}
+
+// the var a promoted static lives in, NULL for anything else
+char* promote_replacement(PromoteContext* context, IRVal val) {
+    if (val.type != IRValType_Var) {
+        return NULL;
+    }
+    int var = promote_var_index(context, val.value.var);
+    if (var == -1 || context->promoted[var] == -1) {
+        return NULL;
+    }
+    return context->names.data[context->promoted[var]];
+}
+
+void promote_push_copy(IRFunctionBody* body, char* src, char* dst) {
+    IRInstruction copy = {
+        .type = IRInstructionType_Copy,
+        .value = {.copy = {
+            .src = {.type = IRValType_Var, .value.var = src},
+            .dst = {.type = IRValType_Var, .value.var = dst},
+        }},
+    };
+    vec_push(*body, copy);
+}
+
+void promote_push_stores(PromoteContext* context, IRFunctionBody* body) {
+    for (int v = 0; v < context->vars.length; v++) {
+        if (context->promoted[v] != -1 && context->written[v]) {
+            promote_push_copy(body, context->names.data[context->promoted[v]], context->vars.data[v].name);
+        }
+    }
+}
+
+int promote_falls_through(IRFunctionBody* body, IRBlock* block) {
+    IRInstructionType last = body->data[block->end - 1].type;
+    return block->end < body->length && last != IRInstructionType_Jump && last != IRInstructionType_JumpTable &&
+        last != IRInstructionType_Return;
+}
+
+// jumps out of the loop go through a pad that stores the statics first, one pad per target
+void promote_add_pad(PromoteContext* context, IRLoop* loop, char* target) {
+    int block = string_map_get(&context->label_blocks, target);
+    if (block == -1 || loop->contains[block] || string_map_get(&context->pads, target) != -1) {
+        return;
+    }
+    string_map_set(&context->pads, target, context->pad_targets.length);
+    vec_push(context->pad_targets, target);
+}
+
+void promote_find_pads(PromoteContext* context, IRLoop* loop, IRInstruction* instruction) {
+    switch (instruction->type) {
+        case IRInstructionType_Jump:
+            promote_add_pad(context, loop, instruction->value.label);
+            break;
+        case IRInstructionType_JumpIfZero:
+        case IRInstructionType_JumpIfNotZero:
+            promote_add_pad(context, loop, instruction->value.jump_cond.label);
+            break;
+        case IRInstructionType_JumpTable:
+            for (int l = 0; l < instruction->value.jump_table.labels.length; l++) {
+                promote_add_pad(context, loop, instruction->value.jump_table.labels.data[l]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+int promote_loop(PromoteContext* context, IRLoop* loop) {
+    IRFunctionBody* body = &context->function->body;
+    IRBlock* header = &context->cfg.data[loop->header];
+    char* function_name = context->function->identifier;
+
+    for (int v = 0; v < context->vars.length; v++) {
+        context->promoted[v] = -1;
+        context->written[v] = false;
+    }
+    context->names.length = 0;
+
+    int has_call = false;
+    int written = 0;
+    IRValRefs sources = {0};
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            if (body->data[i].type == IRInstructionType_Call) {
+                has_call = true;
+            }
+
+            sources.length = 0;
+            ir_instruction_sources(&body->data[i], &sources);
+            IRVal* dst = ir_instruction_dst(&body->data[i]);
+            if (dst != NULL) {
+                vec_push(sources, dst);
+            }
+
+            for (int s = 0; s < sources.length; s++) {
+                if (sources.data[s]->type != IRValType_Var) {
+                    continue;
+                }
+                int var = promote_var_index(context, sources.data[s]->value.var);
+                if (!context->vars.data[var].is_static) {
+                    continue;
+                }
+                if (context->promoted[var] == -1) {
+                    context->promoted[var] = context->names.length;
+                    vec_push(context->names, NULL); // named once the loop turns out to be worth it
+                }
+                if (sources.data[s] == dst && !context->written[var]) {
+                    context->written[var] = true;
+                    written++;
+                }
+            }
+        }
+    }
+    vec_free(sources);
+
+    if (context->names.length == 0) {
+        return 0;
+    }
+    char* header_label = body->data[header->start].value.label;
+    if (has_call) {
+        if (string_map_get(context->missed, header_label) != -1) {
+            return 0;
+        }
+        string_map_set(context->missed, header_label, 1);
+        remark(RemarkKind_Missed, "promote-statics", "HasCall", function_name,
+            "%d statics left in memory in the loop at %s, it makes calls", context->names.length, header_label);
+        return 0;
+    }
+    if (!cfg_can_add_preheader(&context->cfg, body, loop)) {
+        return 0;
+    }
+
+    // every way out of the loop needs the written statics stored back
+    string_map_free(context->pads);
+    context->pads = string_map_new();
+    context->pad_labels.length = 0;
+    context->pad_targets.length = 0;
+    char* fall_exits = calloc(body->length + 1, sizeof(char));
+    int exits = 0;
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            if (body->data[i].type == IRInstructionType_Return) {
+                exits++;
+            }
+        }
+        if (written > 0) {
+            promote_find_pads(context, loop, &body->data[b->end - 1]);
+        }
+        if (promote_falls_through(body, b) && !loop->contains[context->cfg.instruction_blocks[b->end]] &&
+            !fall_exits[b->end]) {
+            fall_exits[b->end] = true;
+            exits++;
+        }
+    }
+    exits += context->pad_targets.length;
+
+    // pads go after the last instruction, which must not fall into them
+    IRInstructionType last = body->data[body->length - 1].type;
+    int can_pad = context->pad_targets.length == 0 || last == IRInstructionType_Return ||
+        last == IRInstructionType_Jump;
+
+    if (!can_pad || written * exits > PROMOTE_MAX_STORES) {
+        if (can_pad && string_map_get(context->missed, header_label) == -1) {
+            string_map_set(context->missed, header_label, 1);
+            remark(RemarkKind_Missed, "promote-statics", "TooManyExits", function_name,
+                "statics left in memory in the loop at %s, storing them back would take %d copies (max %d)",
+                header_label, written * exits, PROMOTE_MAX_STORES);
+        }
+        free(fall_exits);
+        return 0;
+    }
+
+    for (int n = 0; n < context->names.length; n++) {
+        context->names.data[n] = ir_make_temp_name(context->generator);
+    }
+    for (int p = 0; p < context->pad_targets.length; p++) {
+        vec_push(context->pad_labels, ir_make_temp_name(context->generator));
+    }
+    char* preheader_label = ir_make_temp_name(context->generator);
+
+    IRFunctionBody new_body = {0};
+    for (int i = 0; i < body->length; i++) {
+        if (i == header->start) {
+            ir_push_label(preheader_label, &new_body);
+            for (int v = 0; v < context->vars.length; v++) {
+                if (context->promoted[v] != -1) {
+                    promote_push_copy(&new_body, context->vars.data[v].name, context->names.data[context->promoted[v]]);
+                }
+            }
+        }
+        if (written > 0 && fall_exits[i]) {
+            promote_push_stores(context, &new_body);
+        }
+
+        IRInstruction instruction = body->data[i];
+
+        if (!loop->contains[context->cfg.instruction_blocks[i]]) {
+            // entries into the loop go through the preheader now
+            ir_retarget_jump(&instruction, header_label, preheader_label);
+            vec_push(new_body, instruction);
+            continue;
+        }
+
+        IRValRefs refs = {0};
+        ir_instruction_sources(&instruction, &refs);
+        IRVal* dst = ir_instruction_dst(&instruction);
+        if (dst != NULL) {
+            vec_push(refs, dst);
+        }
+        for (int s = 0; s < refs.length; s++) {
+            char* name = promote_replacement(context, *refs.data[s]);
+            if (name != NULL) {
+                refs.data[s]->value.var = name;
+            }
+        }
+        vec_free(refs);
+
+        for (int p = 0; p < context->pad_targets.length; p++) {
+            ir_retarget_jump(&instruction, context->pad_targets.data[p], context->pad_labels.data[p]);
+        }
+        if (instruction.type == IRInstructionType_Return && written > 0) {
+            promote_push_stores(context, &new_body);
+        }
+        vec_push(new_body, instruction);
+    }
+
+    for (int p = 0; p < context->pad_targets.length; p++) {
+        ir_push_label(context->pad_labels.data[p], &new_body);
+        promote_push_stores(context, &new_body);
+        ir_push_jump(IRInstructionType_Jump, (IRVal){0}, context->pad_targets.data[p], &new_body);
+    }
+
+    remark(RemarkKind_Passed, "promote-statics", "Promoted", function_name,
+        "%d statics kept in vars through the loop at %s, %d of them stored back on %d ways out",
+        context->names.length, header_label, written, exits);
+    free(fall_exits);
+    vec_free(*body);
+    *body = new_body;
+
+    return context->names.length;
+}
+
+void promote_statics_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols,
+    PromoteStats* stats) {
+    // the blocks change with every promoted loop, so start over each time. outer loops go first,
+    // that way a loop nest without calls only loads and stores around the outermost loop
+    StringMap missed = string_map_new();
+    int changed = true;
+    while (changed) {
+        changed = false;
+
+        PromoteContext context = {
+            .function = function,
+            .generator = generator,
+            .cfg = cfg_build(&function->body),
+            .vars = ir_collect_var_info(function, symbols),
+            .label_blocks = string_map_new(),
+            .pads = string_map_new(),
+            .missed = &missed,
+        };
+        cfg_compute_dominators(&context.cfg);
+        context.promoted = malloc_n_type(int, context.vars.length + 1);
+        context.written = malloc_n_type(int, context.vars.length + 1);
+        for (int i = 0; i < function->body.length; i++) {
+            if (function->body.data[i].type == IRInstructionType_Label) {
+                string_map_set(&context.label_blocks, function->body.data[i].value.label,
+                    context.cfg.instruction_blocks[i]);
+            }
+        }
+
+        IRLoops loops = cfg_find_loops(&context.cfg);
+        for (int i = loops.length - 1; i >= 0; i--) {
+            int promoted = promote_loop(&context, &loops.data[i]);
+            if (promoted > 0) {
+                stats->loops++;
+                stats->statics += promoted;
+                changed = true;
+                break;
+            }
+        }
+
+        cfg_loops_free(&loops);
+        cfg_free(&context.cfg);
+        ir_var_infos_free(&context.vars);
+        string_map_free(context.label_blocks);
+        string_map_free(context.pads);
+        free(context.promoted);
+        free(context.written);
+        vec_free(context.names);
+        vec_free(context.pad_labels);
+        vec_free(context.pad_targets);
+    }
+    string_map_free(missed);
+}
+
+IRProgram promote_statics_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, PromoteStats* stats) {
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            promote_statics_function(&program.data[i].val.function, generator, symbols, stats);
+        }
+    }
+
+    return program;
+}
@@ -0,0 +1,34 @@
+#ifndef PROMOTE_STATICS_H
+#define PROMOTE_STATICS_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// a loop isn't worth it when writing its statics back would take more than this many copies
+#define PROMOTE_MAX_STORES 16
+
+typedef struct PromoteContext {
+    IRFunctionDefinition* function;
+    IRGenerator* generator; // for the vars and the labels of the preheader and exit pads
+    IRCFG cfg;
+    IRVarInfos vars;
+    StringMap label_blocks; // label -> the block it starts
+    int* promoted; // per var, index into names, -1 if it stays a static
+    int* written; // per var, whether the loop assigns it
+    VEC(char*) names; // the var each promoted static lives in during the loop
+    StringMap pads; // exit target -> index in pad_labels, so each way out gets one pad
+    VEC(char*) pad_labels;
+    VEC(char*) pad_targets;
+    StringMap* missed; // headers of loops already reported as missed, the restarts see them again
+} PromoteContext;
+
+typedef struct PromoteStats {
+    int loops;
+    int statics;
+} PromoteStats;
+
+IRProgram promote_statics_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols, PromoteStats* stats);
+void promote_statics_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols, PromoteStats* stats);
+
+#endif
@@ -0,0 +1,663 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strength_reduction.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// strength reduction
+//
+// mul, div and mod are the slow instructions on the emulated target. inside a loop, an induction var
+// is a var whose only update is `i = i + step`, and a derived induction var is anything that is always
+// factor * i + offset (`j = i * 6 + 3`, through however many temps). each derived one becomes a
+// running sum: the sum starts as factor * i + offset in a preheader and goes up by step * factor right
+// after every update of i, so computing it in the loop turns into a copy. when the loop counter itself
+// is then only used by its exit test, the test moves over to one of the sums and the counter goes away.
+// after that, multiplies, divides and mods by a power of two become shifts and masks. the target's
+// div, mod and shr are all unsigned, so x / 2^k is exactly x >> k and x % 2^k is x & (2^k - 1), and
+// no sign fixup is needed to keep the results the same. other constants stay a mul: splitting
+// them into shifts and adds takes more instructions than the mul does.
+
+// the target only has 16 bit words, so that's where everything wraps
+int sr_wrap(long value) {
+    return (int)(((value + 32768) & 0xffff) - 32768);
+}
+
+// k for 2^k, -1 for anything else
+int sr_log2(int value) {
+    if (value <= 0 || value > 0x4000) {
+        return -1;
+    }
+    int k = 0;
+    while ((1 << k) < value) {
+        k++;
+    }
+    return (1 << k) == value ? k : -1;
+}
+
+int sr_val_log2(IRVal val) {
+    return val.type == IRValType_Int ? sr_log2(val.value.integer) : -1;
+}
+
+IRVal sr_int(int value) {
+    return (IRVal){.type = IRValType_Int, .value.integer = value};
+}
+
+IRVal sr_var_val(char* name) {
+    return (IRVal){.type = IRValType_Var, .value.var = name};
+}
+
+int sr_var(SRContext* context, IRVal val) {
+    if (val.type != IRValType_Var) {
+        return -1;
+    }
+    return string_map_get(&context->vars.indices, val.value.var);
+}
+
+// -1 when the instruction doesn't write a var
+int sr_dst_var(SRContext* context, IRInstruction* instruction) {
+    IRVal* dst = ir_instruction_dst(instruction);
+    return dst == NULL ? -1 : sr_var(context, *dst);
+}
+
+int sr_find_induction_var(SRContext* context, int var) {
+    for (int v = 0; v < context->induction_vars.length; v++) {
+        if (context->induction_vars.data[v].var == var) {
+            return v;
+        }
+    }
+    return -1;
+}
+
+void sr_find_induction_vars(SRContext* context, IRLoop* loop) {
+    IRFunctionBody* body = &context->function->body;
+    memset(context->loop_defs, 0, context->vars.length * sizeof(int));
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            int var = sr_dst_var(context, &body->data[i]);
+            if (var >= 0) {
+                context->loop_defs[var]++;
+                context->loop_def_index[var] = i;
+            }
+        }
+    }
+
+    for (int v = 0; v < context->vars.length; v++) {
+        if (context->loop_defs[v] != 1 || context->vars.data[v].is_static) {
+            continue;
+        }
+
+        int def = context->loop_def_index[v];
+        int step_def = def;
+        // `i = i - 3` comes out of ir generation as `t = i - 3` then `i = t`
+        IRInstruction* instruction = &body->data[def];
+        if (instruction->type == IRInstructionType_Copy) {
+            int src = sr_var(context, instruction->value.copy.src);
+            if (src >= 0 && context->loop_defs[src] == 1) {
+                step_def = context->loop_def_index[src];
+            }
+        }
+        int step;
+        if (!ir_match_step(&body->data[step_def], context->vars.data[v].name, &step) || step == 0) {
+            continue;
+        }
+        SRInductionVar iv = {.var = v, .def = def, .step_def = step_def, .step = step};
+        vec_push(context->induction_vars, iv);
+    }
+}
+
+// what `val` is when `use` reads it, if that's linear in an induction var.
+// a derived var only counts when its def is earlier in the same block with no update of its iv in between,
+// so it still matches the current value of the iv
+int sr_operand(SRContext* context, IRVal val, int use, SRLinear* linear) {
+    int var = sr_var(context, val);
+    if (var < 0) {
+        return false;
+    }
+
+    int iv = sr_find_induction_var(context, var);
+    if (iv >= 0) {
+        *linear = (SRLinear){.iv = iv, .factor = 1, .offset = 0};
+        return true;
+    }
+
+    if (context->loop_defs[var] != 1) {
+        return false;
+    }
+    int def = context->loop_def_index[var];
+    if (def >= use || context->derived[def].iv < 0 ||
+        context->cfg.instruction_blocks[def] != context->cfg.instruction_blocks[use]) {
+        return false;
+    }
+    int update = context->induction_vars.data[context->derived[def].iv].def;
+    if (update > def && update < use) {
+        return false;
+    }
+
+    *linear = context->derived[def];
+    return true;
+}
+
+int sr_derive(SRContext* context, int index, SRLinear* linear) {
+    IRInstruction* instruction = &context->function->body.data[index];
+    switch (instruction->type) {
+        case IRInstructionType_Copy:
+            return sr_operand(context, instruction->value.copy.src, index, linear);
+        case IRInstructionType_Unary:
+            if (instruction->value.unary.op != IRUnaryOp_Negate ||
+                !sr_operand(context, instruction->value.unary.src, index, linear)) {
+                return false;
+            }
+            linear->factor = sr_wrap(-(long)linear->factor);
+            linear->offset = sr_wrap(-(long)linear->offset);
+            return true;
+        case IRInstructionType_Binary:
+            break;
+        default:
+            return false;
+    }
+
+    IRVal left = instruction->value.binary.left;
+    IRVal right = instruction->value.binary.right;
+    SRLinear l, r;
+    int left_linear = sr_operand(context, left, index, &l);
+    int right_linear = sr_operand(context, right, index, &r);
+    // a constant is a linear value with no factor
+    if (!left_linear && left.type == IRValType_Int && right_linear) {
+        l = (SRLinear){.iv = r.iv, .factor = 0, .offset = left.value.integer};
+    } else if (!right_linear && right.type == IRValType_Int && left_linear) {
+        r = (SRLinear){.iv = l.iv, .factor = 0, .offset = right.value.integer};
+    } else if (!left_linear || !right_linear || l.iv != r.iv) {
+        return false;
+    }
+
+    *linear = (SRLinear){.iv = l.iv};
+    switch (instruction->value.binary.op) {
+        case IRBinaryOp_Add:
+            linear->factor = sr_wrap((long)l.factor + r.factor);
+            linear->offset = sr_wrap((long)l.offset + r.offset);
+            return true;
+        case IRBinaryOp_Subtract:
+            linear->factor = sr_wrap((long)l.factor - r.factor);
+            linear->offset = sr_wrap((long)l.offset - r.offset);
+            return true;
+        case IRBinaryOp_Multiply:
+            // one side has to be the constant
+            if (l.factor != 0 && r.factor != 0) {
+                return false;
+            }
+            linear->factor = sr_wrap((long)l.factor * r.offset + (long)r.factor * l.offset);
+            linear->offset = sr_wrap((long)l.offset * r.offset);
+            return true;
+        case IRBinaryOp_LeftShift:
+            if (right.type != IRValType_Int || right.value.integer < 0 || right.value.integer > 15) {
+                return false;
+            }
+            linear->factor = sr_wrap((long)l.factor << right.value.integer);
+            linear->offset = sr_wrap((long)l.offset << right.value.integer);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// not worth a running sum: without a real multiply it's as cheap as the update of the sum would be
+int sr_is_trivial(SRLinear linear) {
+    return linear.factor == 0 || linear.factor == 1 || linear.factor == -1 || sr_log2(linear.factor) >= 0;
+}
+
+int sr_running_sum(SRContext* context, SRLinear value) {
+    for (int s = 0; s < context->sums.length; s++) {
+        SRLinear other = context->sums.data[s].value;
+        if (other.iv == value.iv && other.factor == value.factor && other.offset == value.offset) {
+            return s;
+        }
+    }
+
+    SRRunningSum sum = {.value = value, .sum = ir_make_temp_name(context->generator)};
+    vec_push(context->sums, sum);
+    return context->sums.length - 1;
+}
+
+void sr_count_sources(SRContext* context, IRInstruction* instruction, int delta) {
+    IRValRefs sources = {0};
+    ir_instruction_sources(instruction, &sources);
+    for (int s = 0; s < sources.length; s++) {
+        int var = sr_var(context, *sources.data[s]);
+        if (var >= 0) {
+            context->real_uses[var] += delta;
+        }
+    }
+    vec_free(sources);
+}
+
+int sr_live_after_loop(SRContext* context, IRLoop* loop, int var) {
+    for (int i = 0; i < loop->blocks.length; i++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[i]];
+        for (int s = 0; s < b->successors.length; s++) {
+            int succ = b->successors.data[s];
+            if (!loop->contains[succ] && ir_live_in(&context->liveness, succ, var)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// the constant the var starts the loop with, if it only has the one def outside the loop
+int sr_initial_value(SRContext* context, IRLoop* loop, int var, int* value) {
+    IRFunctionBody* body = &context->function->body;
+    if (context->vars.data[var].defs != context->loop_defs[var] + 1) {
+        return false;
+    }
+    for (int i = 0; i < body->length; i++) {
+        IRInstruction* instruction = &body->data[i];
+        if (sr_dst_var(context, instruction) != var || loop->contains[context->cfg.instruction_blocks[i]]) {
+            continue;
+        }
+        if (instruction->type != IRInstructionType_Copy || instruction->value.copy.src.type != IRValType_Int) {
+            return false;
+        }
+        *value = instruction->value.copy.src.value.integer;
+        return true;
+    }
+    return false;
+}
+
+int sr_in_word(long value) {
+    return value >= 0 && value <= 32767;
+}
+
+// when the only things left reading the counter are its own update and the exit test, the test can compare
+// a running sum instead. that needs factor > 0 and everything staying in [0, 32767],
+// where the signed and the unsigned compares agree and factor * i + offset keeps the order
+int sr_eliminate_counter(SRContext* context, IRLoop* loop, int iv_index) {
+    IRFunctionBody* body = &context->function->body;
+    SRInductionVar* iv = &context->induction_vars.data[iv_index];
+    int var = iv->var;
+
+    // the counter gets checked once after every update, so it can't run far past the bound
+    int latch_block = context->cfg.instruction_blocks[iv->def];
+    if (loop->latches.length != 1 || loop->latches.data[0] != latch_block ||
+        context->cfg.instruction_blocks[iv->step_def] != latch_block || sr_live_after_loop(context, loop, var)) {
+        return false;
+    }
+    if (iv->step_def != iv->def && context->vars.data[sr_dst_var(context, &body->data[iv->step_def])].uses != 1) {
+        return false;
+    }
+    int initial;
+    if (!sr_initial_value(context, loop, var, &initial)) {
+        return false;
+    }
+
+    int compare = -1;
+    IntVec dead = {0};
+    IRValRefs sources = {0};
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            IRInstruction* instruction = &body->data[i];
+            if (i == iv->def || i == iv->step_def || context->actions[i] != SRAction_Keep) {
+                continue;
+            }
+            sources.length = 0;
+            ir_instruction_sources(instruction, &sources);
+            int reads = false;
+            for (int s = 0; s < sources.length; s++) {
+                reads |= sr_var(context, *sources.data[s]) == var;
+            }
+            if (!reads) {
+                continue;
+            }
+
+            // like the `t = i` that `i++` leaves behind
+            int dst = sr_dst_var(context, instruction);
+            if (instruction->type != IRInstructionType_Call && dst >= 0 && context->vars.data[dst].uses == 0 &&
+                !context->vars.data[dst].is_static) {
+                vec_push(dead, i);
+                continue;
+            }
+            if (instruction->type != IRInstructionType_Binary || instruction->value.binary.op < IRBinaryOp_Less ||
+                compare != -1 || context->cfg.instruction_blocks[i] != latch_block) {
+                compare = -2;
+                continue;
+            }
+            compare = i;
+        }
+    }
+    vec_free(sources);
+    if (compare < 0) {
+        vec_free(dead);
+        return false;
+    }
+
+    // the counter has to head towards the bound
+    IRInstruction* test = &body->data[compare];
+    int counter_left = ir_val_is_var(test->value.binary.left, context->vars.data[var].name);
+    IRVal bound_val = counter_left ? test->value.binary.right : test->value.binary.left;
+    IRBinaryOp op = test->value.binary.op;
+    int up = op == (counter_left ? IRBinaryOp_Less : IRBinaryOp_Greater) ||
+        op == (counter_left ? IRBinaryOp_LessEqual : IRBinaryOp_GreaterEqual);
+    int down = op == (counter_left ? IRBinaryOp_Greater : IRBinaryOp_Less) ||
+        op == (counter_left ? IRBinaryOp_GreaterEqual : IRBinaryOp_LessEqual);
+    if (bound_val.type != IRValType_Int || !(iv->step > 0 ? up : down)) {
+        vec_free(dead);
+        return false;
+    }
+
+    int sum = -1;
+    for (int s = 0; s < context->sums.length; s++) {
+        if (context->sums.data[s].value.iv == iv_index && context->sums.data[s].value.factor > 0) {
+            sum = s;
+            break;
+        }
+    }
+    if (sum < 0) {
+        vec_free(dead);
+        return false;
+    }
+
+    SRLinear linear = context->sums.data[sum].value;
+    int bound = bound_val.value.integer;
+    // the counter goes from where it starts to at most one step past the bound
+    long lo = initial;
+    long hi = (initial > bound ? initial : bound) + iv->step;
+    if (iv->step < 0) {
+        lo = (initial < bound ? initial : bound) + iv->step;
+        hi = initial;
+    }
+    if (!sr_in_word(lo) || !sr_in_word(hi) || !sr_in_word(linear.factor * lo + linear.offset) ||
+        !sr_in_word(linear.factor * hi + linear.offset)) {
+        vec_free(dead);
+        return false;
+    }
+
+    IRVal new_bound = sr_int(linear.factor * bound + linear.offset);
+    IRVal new_counter = sr_var_val(context->sums.data[sum].sum);
+    test->value.binary.left = counter_left ? new_counter : new_bound;
+    test->value.binary.right = counter_left ? new_bound : new_counter;
+
+    context->actions[iv->def] = SRAction_Delete;
+    context->actions[iv->step_def] = SRAction_Delete;
+    for (int d = 0; d < dead.length; d++) {
+        context->actions[dead.data[d]] = SRAction_Delete;
+    }
+    vec_free(dead);
+    return true;
+}
+
+void sr_push_sum_start(SRContext* context, SRRunningSum* sum, IRFunctionBody* body) {
+    IRVal iv = sr_var_val(context->vars.data[context->induction_vars.data[sum->value.iv].var].name);
+    IRVal dst = sr_var_val(sum->sum);
+    IRInstruction start = {.type = IRInstructionType_Copy, .value.copy = {.src = iv, .dst = dst}};
+    if (sum->value.factor != 1) {
+        start = (IRInstruction){
+            .type = IRInstructionType_Binary,
+            .value.binary = {.op = IRBinaryOp_Multiply, .left = iv, .right = sr_int(sum->value.factor), .dst = dst},
+        };
+    }
+    vecptr_push(body, start);
+
+    if (sum->value.offset != 0) {
+        IRInstruction offset = {
+            .type = IRInstructionType_Binary,
+            .value.binary = {.op = IRBinaryOp_Add, .left = dst, .right = sr_int(sum->value.offset), .dst = dst},
+        };
+        vecptr_push(body, offset);
+    }
+}
+
+int sr_loop(SRContext* context, IRLoop* loop, SRStats* stats) {
+    IRFunctionBody* body = &context->function->body;
+    if (!cfg_can_add_preheader(&context->cfg, body, loop)) {
+        return 0;
+    }
+
+    context->induction_vars.length = 0;
+    context->sums.length = 0;
+    sr_find_induction_vars(context, loop);
+    if (context->induction_vars.length == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < body->length; i++) {
+        context->derived[i].iv = -1;
+        context->actions[i] = SRAction_Keep;
+        context->reduced[i] = -1;
+    }
+    for (int v = 0; v < context->vars.length; v++) {
+        context->real_uses[v] = context->vars.data[v].uses;
+    }
+
+    // operands of a derived var are earlier in the same block, so going in order finds them first
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int i = b->start; i < b->end; i++) {
+            int var = sr_dst_var(context, &body->data[i]);
+            if (var < 0 || context->loop_defs[var] != 1 || context->vars.data[var].is_static ||
+                sr_find_induction_var(context, var) >= 0 || !sr_derive(context, i, &context->derived[i])) {
+                context->derived[i].iv = -1;
+                continue;
+            }
+            sr_count_sources(context, &body->data[i], -1);
+        }
+    }
+
+    // backwards, so everything reading a derived var has decided whether it still really does
+    int reduced = 0;
+    for (int i = body->length - 1; i >= 0; i--) {
+        if (context->derived[i].iv < 0) {
+            continue;
+        }
+        if (context->real_uses[sr_dst_var(context, &body->data[i])] <= 0) {
+            context->actions[i] = SRAction_Delete;
+        } else if (sr_is_trivial(context->derived[i])) {
+            sr_count_sources(context, &body->data[i], 1);
+        } else {
+            context->actions[i] = SRAction_Reduce;
+            context->reduced[i] = sr_running_sum(context, context->derived[i]);
+            reduced++;
+        }
+    }
+    if (reduced == 0) {
+        return 0;
+    }
+
+    for (int v = 0; v < context->induction_vars.length; v++) {
+        stats->counters += sr_eliminate_counter(context, loop, v);
+    }
+    stats->derived += reduced;
+
+    IRBlock* header = &context->cfg.data[loop->header];
+    char* header_label = body->data[header->start].value.label;
+    char* preheader_label = ir_make_temp_name(context->generator);
+
+    IRFunctionBody new_body = {0};
+    for (int i = 0; i < body->length; i++) {
+        if (i == header->start) {
+            ir_push_label(preheader_label, &new_body);
+            for (int s = 0; s < context->sums.length; s++) {
+                sr_push_sum_start(context, &context->sums.data[s], &new_body);
+            }
+        }
+
+        IRInstruction instruction = body->data[i];
+        if (context->actions[i] == SRAction_Reduce) {
+            IRVal dst = *ir_instruction_dst(&body->data[i]);
+            IRVal sum = sr_var_val(context->sums.data[context->reduced[i]].sum);
+            instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {.src = sum, .dst = dst}};
+        }
+        if (!loop->contains[context->cfg.instruction_blocks[i]]) {
+            ir_retarget_jump(&instruction, header_label, preheader_label);
+        }
+        if (context->actions[i] != SRAction_Delete) {
+            vec_push(new_body, instruction);
+        }
+
+        // the sums follow their iv even when the iv's own update is gone
+        for (int s = 0; s < context->sums.length; s++) {
+            SRRunningSum* sum = &context->sums.data[s];
+            SRInductionVar* iv = &context->induction_vars.data[sum->value.iv];
+            if (iv->def != i) {
+                continue;
+            }
+            IRVal sum_val = sr_var_val(sum->sum);
+            IRInstruction update = {
+                .type = IRInstructionType_Binary,
+                .value.binary = {
+                    .op = IRBinaryOp_Add,
+                    .left = sum_val,
+                    .right = sr_int(sr_wrap((long)iv->step * sum->value.factor)),
+                    .dst = sum_val,
+                },
+            };
+            vec_push(new_body, update);
+        }
+    }
+
+    vec_free(*body);
+    *body = new_body;
+    return reduced;
+}
+
+int sr_constant_ops(IRFunctionDefinition* function) {
+    int changed = 0;
+    for (int i = 0; i < function->body.length; i++) {
+        IRInstruction* instruction = &function->body.data[i];
+        if (instruction->type != IRInstructionType_Binary) {
+            continue;
+        }
+
+        IRVal left = instruction->value.binary.left;
+        IRVal right = instruction->value.binary.right;
+        IRVal dst = instruction->value.binary.dst;
+        // both constant is instruction selection's job
+        if (left.type == IRValType_Int && right.type == IRValType_Int) {
+            continue;
+        }
+
+        switch (instruction->value.binary.op) {
+            case IRBinaryOp_Multiply: {
+                IRVal var = left;
+                IRVal factor = right;
+                if (factor.type != IRValType_Int) {
+                    var = right;
+                    factor = left;
+                }
+                int k = sr_val_log2(factor);
+                if (factor.type == IRValType_Int && factor.value.integer == 0) {
+                    *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {.src = sr_int(0), .dst = dst}};
+                } else if (k == 0) {
+                    *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {.src = var, .dst = dst}};
+                } else if (k > 0) {
+                    instruction->value.binary.op = IRBinaryOp_LeftShift;
+                    instruction->value.binary.left = var;
+                    instruction->value.binary.right = sr_int(k);
+                } else {
+                    continue;
+                }
+                break;
+            }
+            case IRBinaryOp_Divide: {
+                int k = sr_val_log2(right);
+                if (k == 0) {
+                    *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {.src = left, .dst = dst}};
+                } else if (k > 0) {
+                    instruction->value.binary.op = IRBinaryOp_RightShift;
+                    instruction->value.binary.right = sr_int(k);
+                } else {
+                    continue;
+                }
+                break;
+            }
+            case IRBinaryOp_Mod: {
+                int k = sr_val_log2(right);
+                if (k == 0) {
+                    *instruction = (IRInstruction){.type = IRInstructionType_Copy, .value.copy = {.src = sr_int(0), .dst = dst}};
+                } else if (k > 0) {
+                    instruction->value.binary.op = IRBinaryOp_BitwiseAnd;
+                    instruction->value.binary.right = sr_int((1 << k) - 1);
+                } else {
+                    continue;
+                }
+                break;
+            }
+            default:
+                continue;
+        }
+        changed++;
+    }
+
+    return changed;
+}
+
+void strength_reduction_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols, SRStats* stats) {
+    // every loop that changed moves instructions around, so start over after each one
+    int changed = true;
+    while (changed) {
+        changed = false;
+
+        SRContext context = {
+            .function = function,
+            .generator = generator,
+            .symbols = symbols,
+            .cfg = cfg_build(&function->body),
+            .vars = ir_collect_var_info(function, symbols),
+            .induction_vars = {0},
+            .sums = {0},
+        };
+        cfg_compute_dominators(&context.cfg);
+        context.liveness = ir_compute_liveness(function, &context.cfg, &context.vars);
+        context.loop_defs = malloc_n_type(int, context.vars.length + 1);
+        context.loop_def_index = malloc_n_type(int, context.vars.length + 1);
+        context.real_uses = malloc_n_type(int, context.vars.length + 1);
+        context.derived = malloc_n_type(SRLinear, function->body.length + 1);
+        context.actions = malloc_n_type(SRAction, function->body.length + 1);
+        context.reduced = malloc_n_type(int, function->body.length + 1);
+
+        IRLoops loops = cfg_find_loops(&context.cfg);
+        for (int i = 0; i < loops.length; i++) {
+            if (sr_loop(&context, &loops.data[i], stats) > 0) {
+                changed = true;
+                break;
+            }
+        }
+
+        cfg_loops_free(&loops);
+        cfg_free(&context.cfg);
+        ir_liveness_free(&context.liveness);
+        ir_var_infos_free(&context.vars);
+        free(context.loop_defs);
+        free(context.loop_def_index);
+        free(context.real_uses);
+        free(context.derived);
+        free(context.actions);
+        free(context.reduced);
+        vec_free(context.induction_vars);
+        vec_free(context.sums);
+    }
+
+    stats->constant_ops += sr_constant_ops(function);
+}
+
+IRProgram strength_reduction_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols) {
+    SRStats stats = {0};
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            IRFunctionDefinition* function = &program.data[i].val.function;
+            SRStats before = stats;
+            strength_reduction_function(function, generator, symbols, &stats);
+            if (stats.constant_ops + stats.derived + stats.counters > before.constant_ops + before.derived + before.counters) {
+                remark(RemarkKind_Passed, "strength-reduction", "Reduced", function->identifier,
+                    "%d constant ops, %d derived induction vars reduced, %d loop counters removed",
+                    stats.constant_ops - before.constant_ops, stats.derived - before.derived, stats.counters - before.counters);
+            }
+        }
+    }
+
+    remark_stats("strength reduced %d constant ops, %d derived induction vars, removed %d loop counters\n", stats.constant_ops,
+        stats.derived, stats.counters);
+    return program;
+}
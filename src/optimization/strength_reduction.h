@@ -0,0 +1,61 @@
+#ifndef STRENGTH_REDUCTION_H
+#define STRENGTH_REDUCTION_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// a var whose only def in the loop is `var = var + step`
+typedef struct SRInductionVar {
+    int var; // in the context's vars
+    int def; // instruction index of that def
+    int step_def; // where the new value gets computed, the def itself or the def of a temp copied into var
+    int step;
+} SRInductionVar;
+
+// factor * iv + offset, for one of the induction vars
+typedef struct SRLinear {
+    int iv; // in the context's induction_vars, -1 if the value isn't one of these
+    int factor;
+    int offset;
+} SRLinear;
+
+typedef enum SRAction {
+    SRAction_Keep,
+    SRAction_Reduce, // becomes a copy of a running sum
+    SRAction_Delete,
+} SRAction;
+
+// a derived induction var kept up to date as `sum`, next to the update of the iv it comes from
+typedef struct SRRunningSum {
+    SRLinear value;
+    char* sum;
+} SRRunningSum;
+
+typedef struct SRContext {
+    IRFunctionDefinition* function;
+    IRGenerator* generator; // for the new vars and preheader labels
+    TCSymbols* symbols;
+    IRCFG cfg;
+    IRVarInfos vars;
+    IRLiveness liveness;
+    int* loop_defs; // defs of every var inside the current loop
+    int* loop_def_index; // index of the last one
+    int* real_uses; // per var, uses other than feeding another derived induction var
+    VEC(SRInductionVar) induction_vars;
+    VEC(SRRunningSum) sums;
+    SRLinear* derived; // per instruction, what its dst always is
+    SRAction* actions; // per instruction
+    int* reduced; // per instruction, the running sum a reduced instruction copies
+} SRContext;
+
+typedef struct SRStats {
+    int constant_ops;
+    int derived; // derived induction vars turned into running sums
+    int counters; // loop counters that got replaced in their exit test and removed
+} SRStats;
+
+IRProgram strength_reduction_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols);
+void strength_reduction_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols, SRStats* stats);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tail_recursion.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// `t = f(args); return t` inside f becomes `params = args; jump start`, so tail recursive functions
+// run as loops and don't need a frame per level. the params get assigned like a parallel copy:
+// args that read another param go through a temp first, so f(b, a) swaps instead of clobbering.
+// tail calls to other functions are left to the frame pass, which can turn them into jumps.
+
+int tail_recursion_is_param(IRFunctionDefinition* function, IRVal val, int except) {
+    for (int p = 0; p < function->params.length; p++) {
+        if (p != except && ir_val_is_var(val, function->params.data[p])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int tail_recursion_is_self_call(IRFunctionDefinition* function, int index) {
+    IRInstruction* call = &function->body.data[index];
+    if (call->type != IRInstructionType_Call || strcmp(call->value.call.name, function->identifier) ||
+        call->value.call.args.length != function->params.length || index + 1 >= function->body.length) {
+        return false;
+    }
+
+    IRInstruction* next = &function->body.data[index + 1];
+    return next->type == IRInstructionType_Return && ir_val_equal(next->value.val, call->value.call.dst);
+}
+
+int tail_recursion_function(IRFunctionDefinition* function, IRGenerator* generator) {
+    int found = 0;
+    for (int i = 0; i < function->body.length; i++) {
+        found += tail_recursion_is_self_call(function, i);
+    }
+    if (found == 0) {
+        return 0;
+    }
+
+    IRFunctionBody body = {NULL, 0, 0};
+    char* start = ir_make_temp_name(generator);
+    IRInstruction start_label = {.type = IRInstructionType_Label, .value.label = start};
+    vec_push(body, start_label);
+
+    for (int i = 0; i < function->body.length; i++) {
+        if (!tail_recursion_is_self_call(function, i)) {
+            vec_push(body, function->body.data[i]);
+            continue;
+        }
+
+        IRInstruction* call = &function->body.data[i];
+        int count = call->value.call.args.length;
+        IRVal* values = malloc(sizeof(IRVal) * (count + 1));
+
+        for (int p = 0; p < count; p++) {
+            values[p] = call->value.call.args.data[p];
+            if (tail_recursion_is_param(function, values[p], p)) {
+                IRVal temp = ir_make_temp(generator);
+                IRInstruction copy = {.type = IRInstructionType_Copy, .value.copy = {.src = values[p], .dst = temp}};
+                vec_push(body, copy);
+                values[p] = temp;
+            }
+        }
+
+        for (int p = 0; p < count; p++) {
+            IRVal param = {.type = IRValType_Var, .value.var = function->params.data[p]};
+            if (ir_val_equal(values[p], param)) {
+                continue;
+            }
+            IRInstruction copy = {.type = IRInstructionType_Copy, .value.copy = {.src = values[p], .dst = param}};
+            vec_push(body, copy);
+        }
+
+        IRInstruction jump = {.type = IRInstructionType_Jump, .value.label = start};
+        vec_push(body, jump);
+
+        free(values);
+        i++; // the return
+    }
+
+    vec_free(function->body);
+    function->body = body;
+
+    return found;
+}
+
+IRProgram tail_recursion_program(IRProgram program, IRGenerator* generator) {
+    int total = 0;
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            IRFunctionDefinition* function = &program.data[i].val.function;
+            int found = tail_recursion_function(function, generator);
+            if (found > 0) {
+                remark(RemarkKind_Passed, "tail-recursion", "TailCallEliminated", function->identifier,
+                    "%d tail recursive calls turned into jumps", found);
+            }
+            total += found;
+        }
+    }
+
+    remark_stats("tail recursive calls turned into jumps: %d\n", total);
+
+    return program;
+}
@@ -0,0 +1,11 @@
+#ifndef TAIL_RECURSION_H
+#define TAIL_RECURSION_H
+
+#include "../ir.h"
+#include "ir_analysis.h"
+
+IRProgram tail_recursion_program(IRProgram program, IRGenerator* generator);
+// returns how many self calls became jumps
+int tail_recursion_function(IRFunctionDefinition* function, IRGenerator* generator);
+
+#endif
@@ -0,0 +1,564 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unroll.h"
+#include "../easy_stuff.h"
+#include "../remarks.h"
+
+// unrolling of innermost loops with a constant trip count
+//
+// the trip count comes from running the counter: it starts at a constant, moves by a constant step once
+// per iteration in the latch, and the latch's test against a constant decides whether to go around again.
+// small loops get replaced by one copy per iteration, with the counter's reads turned into the constant
+// it has in that iteration, so instruction selection can fold whatever it feeds. bigger ones get a
+// copy of the body per unrolled iteration and a single test at the end. the iterations that don't fill
+// a whole round get peeled off in front. copy k reads the counter as `i + k * step` and only the last
+// one updates it, so strength reduction still sees a normal counter afterwards.
+// the counter has to stay in [0, 32767] throughout, where the signed and the unsigned compares agree.
+
+#define UNROLL_MAX_TRIPS 32767
+
+int unroll_compare(IRBinaryOp op, int left, int right) {
+    switch (op) {
+        case IRBinaryOp_Equal:
+            return left == right;
+        case IRBinaryOp_NotEqual:
+            return left != right;
+        case IRBinaryOp_Less:
+            return left < right;
+        case IRBinaryOp_LessEqual:
+            return left <= right;
+        case IRBinaryOp_Greater:
+            return left > right;
+        case IRBinaryOp_GreaterEqual:
+            return left >= right;
+        default:
+            return -1;
+    }
+}
+
+int unroll_var(UnrollContext* context, IRVal val) {
+    if (val.type != IRValType_Var) {
+        return -1;
+    }
+    return string_map_get(&context->vars.indices, val.value.var);
+}
+
+int unroll_dst_var(UnrollContext* context, IRInstruction* instruction) {
+    IRVal* dst = ir_instruction_dst(instruction);
+    return dst == NULL ? -1 : unroll_var(context, *dst);
+}
+
+// how many times the body runs once the loop is entered, or -1 if that's not known or too many
+int unroll_trip_count(IRInstruction* compare, int counter_left, int initial, int step) {
+    IRBinaryOp op = compare->value.binary.op;
+    int bound = counter_left ? compare->value.binary.right.value.integer : compare->value.binary.left.value.integer;
+    if (initial < 0 || unroll_compare(op, 0, 0) < 0) {
+        return -1;
+    }
+
+    int counter = initial;
+    for (int trips = 1; trips <= UNROLL_MAX_TRIPS; trips++) {
+        counter += step;
+        if (counter < 0 || counter > 32767) {
+            return -1;
+        }
+        if (!(counter_left ? unroll_compare(op, counter, bound) : unroll_compare(op, bound, counter))) {
+            return trips;
+        }
+    }
+    return -1;
+}
+
+int unroll_live_after(UnrollContext* context, IRLoop* loop, int var) {
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        for (int s = 0; s < b->successors.length; s++) {
+            int succ = b->successors.data[s];
+            if (!loop->contains[succ] && ir_live_in(&context->liveness, succ, var)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int unroll_analyze(UnrollContext* context, IRLoops* loops, int index, UnrollLoop* info) {
+    IRFunctionBody* body = &context->function->body;
+    IRLoop* loop = &loops->data[index];
+
+    // innermost loops only
+    for (int l = 0; l < loops->length; l++) {
+        if (l != index && loop->contains[loops->data[l].header]) {
+            return false;
+        }
+    }
+    if (loop->latches.length != 1) {
+        return false;
+    }
+
+    // the loop has to be one run of instructions from the header label to the latch's jump back
+    // (plus whatever dead code sits in between, like after a `break`)
+    IRBlock* header = &context->cfg.data[loop->header];
+    IRBlock* latch = &context->cfg.data[loop->latches.data[0]];
+    int start = header->start;
+    int end = latch->end;
+    int early_exits = false;
+    if (end - start < 3 || body->data[start].type != IRInstructionType_Label) {
+        return false;
+    }
+    for (int i = start; i < end; i++) {
+        int block = context->cfg.instruction_blocks[i];
+        if (!loop->contains[block] && context->cfg.data[block].rpo_index >= 0) {
+            return false;
+        }
+    }
+    for (int l = 0; l < loop->blocks.length; l++) {
+        IRBlock* b = &context->cfg.data[loop->blocks.data[l]];
+        if (b->start < start || b->end > end) {
+            return false;
+        }
+        for (int s = 0; s < b->successors.length; s++) {
+            early_exits |= b != latch && !loop->contains[b->successors.data[s]];
+        }
+    }
+
+    // `c = i < bound` then `if c goto header`
+    IRInstruction* jump = &body->data[end - 1];
+    IRInstruction* compare = &body->data[end - 2];
+    if (jump->type != IRInstructionType_JumpIfNotZero || strcmp(jump->value.jump_cond.label, body->data[start].value.label) ||
+        compare->type != IRInstructionType_Binary || unroll_compare(compare->value.binary.op, 0, 0) < 0 ||
+        !ir_val_equal(compare->value.binary.dst, jump->value.jump_cond.val)) {
+        return false;
+    }
+    int test_var = unroll_dst_var(context, compare);
+    if (test_var < 0 || context->vars.data[test_var].uses != 1 || context->vars.data[test_var].is_static) {
+        return false;
+    }
+    IRVal left = compare->value.binary.left;
+    IRVal right = compare->value.binary.right;
+    int counter_left = left.type == IRValType_Var && right.type == IRValType_Int;
+    if (!counter_left && !(right.type == IRValType_Var && left.type == IRValType_Int)) {
+        return false;
+    }
+    int var = unroll_var(context, counter_left ? left : right);
+    if (var < 0 || context->vars.data[var].is_static) {
+        return false;
+    }
+
+    // the counter's only update runs exactly once per iteration: its block is on every way around,
+    // and there's no inner loop to run it again. it can go through a temp right before it
+    int def = -1;
+    for (int i = start; i < end; i++) {
+        if (unroll_dst_var(context, &body->data[i]) == var) {
+            if (def >= 0) {
+                return false;
+            }
+            def = i;
+        }
+    }
+    int def_block = def < 0 ? -1 : context->cfg.instruction_blocks[def];
+    if (def < 0 || !loop->contains[def_block] || !cfg_dominates(&context->cfg, def_block, loop->latches.data[0])) {
+        return false;
+    }
+    int step_def = def;
+    IRInstruction* update = &body->data[def];
+    if (update->type == IRInstructionType_Copy && def - 1 > start && context->cfg.instruction_blocks[def - 1] == def_block) {
+        int temp = unroll_var(context, update->value.copy.src);
+        if (temp >= 0 && temp == unroll_dst_var(context, &body->data[def - 1]) && context->vars.data[temp].uses == 1 &&
+            context->vars.data[temp].defs == 1) {
+            step_def = def - 1;
+        }
+    }
+    int step;
+    if (!ir_match_step(&body->data[step_def], context->vars.data[var].name, &step) || step == 0) {
+        return false;
+    }
+
+    // it starts out as a constant, from its one def outside the loop
+    if (context->vars.data[var].defs != 2) {
+        return false;
+    }
+    int initial = -1;
+    for (int i = 0; i < body->length; i++) {
+        IRInstruction* instruction = &body->data[i];
+        if ((i < start || i >= end) && unroll_dst_var(context, instruction) == var) {
+            if (instruction->type != IRInstructionType_Copy || instruction->value.copy.src.type != IRValType_Int) {
+                return false;
+            }
+            initial = instruction->value.copy.src.value.integer;
+        }
+    }
+
+    int trips = unroll_trip_count(compare, counter_left, initial, step);
+    if (trips < 0) {
+        return false;
+    }
+
+    int reads_after = false;
+    IRValRefs sources = {0};
+    for (int i = def + 1; i < end - 2; i++) {
+        sources.length = 0;
+        ir_instruction_sources(&body->data[i], &sources);
+        for (int s = 0; s < sources.length; s++) {
+            reads_after |= unroll_var(context, *sources.data[s]) == var;
+        }
+    }
+    vec_free(sources);
+
+    // vars that only live inside one iteration get their own names in every copy,
+    // so the copies don't share defs and later passes see them as separate values
+    IntVec locals = {0};
+    for (int i = start; i < end; i++) {
+        int local = unroll_dst_var(context, &body->data[i]);
+        if (local < 0 || local == var || context->vars.data[local].is_static ||
+            ir_live_in(&context->liveness, loop->header, local) || unroll_live_after(context, loop, local)) {
+            continue;
+        }
+        int seen = false;
+        for (int l = 0; l < locals.length; l++) {
+            seen |= locals.data[l] == local;
+        }
+        if (!seen) {
+            vec_push(locals, local);
+        }
+    }
+    int labels = 0;
+    for (int i = start; i < end; i++) {
+        labels += body->data[i].type == IRInstructionType_Label;
+    }
+
+    *info = (UnrollLoop){
+        .start = start,
+        .end = end,
+        .var = var,
+        .def = def,
+        .step_def = step_def,
+        .step = step,
+        .compare = end - 2,
+        .initial = initial,
+        .trips = trips,
+        .counter_live = unroll_live_after(context, loop, var),
+        .reads_after = reads_after,
+        .early_exits = early_exits,
+        .size = end - start - labels - 2,
+        .locals = locals,
+    };
+    return true;
+}
+
+// the compare and the jump back aren't part of an iteration's copy
+int unroll_is_test(UnrollLoop* loop, int i) {
+    return i >= loop->compare;
+}
+
+int unroll_is_update(UnrollLoop* loop, int i) {
+    return i == loop->def || i == loop->step_def;
+}
+
+// one iteration of the loop. reads of the counter become `before` up to its update and `after` past it
+// (left alone when NULL), `header` labels the copy if it isn't NULL,
+// `back` is where the test jumps (no test at all when it's NULL)
+void unroll_copy(UnrollContext* context, UnrollLoop* loop, IRFunctionBody* out, char* header, IRVal* before, IRVal* after,
+    int keep_update, int step, char* back) {
+    IRFunctionBody* body = &context->function->body;
+    char* header_label = body->data[loop->start].value.label;
+
+    // every copy needs its own labels
+    // and labels nothing jumps to are left out, so the copies don't get split into blocks for no reason
+    StringMap labels = string_map_new();
+    StringMap targets = string_map_new();
+    VEC(char*) names = {0};
+    for (int i = loop->start + 1; i < loop->end; i++) {
+        IRInstruction* instruction = &body->data[i];
+        if (instruction->type == IRInstructionType_Label) {
+            string_map_set(&labels, instruction->value.label, names.length);
+            vec_push(names, ir_make_temp_name(context->generator));
+        } else if (instruction->type == IRInstructionType_Jump) {
+            string_map_set(&targets, instruction->value.label, 1);
+        } else if (instruction->type == IRInstructionType_JumpIfZero || instruction->type == IRInstructionType_JumpIfNotZero) {
+            string_map_set(&targets, instruction->value.jump_cond.label, 1);
+        } else if (instruction->type == IRInstructionType_JumpTable) {
+            for (int l = 0; l < instruction->value.jump_table.labels.length; l++) {
+                string_map_set(&targets, instruction->value.jump_table.labels.data[l], 1);
+            }
+        }
+    }
+
+    StringMap vars = string_map_new();
+    VEC(char*) var_names = {0};
+    for (int l = 0; l < loop->locals.length; l++) {
+        string_map_set(&vars, context->vars.data[loop->locals.data[l]].name, var_names.length);
+        vec_push(var_names, ir_make_temp_name(context->generator));
+    }
+
+    IRValRefs sources = {0};
+    for (int i = loop->start; i < loop->end; i++) {
+        if ((unroll_is_test(loop, i) && back == NULL) || (unroll_is_update(loop, i) && !keep_update)) {
+            continue;
+        }
+        IRInstruction instruction = body->data[i];
+
+        if (instruction.type == IRInstructionType_Call) {
+            IRVal* args = malloc(sizeof(IRVal) * (instruction.value.call.args.length + 1));
+            memcpy(args, instruction.value.call.args.data, sizeof(IRVal) * instruction.value.call.args.length);
+            instruction.value.call.args.data = args;
+            instruction.value.call.args.capacity = instruction.value.call.args.length;
+        }
+
+        IRVal* counter = i <= loop->def ? before : after;
+        // when the counter stays a var, its update has to read the real thing
+        if (counter != NULL && !(unroll_is_update(loop, i) && counter->type == IRValType_Var)) {
+            sources.length = 0;
+            ir_instruction_sources(&instruction, &sources);
+            for (int s = 0; s < sources.length; s++) {
+                if (unroll_var(context, *sources.data[s]) == loop->var) {
+                    *sources.data[s] = *counter;
+                }
+            }
+        }
+
+        sources.length = 0;
+        ir_instruction_sources(&instruction, &sources);
+        IRVal* dst = ir_instruction_dst(&instruction);
+        if (dst != NULL) {
+            vec_push(sources, dst);
+        }
+        for (int s = 0; s < sources.length; s++) {
+            int local = sources.data[s]->type == IRValType_Var ? string_map_get(&vars, sources.data[s]->value.var) : -1;
+            if (local >= 0) {
+                sources.data[s]->value.var = var_names.data[local];
+            }
+        }
+
+        if (i == loop->step_def && step != loop->step) {
+            IRVal* constant = &instruction.value.binary.right;
+            if (constant->type != IRValType_Int) {
+                constant = &instruction.value.binary.left;
+            }
+            constant->value.integer = instruction.value.binary.op == IRBinaryOp_Subtract ? -step : step;
+        }
+
+        switch (instruction.type) {
+            case IRInstructionType_Label:
+                if (i == loop->start ? header == NULL : string_map_get(&targets, instruction.value.label) < 0) {
+                    continue;
+                }
+                instruction.value.label = i == loop->start ? header : names.data[string_map_get(&labels, instruction.value.label)];
+                break;
+            case IRInstructionType_Jump: {
+                int label = string_map_get(&labels, instruction.value.label);
+                if (label >= 0) {
+                    instruction.value.label = names.data[label];
+                }
+                break;
+            }
+            case IRInstructionType_JumpIfZero:
+            case IRInstructionType_JumpIfNotZero: {
+                int label = string_map_get(&labels, instruction.value.jump_cond.label);
+                if (label >= 0) {
+                    instruction.value.jump_cond.label = names.data[label];
+                } else if (!strcmp(instruction.value.jump_cond.label, header_label)) {
+                    instruction.value.jump_cond.label = back;
+                }
+                break;
+            }
+            case IRInstructionType_JumpTable: {
+                int count = instruction.value.jump_table.labels.length;
+                char** table_labels = malloc_n_type(char*, count);
+                for (int l = 0; l < count; l++) {
+                    int label = string_map_get(&labels, instruction.value.jump_table.labels.data[l]);
+                    table_labels[l] = label >= 0 ? names.data[label] : instruction.value.jump_table.labels.data[l];
+                }
+                instruction.value.jump_table.labels.data = table_labels;
+                instruction.value.jump_table.labels.capacity = count;
+                instruction.value.jump_table.table = ir_make_temp_name(context->generator);
+                break;
+            }
+            default:
+                break;
+        }
+
+        vecptr_push(out, instruction);
+    }
+
+    vec_free(sources);
+    vec_free(names);
+    vec_free(var_names);
+    string_map_free(labels);
+    string_map_free(targets);
+    string_map_free(vars);
+}
+
+void unroll_fully(UnrollContext* context, UnrollLoop* loop, IRFunctionBody* out) {
+    char* header = context->function->body.data[loop->start].value.label;
+    int value = loop->initial;
+    for (int k = 0; k < loop->trips; k++) {
+        IRVal before = {.type = IRValType_Int, .value.integer = value};
+        IRVal after = {.type = IRValType_Int, .value.integer = value + loop->step};
+        unroll_copy(context, loop, out, k == 0 ? header : NULL, &before, &after,
+            loop->counter_live, loop->step, NULL);
+        value += loop->step;
+    }
+}
+
+// `counter + offset` in a fresh temp
+IRVal unroll_push_offset(UnrollContext* context, IRVal counter, int offset, IRFunctionBody* out) {
+    IRVal shifted = ir_make_temp(context->generator);
+    IRInstruction instruction = {
+        .type = IRInstructionType_Binary,
+        .value.binary = {
+            .op = IRBinaryOp_Add,
+            .left = counter,
+            .right = {.type = IRValType_Int, .value.integer = offset},
+            .dst = shifted,
+        },
+    };
+    vecptr_push(out, instruction);
+    return shifted;
+}
+
+void unroll_partly(UnrollContext* context, UnrollLoop* loop, int factor, IRFunctionBody* out) {
+    IRFunctionBody* body = &context->function->body;
+    IRVal counter = {.type = IRValType_Var, .value.var = context->vars.data[loop->var].name};
+    char* header = body->data[loop->start].value.label;
+
+    // the leftover iterations go first, as they are
+    int remainder = loop->trips % factor;
+    for (int k = 0; k < remainder; k++) {
+        unroll_copy(context, loop, out, k == 0 ? header : NULL, NULL, NULL, true, loop->step, NULL);
+    }
+
+    char* round = remainder == 0 ? header : ir_make_temp_name(context->generator);
+    ir_push_label(round, out);
+    for (int k = 0; k < factor; k++) {
+        int last = k == factor - 1;
+        IRVal before = k == 0 ? counter : unroll_push_offset(context, counter, loop->step * k, out);
+        IRVal after = last || !loop->reads_after ? counter : unroll_push_offset(context, counter, loop->step * (k + 1), out);
+        unroll_copy(context, loop, out, NULL, k == 0 ? NULL : &before, last ? NULL : &after, last, loop->step * factor,
+            last ? round : NULL);
+    }
+}
+
+int unroll_function_loops(UnrollContext* context, UnrollStats* stats) {
+    IRFunctionBody* body = &context->function->body;
+    IRLoops loops = cfg_find_loops(&context->cfg);
+
+    // innermost loops don't overlap, so they can all be done in one go, in the order they show up
+    VEC(UnrollLoop) plans = {0};
+    VEC(int) factors = {0};
+    for (int l = 0; l < loops.length; l++) {
+        UnrollLoop info;
+        if (!unroll_analyze(context, &loops, l, &info)) {
+            continue;
+        }
+
+        int old_size = info.size + 2;
+        int full_size = info.trips * (info.size - (info.counter_live ? 0 : 1 + (info.step_def != info.def)));
+        char* header = body->data[info.start].value.label;
+        int factor = 0;
+        if (full_size <= UNROLL_FULL_SIZE && full_size - old_size <= *context->growth) {
+            *context->growth -= full_size - old_size;
+            factor = -1;
+        } else if (!info.counter_live || !info.early_exits) {
+            // a partly unrolled round only updates the counter at its end
+            for (int f = UNROLL_MAX_FACTOR; f >= 2 && factor == 0; f--) {
+                int size = (f + info.trips % f) * info.size + f - 1;
+                if (info.trips / f >= 2 && size <= UNROLL_PARTIAL_SIZE && size - old_size <= *context->growth) {
+                    *context->growth -= size - old_size;
+                    factor = f;
+                }
+            }
+        }
+        if (factor < 0) {
+            remark(RemarkKind_Passed, "unroll", "FullyUnrolled", context->function->identifier,
+                "loop at %s unrolled fully, %d iterations", header, info.trips);
+        } else if (factor > 0) {
+            remark(RemarkKind_Passed, "unroll", "PartiallyUnrolled", context->function->identifier,
+                "loop at %s unrolled by %d, %d iterations", header, factor, info.trips);
+        } else {
+            remark(RemarkKind_Missed, "unroll", "TooBig", context->function->identifier,
+                "loop at %s not unrolled, %d iterations of %d instructions", header, info.trips, info.size);
+        }
+
+        if (factor != 0) {
+            vec_push(plans, info);
+            vec_push(factors, factor);
+        } else {
+            vec_free(info.locals);
+        }
+    }
+    cfg_loops_free(&loops);
+
+    if (plans.length == 0) {
+        vec_free(plans);
+        vec_free(factors);
+        return 0;
+    }
+
+    IRFunctionBody new_body = {0};
+    for (int i = 0; i < body->length; i++) {
+        int plan = -1;
+        for (int p = 0; p < plans.length; p++) {
+            if (plans.data[p].start == i) {
+                plan = p;
+            }
+        }
+        if (plan < 0) {
+            vec_push(new_body, body->data[i]);
+            continue;
+        }
+
+        if (factors.data[plan] < 0) {
+            unroll_fully(context, &plans.data[plan], &new_body);
+            stats->full++;
+        } else {
+            unroll_partly(context, &plans.data[plan], factors.data[plan], &new_body);
+            stats->partial++;
+        }
+        i = plans.data[plan].end - 1;
+    }
+
+    int unrolled = plans.length;
+    for (int p = 0; p < plans.length; p++) {
+        vec_free(plans.data[p].locals);
+    }
+    vec_free(plans);
+    vec_free(factors);
+    vec_free(*body);
+    *body = new_body;
+    return unrolled;
+}
+
+void unroll_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols, int* growth, UnrollStats* stats) {
+    UnrollContext context = {
+        .function = function,
+        .generator = generator,
+        .symbols = symbols,
+        .cfg = cfg_build(&function->body),
+        .vars = ir_collect_var_info(function, symbols),
+        .growth = growth,
+    };
+    cfg_compute_dominators(&context.cfg);
+    context.liveness = ir_compute_liveness(function, &context.cfg, &context.vars);
+
+    unroll_function_loops(&context, stats);
+
+    cfg_free(&context.cfg);
+    ir_liveness_free(&context.liveness);
+    ir_var_infos_free(&context.vars);
+}
+
+IRProgram unroll_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols) {
+    UnrollStats stats = {0};
+    int growth = UNROLL_PROGRAM_GROWTH;
+    for (int i = 0; i < program.length; i++) {
+        if (program.data[i].ty == IRTFunction) {
+            unroll_function(&program.data[i].val.function, generator, symbols, &growth, &stats);
+        }
+    }
+
+    remark_stats("unrolled %d loops fully, %d partly\n", stats.full, stats.partial);
+    return program;
+}
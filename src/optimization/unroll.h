@@ -0,0 +1,53 @@
+#ifndef UNROLL_H
+#define UNROLL_H
+
+#include "../ir.h"
+#include "../semantic_analysis/type_checking.h"
+#include "ir_analysis.h"
+
+// a loop gets unrolled completely when all its iterations together are at most this many instructions
+#define UNROLL_FULL_SIZE 64
+// otherwise it gets unrolled by up to this much, as long as the copies and the peeled remainder fit in UNROLL_PARTIAL_SIZE
+#define UNROLL_MAX_FACTOR 4
+#define UNROLL_PARTIAL_SIZE 64
+// ir instructions the whole program can grow by. each one is a few machine instructions,
+// so this keeps unrolling well clear of the 64K address space
+#define UNROLL_PROGRAM_GROWTH 4096
+
+// a loop with a single counter that the latch tests against a constant
+typedef struct UnrollLoop {
+    int start; // header label
+    int end; // one past the latch's jump back
+    int var; // the counter, in the context's vars
+    int def; // `i = i + step`, or `i = t` after `t = i + step`
+    int step_def;
+    int step;
+    int initial;
+    int compare; // `c = i < bound` (or any other compare against a constant) right before the jump back
+    int trips;
+    int counter_live; // after the loop
+    int early_exits; // ways out of the loop other than the test failing
+    int reads_after; // whether anything but the test reads the counter after its update
+    int size; // instructions per iteration, not counting labels and the test
+    IntVec locals; // vars that don't outlive an iteration
+} UnrollLoop;
+
+typedef struct UnrollContext {
+    IRFunctionDefinition* function;
+    IRGenerator* generator; // for the labels of the copies
+    TCSymbols* symbols;
+    IRCFG cfg;
+    IRVarInfos vars;
+    IRLiveness liveness;
+    int* growth; // what's left of UNROLL_PROGRAM_GROWTH
+} UnrollContext;
+
+typedef struct UnrollStats {
+    int full;
+    int partial;
+} UnrollStats;
+
+IRProgram unroll_program(IRProgram program, IRGenerator* generator, TCSymbols* symbols);
+void unroll_function(IRFunctionDefinition* function, IRGenerator* generator, TCSymbols* symbols, int* growth, UnrollStats* stats);
+
+#endif
@@ -20,11 +20,6 @@ ParserProgram parser_parse(Parser* parser) {
 
     while (parser->tokens[parser->index].type != TokenType_EOF) {
         Declaration decl = parser_parse_declaration(parser);
-
-        if (decl.type != DeclarationType_Function) {
-            panic("static variables more like bad-ic variables OOOOHHHH");
-        }
-
         vec_push(program, decl);
     }
 
@@ -46,7 +41,8 @@ ParserBlock parser_parse_block(Parser* parser) {
 
         switch (token.type) {
             case TokenType_KEYWORD:
-                if (token.value.keyword == Keyword_INT) {
+                if (token.value.keyword == Keyword_INT || token.value.keyword == Keyword_STATIC ||
+                    token.value.keyword == Keyword_EXTERN) {
                     block.statements[block.length].type = BlockItem_DECLARATION;
                     block.statements[block.length].value.declaration = parser_parse_declaration(parser);
                     break;
@@ -191,6 +187,7 @@ Declaration parser_parse_declaration(Parser* parser) {
         Token peek = parser_peek(parser);
 
         if (peek.type == TokenType_SEMICOLON) {
+            parser_next_token(parser);
             declaration.value.function.body.is_some = false;
         } else {
             declaration.value.function.body.data = parser_parse_block(parser);
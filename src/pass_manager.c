@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pass_manager.h"
+#include "easy_stuff.h"
+#include "optimization/ir_verify.h"
+#include "optimization/gvn.h"
+#include "optimization/licm.h"
+#include "optimization/strength_reduction.h"
+#include "optimization/unroll.h"
+#include "optimization/tail_recursion.h"
+#include "optimization/inliner.h"
+#include "optimization/global_dce.h"
+#include "optimization/ipcp.h"
+#include "optimization/promote_statics.h"
+#include "assembly_gen/replace_pseudo.h"
+#include "assembly_gen/assembley_fixup.h"
+#include "assembly_gen/peephole.h"
+#include "assembly_gen/frame.h"
+#include "assembly_gen/outliner.h"
+#include "emitter.h"
+
+int pass_tail_recursion(PassState* state) {
+    state->ir = tail_recursion_program(state->ir, state->generator);
+    return 1;
+}
+
+int pass_inline(PassState* state) {
+    state->ir = inliner_program(state->ir, state->generator, state->symbols);
+    return 1;
+}
+
+int pass_ipcp(PassState* state, int specialize) {
+    IPCPStats stats = {0};
+    state->ir = ipcp_program(state->ir, state->generator, state->symbols, specialize, &stats);
+    remark_stats("ipcp bound %d params, made %d specialized copies for %d calls, folded %d instructions\n", stats.params,
+        stats.clones, stats.redirected, stats.folded);
+    return stats.params + stats.clones;
+}
+
+int pass_ipcp_substitute(PassState* state) {
+    return pass_ipcp(state, false);
+}
+
+int pass_specialize(PassState* state) {
+    return pass_ipcp(state, true);
+}
+
+int pass_globaldce(PassState* state) {
+    GlobalDCEStats stats = {0};
+    state->ir = global_dce_program(state->ir, &stats);
+    remark_stats("globaldce removed %d functions (%d instructions) and %d statics\n", stats.functions, stats.instructions,
+        stats.statics);
+    return stats.functions + stats.statics;
+}
+
+int pass_promote_statics(PassState* state) {
+    PromoteStats stats = {0};
+    state->ir = promote_statics_program(state->ir, state->generator, state->symbols, &stats);
+    remark_stats("promote-statics promoted %d statics in %d loops\n", stats.statics, stats.loops);
+    return stats.statics;
+}
+
+int pass_gvn(PassState* state) {
+    int replaced = 0;
+    state->ir = gvn_program(state->ir, state->symbols, &replaced);
+    remark_stats("gvn replaced %d expressions\n", replaced);
+    return replaced;
+}
+
+int pass_licm(PassState* state) {
+    int hoisted = 0;
+    state->ir = licm_program(state->ir, state->generator, state->symbols, &hoisted);
+    remark_stats("licm hoisted %d instructions\n", hoisted);
+    return hoisted;
+}
+
+int pass_unroll(PassState* state) {
+    state->ir = unroll_program(state->ir, state->generator, state->symbols);
+    return 1;
+}
+
+int pass_strength_reduction(PassState* state) {
+    state->ir = strength_reduction_program(state->ir, state->generator, state->symbols);
+    return 1;
+}
+
+int pass_isel(PassState* state) {
+    if (state->evaluated != NULL) {
+        for (int i = 0; i < state->ir.length; i++) {
+            vecptr_push(state->evaluated, state->ir.data[i]);
+        }
+    }
+    state->codegen = codegen_generate_program(state->ir, state->symbols);
+    return 1;
+}
+
+int pass_regalloc(PassState* state) {
+    state->codegen = allocate_registers(state->codegen, state->symbols, state->regalloc);
+    return 1;
+}
+
+int pass_replace_pseudo(PassState* state) {
+    state->replaced = replace_pseudo(state->codegen, state->symbols);
+    state->codegen = state->replaced.program;
+    return 1;
+}
+
+int pass_fixup(PassState* state) {
+    state->replaced.program = state->codegen;
+    state->codegen = fixup_program(state->replaced);
+    return 1;
+}
+
+int pass_peephole(PassState* state) {
+    state->codegen = peephole_program(state->codegen);
+    return 1;
+}
+
+int pass_frame(PassState* state) {
+    state->codegen = frame_program(state->codegen);
+    return 1;
+}
+
+int pass_outline(PassState* state) {
+    state->codegen = outliner_program(state->codegen);
+    return 1;
+}
+
+int pass_emit(PassState* state) {
+    state->output = emit_program(state->codegen);
+    return 1;
+}
+
+Pass pass_registry[] = {
+    {"tail-recursion", PassKind_IR, pass_tail_recursion, false},
+    {"inline", PassKind_IR, pass_inline, false},
+    {"ipcp", PassKind_IR, pass_ipcp_substitute, false},
+    {"specialize", PassKind_IR, pass_specialize, false},
+    {"globaldce", PassKind_IR, pass_globaldce, false},
+    {"promote-statics", PassKind_IR, pass_promote_statics, false},
+    {"gvn", PassKind_IR, pass_gvn, false},
+    {"licm", PassKind_IR, pass_licm, false},
+    {"unroll", PassKind_IR, pass_unroll, false},
+    {"strength-reduction", PassKind_IR, pass_strength_reduction, false},
+    {"isel", PassKind_Codegen, pass_isel, true},
+    {"regalloc", PassKind_Codegen, pass_regalloc, false},
+    {"replace-pseudo", PassKind_Codegen, pass_replace_pseudo, true},
+    {"fixup", PassKind_Codegen, pass_fixup, true},
+    {"peephole", PassKind_Codegen, pass_peephole, false},
+    {"frame", PassKind_Codegen, pass_frame, false},
+    {"outline", PassKind_Codegen, pass_outline, false},
+    {"emit", PassKind_Codegen, pass_emit, true},
+};
+#define PASS_COUNT ((int)(sizeof(pass_registry) / sizeof(pass_registry[0])))
+
+#define O0 (1 << OptLevel_O0)
+#define O1 (1 << OptLevel_O1)
+#define O2 (1 << OptLevel_O2)
+#define Os (1 << OptLevel_Os)
+#define ALL (O0 | O1 | O2 | Os)
+
+PipelineStep pass_pipeline[] = {
+    {"tail-recursion", O1 | O2 | Os, 0},
+    {"inline", O2, 0}, // copies bodies, so not for -Os
+    {"ipcp", O1 | Os, 0},
+    {"specialize", O2, 0}, // does what ipcp does, and copies functions for the rest
+    {"globaldce", O1 | O2 | Os, 0}, // after inlining, which leaves static callees without callers
+    {"promote-statics", O1 | O2 | Os, 0}, // before licm, which can't hoist anything that reads a static being written
+    {"gvn", O1 | O2 | Os, 1},
+    {"licm", O1 | O2 | Os, 1},
+    {"unroll", O2, 0},
+    {"strength-reduction", O2 | Os, 0},
+    {"isel", ALL, 0},
+    {"regalloc", O1 | O2 | Os, 0},
+    {"replace-pseudo", ALL, 0},
+    {"fixup", ALL, 0},
+    {"peephole", O1 | O2 | Os, 0},
+    {"frame", O1 | O2 | Os, 0},
+    {"outline", Os, 0}, // calls cost time, so only when size is all that matters
+    {"emit", ALL, 0},
+};
+#define PIPELINE_LENGTH ((int)(sizeof(pass_pipeline) / sizeof(pass_pipeline[0])))
+
+int pass_find(char* name) {
+    for (int i = 0; i < PASS_COUNT; i++) {
+        if (strcmp(pass_registry[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+PassOptions pass_options_new() {
+    PassOptions options = {
+        .level = OptLevel_O2,
+        .regalloc = RegallocMode_Coloring,
+        .forced = malloc_n_type(int, PASS_COUNT),
+        .remarks = {RemarkFormat_None, false, false, false},
+        .whole_program = false,
+    };
+    for (int i = 0; i < PASS_COUNT; i++) {
+        options.forced[i] = -1;
+    }
+    return options;
+}
+
+int pass_options_parse(PassOptions* options, char* arg) {
+    if (strcmp(arg, "-O0") == 0) {
+        options->level = OptLevel_O0;
+    } else if (strcmp(arg, "-O1") == 0) {
+        options->level = OptLevel_O1;
+    } else if (strcmp(arg, "-O2") == 0 || strcmp(arg, "-O") == 0) {
+        options->level = OptLevel_O2;
+    } else if (strcmp(arg, "-Os") == 0) {
+        options->level = OptLevel_Os;
+    } else if (strncmp(arg, "-O", 2) == 0) {
+        fprintf(stderr, "Unknown optimization level: %s\n", arg + 2);
+        exit(1);
+    } else if (strcmp(arg, "-fregalloc=coloring") == 0) {
+        options->regalloc = RegallocMode_Coloring;
+    } else if (strcmp(arg, "-fregalloc=linear") == 0) {
+        options->regalloc = RegallocMode_LinearScan;
+    } else if (strncmp(arg, "-fregalloc=", 11) == 0) {
+        fprintf(stderr, "Unknown register allocator: %s\n", arg + 11);
+        exit(1);
+    } else if (strcmp(arg, "-fsave-optimization-record") == 0 || strcmp(arg, "-fsave-optimization-record=yaml") == 0) {
+        options->remarks.format = RemarkFormat_YAML;
+    } else if (strcmp(arg, "-fsave-optimization-record=json") == 0) {
+        options->remarks.format = RemarkFormat_JSON;
+    } else if (strncmp(arg, "-fsave-optimization-record=", 27) == 0) {
+        fprintf(stderr, "Unknown optimization record format: %s\n", arg + 27);
+        exit(1);
+    } else if (strcmp(arg, "-flto") == 0) {
+        options->whole_program = true;
+    } else if (strcmp(arg, "-fno-lto") == 0) {
+        options->whole_program = false;
+    } else if (strcmp(arg, "-fstats") == 0) {
+        options->remarks.print_stats = true;
+    } else if (strcmp(arg, "-feval-ir") == 0) {
+        options->eval_ir = true;
+    } else if (strcmp(arg, "-Rpass") == 0) {
+        options->remarks.print_passed = true;
+    } else if (strcmp(arg, "-Rpass-missed") == 0) {
+        options->remarks.print_missed = true;
+    } else if (strncmp(arg, "-f", 2) == 0) {
+        int enable = strncmp(arg, "-fno-", 5) != 0;
+        char* name = arg + (enable ? 2 : 5);
+        int pass = pass_find(name);
+        if (pass == -1) {
+            fprintf(stderr, "Unknown pass: %s\n", name);
+            exit(1);
+        }
+        if (!enable && pass_registry[pass].required) {
+            fprintf(stderr, "Pass %s can't be turned off\n", name);
+            exit(1);
+        }
+        options->forced[pass] = enable;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void pass_options_free(PassOptions* options) {
+    free(options->forced);
+    vec_free(options->evaluated);
+}
+
+int pass_enabled(PassOptions* options, PipelineStep* step) {
+    int pass = pass_find(step->pass);
+    if (options->forced[pass] != -1) {
+        return options->forced[pass];
+    }
+    return (step->levels >> options->level) & 1;
+}
+
+int pass_run(PassState* state, int pass, double* seconds, int* runs) {
+    printf("pre %s\n", pass_registry[pass].name);
+    clock_t start = clock();
+    int changed = pass_registry[pass].run(state);
+    seconds[pass] += (double)(clock() - start) / CLOCKS_PER_SEC;
+    runs[pass]++;
+
+#ifndef NDEBUG
+    if (pass_registry[pass].kind == PassKind_IR) {
+        ir_verify_program(&state->ir, state->symbols, pass_registry[pass].name);
+    }
+#endif
+
+    return changed;
+}
+
+char* pass_manager_run(PassOptions* options, IRGenerator* generator, TCSymbols* symbols, IRProgram program) {
+    PassState state = {
+        .generator = generator,
+        .symbols = symbols,
+        .regalloc = options->regalloc,
+        .ir = program,
+        .evaluated = options->eval_ir ? &options->evaluated : NULL,
+    };
+    double* seconds = calloc(PASS_COUNT, sizeof(double));
+    int* runs = calloc(PASS_COUNT, sizeof(int));
+
+#ifndef NDEBUG
+    ir_verify_program(&state.ir, symbols, "ir generation");
+#endif
+
+    for (int i = 0; i < PIPELINE_LENGTH;) {
+        int group = pass_pipeline[i].group;
+        int end = i + 1;
+        while (group != 0 && end < PIPELINE_LENGTH && pass_pipeline[end].group == group) {
+            end++;
+        }
+
+        // a group keeps going while it changes things, anything else runs once
+        int iterations = 0;
+        int changed = true;
+        while (changed && iterations < (group != 0 ? PASS_MAX_ITERATIONS : 1)) {
+            changed = false;
+            for (int s = i; s < end; s++) {
+                if (pass_enabled(options, &pass_pipeline[s])) {
+                    changed |= pass_run(&state, pass_find(pass_pipeline[s].pass), seconds, runs) > 0;
+                }
+            }
+            iterations++;
+        }
+
+        i = end;
+    }
+
+    for (int i = 0; i < PASS_COUNT; i++) {
+        if (runs[i] > 0) {
+            remark_stats("time %s: %.3f ms, %d runs\n", pass_registry[i].name, seconds[i] * 1000, runs[i]);
+        }
+    }
+    free(seconds);
+    free(runs);
+
+    return state.output;
+}
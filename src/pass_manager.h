@@ -0,0 +1,74 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include "ir.h"
+#include "semantic_analysis/type_checking.h"
+#include "assembly_gen/code_gen.h"
+#include "assembly_gen/register_allocation.h"
+#include "assembly_gen/replace_pseudo.h"
+#include "remarks.h"
+
+// a fixpoint group runs again while any of its passes changed something, at most this many times
+#define PASS_MAX_ITERATIONS 4
+
+typedef enum OptLevel {
+    OptLevel_O0, // only what it takes to get working code
+    OptLevel_O1, // the cheap passes
+    OptLevel_O2, // everything, the default
+    OptLevel_Os, // everything that doesn't grow the code, plus outlining
+} OptLevel;
+
+typedef enum PassKind {
+    PassKind_IR, // rewrites state->ir, which gets verified after it in debug builds
+    PassKind_Codegen, // works on state->codegen (isel is one of these, it makes it)
+} PassKind;
+
+typedef struct PassState {
+    IRGenerator* generator;
+    TCSymbols* symbols;
+    RegallocMode regalloc;
+    IRProgram ir;
+    CodegenProgram codegen;
+    struct ReplaceResult replaced; // between replace-pseudo and fixup, which needs the frame sizes
+    char* output;
+    IRProgram* evaluated; // -feval-ir, gets the ir as it goes into isel
+} PassState;
+
+// returns how many things it changed, or just 1 when it can't tell. only fixpoint groups look at it
+typedef int (*PassFn)(PassState* state);
+
+typedef struct Pass {
+    char* name; // what -f<name> and -fno-<name> refer to
+    PassKind kind;
+    PassFn run;
+    int required; // can't be turned off, the output isn't code without it
+} Pass;
+
+// the pipeline is one list of passes in the order they run, each marked with the levels it's on at.
+// adjacent steps with the same nonzero group repeat together until nothing changes
+typedef struct PipelineStep {
+    char* pass;
+    int levels; // bit per OptLevel
+    int group;
+} PipelineStep;
+
+typedef struct PassOptions {
+    OptLevel level;
+    RegallocMode regalloc;
+    int* forced; // per registered pass, -1 for whatever the level says, else on or off
+    RemarkOptions remarks;
+    int whole_program; // -flto, every input gets linked into one ir program before the pipeline runs
+    int eval_ir; // -feval-ir
+    IRProgram evaluated; // every file's optimized ir, for main to run when eval_ir is on
+} PassOptions;
+
+PassOptions pass_options_new();
+// -O<level>, -f<pass>, -fno-<pass>, -flto, -feval-ir, -fstats, -fregalloc=, -fsave-optimization-record[=yaml|json], -Rpass and -Rpass-missed,
+// returns false for anything else
+int pass_options_parse(PassOptions* options, char* arg);
+void pass_options_free(PassOptions* options);
+
+// runs the whole pipeline from the generated ir to the assembly text
+char* pass_manager_run(PassOptions* options, IRGenerator* generator, TCSymbols* symbols, IRProgram program);
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "remarks.h"
+#include "easy_stuff.h"
+
+RemarkOptions remark_options = {RemarkFormat_None, false, false, false};
+VEC(Remark) remark_records = {NULL, 0, 0};
+
+char* remark_kind_names[] = {"Passed", "Missed"};
+
+void remarks_enable(RemarkOptions options) {
+    remark_options = options;
+}
+
+int remarks_enabled() {
+    return remark_options.format != RemarkFormat_None || remark_options.print_passed || remark_options.print_missed;
+}
+
+void remark(RemarkKind kind, char* pass, char* name, char* function, char* format, ...) {
+    if (!remarks_enabled() || format == NULL) {
+        return;
+    }
+
+    // most fit in the buffer, the rest get formatted again once we know how long they are
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    char* message = malloc_n_type(char, length + 1);
+    if (length < (int)sizeof(buffer)) {
+        strcpy(message, buffer);
+    } else {
+        va_start(args, format);
+        vsnprintf(message, length + 1, format, args);
+        va_end(args);
+    }
+
+    if ((kind == RemarkKind_Passed && remark_options.print_passed) ||
+        (kind == RemarkKind_Missed && remark_options.print_missed)) {
+        fprintf(stderr, "remark: %s: %s [-Rpass%s=%s]\n", function, message,
+            kind == RemarkKind_Missed ? "-missed" : "", pass);
+    }
+
+    if (remark_options.format == RemarkFormat_None) {
+        free(message);
+        return;
+    }
+
+    Remark record = {kind, pass, name, strdup(function), message};
+    vec_push(remark_records, record);
+}
+
+void remark_stats(char* format, ...) {
+    if (!remark_options.print_stats) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// single quoted yaml only needs its quotes doubled
+void remark_write_yaml_string(FILE* file, char* string) {
+    fputc('\'', file);
+    for (char* c = string; *c; c++) {
+        if (*c == '\'') {
+            fputc('\'', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('\'', file);
+}
+
+void remark_write_json_string(FILE* file, char* string) {
+    fputc('"', file);
+    for (char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+void remark_write_yaml(FILE* file) {
+    for (int i = 0; i < remark_records.length; i++) {
+        Remark* r = &remark_records.data[i];
+        fprintf(file, "--- !%s\nPass: %s\nName: %s\nFunction: ", remark_kind_names[r->kind], r->pass, r->name);
+        remark_write_yaml_string(file, r->function);
+        fprintf(file, "\nMessage: ");
+        remark_write_yaml_string(file, r->message);
+        fprintf(file, "\n...\n");
+    }
+}
+
+void remark_write_json(FILE* file) {
+    fprintf(file, "[");
+    for (int i = 0; i < remark_records.length; i++) {
+        Remark* r = &remark_records.data[i];
+        fprintf(file, "%s\n  {\"kind\": \"%s\", \"pass\": \"%s\", \"name\": \"%s\", \"function\": ", i == 0 ? "" : ",",
+            remark_kind_names[r->kind], r->pass, r->name);
+        remark_write_json_string(file, r->function);
+        fprintf(file, ", \"message\": ");
+        remark_write_json_string(file, r->message);
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]\n");
+}
+
+void remarks_write(char* output) {
+    if (remark_options.format == RemarkFormat_None) {
+        return;
+    }
+
+    char* extension = remark_options.format == RemarkFormat_YAML ? ".opt.yaml" : ".opt.json";
+    char* path = malloc_n_type(char, strlen(output) + strlen(extension) + 1);
+    sprintf(path, "%s%s", output, extension);
+
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file: %s\n", path);
+        exit(1);
+    }
+
+    if (remark_options.format == RemarkFormat_YAML) {
+        remark_write_yaml(file);
+    } else {
+        remark_write_json(file);
+    }
+
+    fclose(file);
+    free(path);
+}
+
+void remarks_free() {
+    for (int i = 0; i < remark_records.length; i++) {
+        free(remark_records.data[i].function);
+        free(remark_records.data[i].message);
+    }
+    vec_free(remark_records);
+    remark_records.data = NULL;
+    remark_records.length = 0;
+    remark_records.capacity = 0;
+}
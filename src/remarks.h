@@ -0,0 +1,44 @@
+#ifndef REMARKS_H
+#define REMARKS_H
+
+// optimization remarks: what each pass did (passed) and what it wanted to do but couldn't (missed).
+// they're collected for the whole run and written out at the end, like clang's -fsave-optimization-record.
+// tokens don't carry source positions yet, so a remark only says which function (and label, if any) it's about
+
+typedef enum RemarkKind {
+    RemarkKind_Passed,
+    RemarkKind_Missed,
+} RemarkKind;
+
+typedef enum RemarkFormat {
+    RemarkFormat_None,
+    RemarkFormat_YAML,
+    RemarkFormat_JSON,
+} RemarkFormat;
+
+typedef struct Remark {
+    RemarkKind kind;
+    char* pass;
+    char* name; // what happened, like Inlined or TooBig
+    char* function;
+    char* message;
+} Remark;
+
+typedef struct RemarkOptions {
+    RemarkFormat format; // of the record file
+    int print_passed; // -Rpass, to stderr as they happen
+    int print_missed; // -Rpass-missed
+    int print_stats; // -fstats, per-pass counts and times on stdout
+} RemarkOptions;
+
+void remarks_enable(RemarkOptions options);
+int remarks_enabled(); // lets passes skip work that only feeds remarks
+void remark(RemarkKind kind, char* pass, char* name, char* function, char* format, ...)
+    __attribute__((format(printf, 5, 6)));
+// a line of pass statistics, only printed with -fstats
+void remark_stats(char* format, ...) __attribute__((format(printf, 1, 2)));
+// <output>.opt.yaml or <output>.opt.json, nothing when no format was asked for
+void remarks_write(char* output);
+void remarks_free();
+
+#endif
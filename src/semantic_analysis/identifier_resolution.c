@@ -142,7 +142,10 @@ FunctionDefinition resolve_identifiers_function(FunctionDefinition function, Ide
     char* old_name = function.identifier;
     char* new_name = has_linkage ? function.identifier : idents_mangle_name(function.identifier, table->length);
 
-    if (!identifier_table_can_redefine(table, old_name)) {
+    // a function with linkage can be declared again, which is how mutually recursive functions get written
+    int index = identifier_table_get_index(table, old_name);
+    int redeclared = index >= 0 && has_linkage && table->entries[index].has_linkage;
+    if (!redeclared && !identifier_table_can_redefine(table, old_name)) {
         panic("Variable %s already defined in same scope\n", old_name);
     }
     identifier_table_insert(table, old_name, new_name, true, has_linkage);
@@ -154,7 +157,8 @@ FunctionDefinition resolve_identifiers_function(FunctionDefinition function, Ide
         .body = {
             parser_block_new(),
             .is_some=function.body.is_some
-        }
+        },
+        .storage_class = function.storage_class
     };
 
     IdentifierTable new_table = ident_table_clone(table);
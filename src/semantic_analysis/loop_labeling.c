@@ -3,15 +3,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-struct ProgramAndStructs label_loops(ParserProgram program) {
-    int switch_case_count;
-    for (int k=0;k<program.length;k++) if (program.data[k].type==DeclarationType_Function) switch_case_count++;
-
-    SwitchCases* switch_cases = malloc_n_type(SwitchCases, switch_case_count);
+struct ProgramAndStructs label_loops(ParserProgram program, int* next_id) {
+    // indexed like the program, since that's the function_idx the ir generator gets
+    SwitchCases* switch_cases = calloc(program.length, sizeof(SwitchCases));
     for (int i = 0; i < program.length; i++) {
         Declaration current_decl = program.data[i];
         if (current_decl.type == DeclarationType_Function) {
-            struct FuncAndStructs result = label_loops_function(current_decl.value.function);
+            struct FuncAndStructs result = label_loops_function(current_decl.value.function, next_id);
             program.data[i] = (Declaration){.type=DeclarationType_Function,.value={.function=result.function}};
             switch_cases[i] = result.switch_cases;
         }
@@ -19,12 +17,13 @@ struct ProgramAndStructs label_loops(ParserProgram program) {
     return (struct ProgramAndStructs){program, switch_cases, program.length};
 }
 
-struct FuncAndStructs label_loops_function(FunctionDefinition function) {
+struct FuncAndStructs label_loops_function(FunctionDefinition function, int* next_id) {
     LabelStack stack = {0};
     SwitchCases switch_cases = {0};
-    LoopLabelContext context = {stack, switch_cases, 0};
+    LoopLabelContext context = {stack, switch_cases, *next_id};
     if (function.body.is_some)
         function.body.data = label_loops_block(function.body.data, &context);
+    *next_id = context.current_id;
     return (struct FuncAndStructs){function, context.switch_cases};
 }
 ParserBlock label_loops_block(ParserBlock block, LoopLabelContext* context) {
@@ -87,11 +86,12 @@ Statement label_loops_statement(Statement statement, LoopLabelContext* context)
         case StatementType_CASE: {
             for (int i=context->stack.length - 1;i>=0; i--) {
                 if (!context->stack.data[i].is_loop) {
-                    statement.value.case_statement.label = context->switch_cases.length;
+                    // case labels end up in the assembly too, so they come from the same program-wide ids
+                    statement.value.case_statement.label = ++context->current_id;
                     struct SwitchCase case_data = {
                         .expr = statement.value.case_statement.expr,
-                        .case_label = context->stack.data[i].label,
-                        .switch_label = context->switch_cases.length};
+                        .case_label = statement.value.case_statement.label,
+                        .switch_label = context->stack.data[i].label};
                     vec_push(context->switch_cases, case_data);
                     break;
                 }
@@ -44,8 +44,10 @@ struct ProgramAndStructs {
     int switch_cases_len;
 };
 
-struct ProgramAndStructs label_loops(ParserProgram program);
-struct FuncAndStructs label_loops_function(FunctionDefinition function);
+// loop labels end up in the assembly, so they can't repeat between functions, or between files.
+// next_id carries on from where the last file stopped
+struct ProgramAndStructs label_loops(ParserProgram program, int* next_id);
+struct FuncAndStructs label_loops_function(FunctionDefinition function, int* next_id);
 ParserBlock label_loops_block(ParserBlock block, LoopLabelContext* context);
 Statement label_loops_statement(Statement statement, LoopLabelContext* context);
 Declaration label_loops_declaration(Declaration declaration, LoopLabelContext* context);
@@ -0,0 +1,64 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_map.h"
+
+unsigned int string_map_hash(char* key) {
+    // fnv-1a
+    unsigned int hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+StringMap string_map_new() {
+    return (StringMap){NULL, 0, 0};
+}
+
+StringMapEntry* string_map_slot(StringMapEntry* entries, int capacity, char* key) {
+    unsigned int idx = string_map_hash(key) & (unsigned int)(capacity - 1);
+    while (entries[idx].key != NULL && strcmp(entries[idx].key, key)) {
+        idx = (idx + 1) & (unsigned int)(capacity - 1);
+    }
+    return &entries[idx];
+}
+
+int string_map_get(StringMap* map, char* key) {
+    if (map->capacity == 0) {
+        return -1;
+    }
+
+    StringMapEntry* entry = string_map_slot(map->entries, map->capacity, key);
+    return entry->key == NULL ? -1 : entry->value;
+}
+
+void string_map_set(StringMap* map, char* key, int value) {
+    // keep the load factor under 1/2
+    if ((map->length + 1) * 2 > map->capacity) {
+        int new_capacity = map->capacity == 0 ? 16 : map->capacity * 2;
+        StringMapEntry* new_entries = calloc(new_capacity, sizeof(StringMapEntry));
+
+        for (int i = 0; i < map->capacity; i++) {
+            if (map->entries[i].key != NULL) {
+                *string_map_slot(new_entries, new_capacity, map->entries[i].key) = map->entries[i];
+            }
+        }
+
+        free(map->entries);
+        map->entries = new_entries;
+        map->capacity = new_capacity;
+    }
+
+    StringMapEntry* entry = string_map_slot(map->entries, map->capacity, key);
+    if (entry->key == NULL) {
+        entry->key = key;
+        map->length++;
+    }
+    entry->value = value;
+}
+
+void string_map_free(StringMap map) {
+    free(map.entries);
+}
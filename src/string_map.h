@@ -0,0 +1,23 @@
+#ifndef STRING_MAP_H
+#define STRING_MAP_H
+
+// open addressing hash map from identifiers to ints
+// keys aren't copied, so they have to outlive the map (which is fine for all the names we generate)
+
+typedef struct StringMapEntry {
+    char* key;
+    int value;
+} StringMapEntry;
+
+typedef struct StringMap {
+    StringMapEntry* entries;
+    int length;
+    int capacity;
+} StringMap;
+
+StringMap string_map_new();
+int string_map_get(StringMap* map, char* key); // -1 if the key isn't there
+void string_map_set(StringMap* map, char* key, int value);
+void string_map_free(StringMap map);
+
+#endif
@@ -0,0 +1,17 @@
+int main(void) {
+    int x = 1234;
+    int a = x * 8;
+    int b = x / 4;
+    int c = x % 16;
+    int d = x * 10;
+    int e = x / 3;
+    int f = x * 1;
+    int g = x / 1;
+    int h = x % 1;
+    int k = (x << 2) >> 1;
+    int m = (x & 255) | 3;
+    int n = x ^ 77;
+    int o = ~x & 1023;
+    int p = -x + 5000;
+    return a + b + c + d + e + f + g + h + k + m + n + o + p;
+}
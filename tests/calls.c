@@ -0,0 +1,15 @@
+int plus(int a, int b) {
+    return a + b;
+}
+int twice(int x) {
+    return plus(x, x);
+}
+int main(void) {
+    int r = 0;
+    int i = 0;
+    while (i < 10) {
+        r = plus(r, twice(i));
+        i++;
+    }
+    return r;
+}
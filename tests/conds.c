@@ -0,0 +1,19 @@
+int f(int a, int b) {
+    int r = 0;
+    if (a < b) r = r + 1;
+    if (a <= b) r = r + 2;
+    if (a > b) r = r + 4;
+    if (a >= b) r = r + 8;
+    if (a == b) r = r + 16;
+    if (a != b) r = r + 32;
+    if (!a) r = r + 64;
+    if (!(a < b)) r = r + 128;
+    return r;
+}
+int main(void) {
+    int s = f(1, 2) + f(2, 1) * 3 + f(2, 2) * 7 + f(0, 5) * 11;
+    int k = 10;
+    while (k >= 3) { s = s + k; k = k - 1; }
+    do { k = k + 2; } while (!(k > 20));
+    return s + k;
+}
@@ -0,0 +1,16 @@
+int main(void) {
+    int a = 17;
+    int b = 23;
+    int r = 0;
+    for (int i = 0; i < 30; i++) {
+        int t1 = (a * b) + (a * b);
+        int t2 = (a + b) * (a + b);
+        int t3 = a * b - i;
+        if (i > 10) {
+            r = r + (a * b) % 7 + t1 % 5 + t2 % 3 + t3 % 11;
+        } else {
+            r = r + (a + b) % 13;
+        }
+    }
+    return r;
+}
@@ -0,0 +1,12 @@
+static int unused_leaf(int a) { return a * 3 + 1; }
+static int unused_mid(int a) { return unused_leaf(a) + unused_leaf(a + 1); }
+static int used_leaf(int a) { return a + 7; }
+
+static int chain_a(int a) { if (a == 0) return 0; return chain_a(a - 1) + 1; }
+static int chain_b(int a) { if (a == 0) return 0; return chain_a(a - 1) + 2; }
+int exported(int a) { return used_leaf(a) * 2; }
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 5; i = i + 1) s = s + exported(i);
+    return s;
+}
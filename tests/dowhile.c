@@ -0,0 +1,16 @@
+int main(void) {
+    int i = 0;
+    int acc = 1;
+    do {
+        acc = acc * 2 % 1000;
+        i += 1;
+        if (i == 3) continue;
+        acc -= 1;
+    } while (i < 12);
+    int k = 0;
+    while (1) {
+        k++;
+        if (k > 40) break;
+    }
+    return acc + k;
+}
@@ -0,0 +1,24 @@
+int leaf(int x) {
+    return x * 3 + 1;
+}
+int spill(int n) {
+    int a = leaf(n);
+    int b = leaf(a);
+    int c = leaf(n + 1);
+    int d = leaf(b + c);
+    return a + b + c + d + leaf(a + b + c + d);
+}
+int seven(int a, int b, int c, int d, int e, int f, int g) {
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7;
+}
+int forward(int a, int b, int c, int d, int e, int f, int g) {
+    int local = spill(g);
+    return seven(g, f, e, d, c, b, a + local) + local;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 4; i++) {
+        s = s + forward(i, 1, 2, 3, 4, 5, i + 6) + leaf(i);
+    }
+    return s;
+}
@@ -0,0 +1,18 @@
+int f(int n) {
+    int s = 0;
+    int y;
+    int x;
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            x = y;
+        }
+        y = i * 3;
+        if (i > 0) {
+            s = s + (x + 1) * 100 + (y + 1);
+        }
+    }
+    return s;
+}
+int main(void) {
+    return f(5);
+}
@@ -0,0 +1,25 @@
+static int counter(int n) { return n + 1; }
+static int bump(int x, int g) { g = g + x; return g; }
+int find(int limit, int step) {
+    int i = 0;
+    while (1) {
+        if (i * step > limit) return i;
+        i++;
+    }
+    return 0;
+}
+int absd(int a, int b) { if (a > b) return a - b; return b - a; }
+int even(int n) { if (n == 0) return 1; if (n == 1) return 0; return even(n - 2); }
+int odd(int n) { return 1 - even(n); }
+int use_param(int p) { p = p * 2; return p + 1; }
+int main(void) {
+    int r = 0;
+    for (int k = 0; k < 5; k++) {
+        r = absd(r, k * 7);
+        r = r + counter(k);
+        r = r + find(r, 3);
+        r = r + bump(k, r);
+        r = use_param(r) % 1000;
+    }
+    return r + even(7) + odd(4);
+}
@@ -0,0 +1,20 @@
+static int scale(int x, int mode, int shift) {
+    int r = x;
+    if (mode == 1) r = r * 3;
+    if (mode == 2) r = r + 100;
+    if (mode == 3) r = r - 1;
+    return r + shift;
+}
+static int clamp(int x, int limit) {
+    if (x > limit) return limit;
+    return x;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 10; i = i + 1) {
+        s = s + scale(i, 1, 2);
+        s = s + clamp(scale(i, 2, 2), 105);
+    }
+    s = s + scale(s, 3, 2) + clamp(7, 105);
+    return s;
+}
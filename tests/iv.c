@@ -0,0 +1,8 @@
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 50; i++) {
+        int j = i * 6 + 3;
+        s = s + j;
+    }
+    return s;
+}
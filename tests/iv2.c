@@ -0,0 +1,39 @@
+int f(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s = s + i * 5 - 2;
+    }
+    return s;
+}
+int g(void) {
+    int s = 0;
+    int k;
+    for (k = 40; k > 2; k = k - 2) {
+        int a = k * 3 + 1;
+        s = s + a;
+    }
+    return s + k;
+}
+int h(void) {
+    int s = 0;
+    int last = 0;
+    for (int i = 1; i <= 30; i = i + 1) {
+        for (int j = 0; j < 10; j++) {
+            s = s + (j * 7 + i * 3);
+        }
+        last = i * 9 + 2;
+    }
+    return s + last;
+}
+int d(void) {
+    int s = 0;
+    int i = 3;
+    do {
+        s = s ^ (-i * 11 + 100);
+        i = i + 3;
+    } while (i < 60);
+    return s;
+}
+int main(void) {
+    return f(20) + g() + h() + d();
+}
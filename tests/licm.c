@@ -0,0 +1,25 @@
+int main(void) {
+    int a = 7;
+    int b = 3;
+    int n = 0;
+    int s = 0;
+    int k = 0;
+    while (n < 10) {
+        int t = a * b + 4;
+        s = s + t;
+        if (b) {
+            s = s + a / b;
+        }
+        n = n + 1;
+    }
+    int z = 0;
+    while (z > 100) {
+        k = a / z;
+    }
+    do {
+        int q = (a + b) * (a - b);
+        s = s + q;
+        z = z + 1;
+    } while (z < 5);
+    return s + k;
+}
@@ -0,0 +1,18 @@
+int check(int a, int b, int c) {
+    if (a && b || c) {
+        return 1;
+    }
+    return 0;
+}
+int main(void) {
+    int count = 0;
+    for (int a = 0; a < 2; a++)
+        for (int b = 0; b < 2; b++)
+            for (int c = 0; c < 2; c++)
+                count = count * 2 + check(a, b, c);
+    int x = 5;
+    int y = 7;
+    int z = (x < y) ? x : y;
+    int w = !(x == y) + (x != y) + (x <= y) + (x >= y) + (x > y);
+    return count * 100 + z * 10 + w;
+}
@@ -0,0 +1,7 @@
+int main(void) {
+    int sum = 0;
+    for (int i = 0; i < 100; i++) {
+        sum = sum + i;
+    }
+    return sum;
+}
@@ -0,0 +1,15 @@
+int main(void) {
+    int s = 0;
+    int i = 0;
+    while (i < 30) {
+        i = i + 1;
+        if (i == 3) continue;
+        if (i == 25) break;
+        s = s + i;
+    }
+    for (int j = 0; j < 0; j++) s = s + 1000;
+    for (int j = 0; ; j++) { if (j > 7) break; s = s + j; }
+    for (int j = 10; j > 0; j = j - 1) { if (j == 4) continue; s = s + j * 2; }
+    while (0) s = 99;
+    return s;
+}
@@ -0,0 +1,4 @@
+int limit = 0;
+int get(void) {
+    return limit;
+}
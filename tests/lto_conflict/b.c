@@ -0,0 +1,5 @@
+int limit = 5;
+int get(void);
+int main(void) {
+    return get() + limit;
+}
@@ -0,0 +1 @@
+int helper(int n) { int s = 0; for (int i = 0; i < n; i = i + 1) s = s + i; return s; }
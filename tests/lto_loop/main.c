@@ -0,0 +1,2 @@
+int helper(int n);
+int main(void) { int s = 0; for (int i = 0; i < 3; i = i + 1) s = s + helper(i + 2); return s; }
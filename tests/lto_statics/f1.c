@@ -0,0 +1,3 @@
+static int twice(int a) { return a * 2; }
+int f1(int a) { int s = 0; for (int i = 0; i < a; i = i + 1) s = s + twice(i); return s; }
+int never_called(int a) { return twice(a) + 5; }
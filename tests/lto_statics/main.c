@@ -0,0 +1,3 @@
+static int twice(int a) { return a * 3; }
+int f1(int a);
+int main(void) { int s = 0; for (int i = 0; i < 4; i = i + 1) { switch (i) { case 1: s = s + twice(i); break; case 2: s = s + f1(i + 3); break; } } return s; }
@@ -0,0 +1,15 @@
+int f(int a, int b, int c, int d, int e, int g, int h) {
+    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * g + 7 * h;
+}
+int mode(int x, int flag) {
+    if (flag == 1) return x * 2;
+    if (flag == 2) return x + 100;
+    return x;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 10; i++) {
+        s = s + f(i, 1, 2, 3, 4, 5, 6) + mode(i, 1) + mode(i, 2);
+    }
+    return s;
+}
@@ -0,0 +1,11 @@
+int main(void) {
+    int total = 0;
+    int a = 3;
+    int b = 5;
+    for (int i = 0; i < 20; i++) {
+        for (int j = 0; j < 20; j++) {
+            total = total + a * b + (a + b) * 2;
+        }
+    }
+    return total;
+}
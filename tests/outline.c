@@ -0,0 +1,21 @@
+int f(int x) { return x + 1; }
+int g(int x, int y) {
+    int r = f(x * 3 + y * 5 + 7);
+    return r + f(x * 3 + y * 5 + 9) + x;
+}
+int h(int x, int y) {
+    int r = f(x * 3 + y * 5 + 7);
+    return r - f(x * 3 + y * 5 + 9) + y;
+}
+int k(int x, int y) {
+    int r = f(x * 3 + y * 5 + 7);
+    return r * f(x * 3 + y * 5 + 9);
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 5; i++) {
+        s = s + g(i, 2) + h(i, 3) + k(1, i);
+        s = s & 4095;
+    }
+    return s;
+}
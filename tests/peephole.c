@@ -0,0 +1,25 @@
+int g(int x) {
+    return x * 2;
+}
+int peep(int n) {
+    int a = n;
+    int b = a + 1;
+    int c = a + b;
+    int zero = 0;
+    int z = zero;
+    int w = z + zero;
+    int t = n * 5;
+    t = n * 7;
+    int total = 0;
+    for (int i = 0; i < n; i = i + 1) {
+        a = a + i;
+        b = a + b;
+        total = total + a + b + w;
+    }
+    int r = g(c) + z;
+    r = r + g(b) + total;
+    return r + t;
+}
+int main(void) {
+    return peep(6) + peep(11);
+}
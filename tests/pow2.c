@@ -0,0 +1,16 @@
+int f(int x) {
+    return x * 8 + x / 4 + x % 16 + 2 * x + x / 1 + x % 1 + x * 1;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 20; i++) {
+        s = s + f(i * 13 + 5);
+        s = s + i * 7 + i * 7;
+        s = s ^ (i * 5);
+    }
+    int n = 0;
+    for (int j = 99; j > 0; j = j - 3) {
+        n = n + j * 11;
+    }
+    return s + n;
+}
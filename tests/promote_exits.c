@@ -0,0 +1,22 @@
+int hits;
+static int last = 5;
+int scan(int n, int stop) {
+    for (int i = 0; i < n; i++) {
+        hits = hits + 1;
+        if (i == stop) {
+            last = last + i;
+            return hits * 100 + last;
+        }
+        if (hits > 40) {
+            break;
+        }
+        last = last + i;
+    }
+    return hits + last;
+}
+int main(void) {
+    int s = scan(10, 3);
+    s = s + scan(20, 100);
+    s = s + scan(30, 100);
+    return s + hits * 7 + last;
+}
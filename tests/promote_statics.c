@@ -0,0 +1,14 @@
+int total;
+static int steps = 1;
+int sum(int n) {
+    static int calls;
+    calls = calls + 1;
+    for (int i = 0; i < n; i++) {
+        total = total + i;
+        steps = steps + 1;
+    }
+    return total + steps + calls;
+}
+int main(void) {
+    return sum(100);
+}
@@ -0,0 +1,11 @@
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+int sum_to(int n, int acc) {
+    if (n == 0) return acc;
+    return sum_to(n - 1, acc + n);
+}
+int main(void) {
+    return fib(12) + sum_to(10, 0);
+}
@@ -0,0 +1,93 @@
+#!/bin/bash
+# compiles every test with the given flags, runs it in the emulator and checks what main returns
+# against tests/expected. the tests in tests/ir_expected use statics, which the emulator can't run,
+# so their optimized ir is run with -feval-ir instead. tests in tests/remarks are only compiled,
+# with -Rpass, and checked for a remark from the pass they're there for. run from anywhere after
+# make dev or make main:
+#
+#   tests/run.sh [compiler flags]
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+# the compiler runs ./assembler from wherever it's started
+ln -s "$root/assembler" "$work/assembler"
+
+pass=0
+fail=0
+skipped=0
+
+# compiles tests/<name>.c, or every .c file in tests/<name>/, with the flags plus any extra ones
+compile() {
+    local name=$1
+    shift
+    local inputs
+    if [ -d "$root/tests/$name" ]; then
+        inputs=("$root/tests/$name"/*.c)
+    else
+        inputs=("$root/tests/$name.c")
+    fi
+
+    rm -f "$work/a.out" "$work/a.out.s"
+    if ! (cd "$work" && "$root/out/main" "$@" "${inputs[@]}" > compile.log 2>&1); then
+        echo "FAIL $name: didn't compile"
+        tail -3 "$work/compile.log"
+        fail=$((fail + 1))
+        return 1
+    fi
+}
+
+while read -r name expected skip_flag; do
+    if [ -z "$name" ] || [ "${name:0:1}" == "#" ]; then
+        continue
+    fi
+    if [ -n "$skip_flag" ] && [[ " $* " == *" $skip_flag "* ]]; then
+        skipped=$((skipped + 1))
+        continue
+    fi
+    compile "$name" "$@" || continue
+
+    got=$(cd "$work" && timeout 60 "$root/emulator" -i a.out -o __stdout__ 2>&1 | head -1)
+    if [ "$got" == "$expected" ]; then
+        pass=$((pass + 1))
+    else
+        echo "FAIL $name: got $got, expected $expected"
+        fail=$((fail + 1))
+    fi
+done < "$root/tests/expected"
+
+while read -r name expected skip_flag; do
+    if [ -z "$name" ] || [ "${name:0:1}" == "#" ]; then
+        continue
+    fi
+    if [ -n "$skip_flag" ] && [[ " $* " == *" $skip_flag "* ]]; then
+        skipped=$((skipped + 1))
+        continue
+    fi
+    compile "$name" "$@" -feval-ir || continue
+
+    got=$(sed -n 's/^ir eval: main returned //p' "$work/compile.log")
+    if [ "$got" == "$expected" ]; then
+        pass=$((pass + 1))
+    else
+        echo "FAIL $name: ir eval got $got, expected $expected"
+        fail=$((fail + 1))
+    fi
+done < "$root/tests/ir_expected"
+
+while read -r name pass_name pass_flags; do
+    if [ -z "$name" ] || [ "${name:0:1}" == "#" ]; then
+        continue
+    fi
+    compile "$name" "$@" $pass_flags -Rpass || continue
+
+    if grep -q -F "[-Rpass=$pass_name]" "$work/compile.log"; then
+        pass=$((pass + 1))
+    else
+        echo "FAIL $name: no $pass_name remark"
+        fail=$((fail + 1))
+    fi
+done < "$root/tests/remarks"
+
+echo "${*:-default flags}: $pass passed, $fail failed, $skipped skipped"
+[ "$fail" -eq 0 ]
@@ -0,0 +1,24 @@
+int calls(int v, int k) {
+    return v * 3 + k;
+}
+int main(void) {
+    int n = 0;
+    int s = 0;
+    for (int i = 0; i < 6; i++) {
+        int a = i & 1;
+        int b = i & 2;
+        int c = i & 4;
+        if ((a && b) || c) s = s + 1;
+        if (a || (b && !c)) s = s + 10;
+        if (!(a || b)) s = s + 100;
+        while (a && n < 3) { n = n + 1; }
+        int v = (a && b) + (b || c) * 2 + (!a && !c) * 4;
+        s = s + v * 1000;
+        s = s + ((a || c) ? 7 : 3);
+        if (a && (n = n + 1)) s = s + 0;
+        if (1 && a) s = s + 20000;
+        if (0 || b) s = s + 1;
+    }
+    do { n = n + 1; } while (n < 10 && !(n == 8));
+    return s + n + calls(n, s > 3 || n < 2);
+}
@@ -0,0 +1,30 @@
+int id(int x) {
+    return x;
+}
+int phases(int n) {
+    int a = n + 1;
+    int b = n + 2;
+    int c = n + 3;
+    int d = n + 4;
+    int e = n + 5;
+    int f = n + 6;
+    int g = n + 7;
+    int h = n + 8;
+    int k = n + 9;
+    int m = n + 10;
+    int first = id(a) + b * c + d * e + f * g + h * k + m + id(a + b + c + d + e + f + g + h + k + m);
+    int p = first + 1;
+    int q = first + 2;
+    int r = first + 3;
+    int s = first + 4;
+    int t = first + 5;
+    int u = first + 6;
+    int v = first + 7;
+    int w = first + 8;
+    int y = first + 9;
+    int z = first + 10;
+    return id(p) + q * r + s * t + u * v + w * y + z + id(p + q + r + s + t + u + v + w + y + z) % 1000;
+}
+int main(void) {
+    return phases(3) + phases(20);
+}
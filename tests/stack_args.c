@@ -0,0 +1,11 @@
+int nine(int a, int b, int c, int d, int e, int f, int g, int h, int i) {
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8 + i * 9;
+}
+int main(void) {
+    int x = 3;
+    int s = 0;
+    for (int k = 0; k < 3; k++) {
+        s = s + nine(1, 2, x, 4, 5, 6, 7, 8, 9 + k) + nine(k, 2, 3, 4, 5, 6, 7, x, 9);
+    }
+    return s;
+}
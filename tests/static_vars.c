@@ -0,0 +1,24 @@
+int total = 7;
+int calls;
+static int scale = 3;
+
+int count(void) {
+    static int seen = 100;
+    seen = seen + 1;
+    calls = calls + 1;
+    return seen;
+}
+
+int bump(int x) {
+    extern int total;
+    total = total + x * scale;
+    return total;
+}
+
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 5; i++) {
+        s = s + count() + bump(i);
+    }
+    return s * 10 + calls;
+}
@@ -0,0 +1,13 @@
+static int helper(int x) {
+    return x + 1;
+}
+static int unused(int x) {
+    return x * 100;
+}
+int main(void) {
+    int v = 0;
+    for (int i = 0; i < 5; i++) {
+        v = helper(v) * 2;
+    }
+    return v;
+}
@@ -0,0 +1,21 @@
+int classify(int x) {
+    int r = 0;
+    switch (x) {
+        case 0: r = 10; break;
+        case 1: r = 20; break;
+        case 2: r = 30;
+        case 3: r = r + 40; break;
+        case 4: r = 50; break;
+        case 5: r = 60; break;
+        case 6: r = 70; break;
+        case 9: r = 99; break;
+    }
+    return r;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 12; i++) {
+        s = s + classify(i);
+    }
+    return s;
+}
@@ -0,0 +1,30 @@
+int op(int code, int a, int b) {
+    switch (code) {
+        case 10: return a + b;
+        case 11: return a - b;
+        case 12: return a * b;
+        case 13: return a & b;
+        case 14: return a | b;
+        case 15: return a ^ b;
+        case 17: return a << 1;
+        case 18: return b << 1;
+        case 19: return a;
+        case 20: return b;
+        case 22: return 0;
+        case 23: return 1;
+        case 100: return 77;
+        case 101: return 78;
+        case 102: return 79;
+        case 103: return 80;
+        case 104: return 81;
+        case 105: return 82;
+        case 106: return 83;
+        case 107: return 84;
+    }
+    return 5;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 120; i++) s = s + op(i, i, 3) * (i + 1);
+    return s;
+}
@@ -0,0 +1,43 @@
+int sparse(int x) {
+    switch (x) {
+        case 3: return 1;
+        case 17: return 2;
+        case 40: return 3;
+        case 41: return 4;
+        case 100: return 5;
+        case 250: return 6;
+        case 999: return 7;
+        case 1000: return 8;
+        case 4000: return 9;
+        case 30000: return 10;
+    }
+    return 0;
+}
+int small(int x) {
+    int r = 1;
+    switch (x) { case 5: r = 2; break; case 7: r = 3; }
+    return r;
+}
+int nested(int a, int b) {
+    int r = 0;
+    switch (a) {
+        case 1:
+            switch (b) { case 1: r = 11; break; case 2: r = 12; break; }
+            break;
+        case 2:
+            for (int i = 0; i < b; i++) {
+                switch (i) { case 0: r = r + 1; continue; case 1: r = r + 10; break; }
+                r = r + 100;
+            }
+            break;
+    }
+    return r;
+}
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 1100; i++) s = s + sparse(i) * i;
+    s = s + sparse(4000) + sparse(30000) + sparse(29999);
+    for (int i = 0; i < 10; i++) s = s + small(i);
+    for (int a = 0; a < 4; a++) for (int b = 0; b < 5; b++) s = s + nested(a, b);
+    return s;
+}
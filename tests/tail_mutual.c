@@ -0,0 +1,16 @@
+int odd(int i, int j);
+int even(int i, int j) {
+    if (j == 0) {
+        if (i == 0) return 1;
+        return odd(i - 1, 999);
+    }
+    return odd(i, j - 1);
+}
+int odd(int i, int j) {
+    if (j == 0) {
+        if (i == 0) return 0;
+        return even(i - 1, 999);
+    }
+    return even(i, j - 1);
+}
+int main(void) { return even(120, 999) + 10 * odd(3, 5); }
@@ -0,0 +1,8 @@
+int count(int i, int j, int acc) {
+    if (j == 0) {
+        if (i == 0) return acc;
+        return count(i - 1, 1000, acc + 1);
+    }
+    return count(i, j - 1, (acc + j) % 1000);
+}
+int main(void) { return count(120, 1000, 0); }
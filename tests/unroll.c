@@ -0,0 +1,15 @@
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 4; i++) {
+        s = s + i * 3;
+    }
+    for (int j = 0; j < 37; j++) {
+        s = s + j;
+    }
+    int k = 10;
+    while (k > 0) {
+        s = s + k;
+        k = k - 1;
+    }
+    return s;
+}
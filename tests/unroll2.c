@@ -0,0 +1,63 @@
+int g(int x) { return x * 3 + 1; }
+int a(void) {
+    int s = 0;
+    int i;
+    for (i = 0; i < 3; i++) {
+        s = s + g(i);
+    }
+    return s + i;
+}
+int b(void) {
+    int s = 0;
+    for (int i = 0; i < 23; i++) {
+        if (i % 3 == 0) continue;
+        s = s + i * 7;
+    }
+    return s;
+}
+int c(void) {
+    int s = 0;
+    int i;
+    for (i = 0; i < 30; i++) {
+        if (s > 200) break;
+        s = s + i;
+    }
+    return s * 100 + i;
+}
+int d(void) {
+    int s = 0;
+    for (int i = 0; i < 12; i++) {
+        switch (i) {
+            case 0: s = s + 1; break;
+            case 1: s = s + 2; break;
+            case 2: s = s + 3; break;
+            case 3: s = s + 5; break;
+            case 4: s = s + 7; break;
+            case 5: s = s + 11; break;
+            case 6: s = s + 13; break;
+            case 7: s = s + 17; break;
+            case 8: s = s + 19; break;
+            case 9: s = s * 2; break;
+            case 10: s = s * 2; break;
+            case 11: s = s * 2; break;
+        }
+    }
+    return s;
+}
+int e(void) {
+    int s = 0;
+    int i = 10;
+    do {
+        s = s + i;
+        i = i - 1;
+    } while (i > 0);
+    int k = 0;
+    while (k < 7) {
+        s = s ^ (k << 2);
+        k = k + 1;
+    }
+    return s;
+}
+int main(void) {
+    return a() + b() + c() + d() + e();
+}